@@ -0,0 +1,292 @@
+/*********************************************************
+*
+* Module Name: ClockBench program
+*
+* File Name:  ClockBench.c
+*
+* Summary:  Measures every clock the client and server could take
+*           their timestamps from, so the source can be picked per host
+*           before sub-microsecond RTTs are trusted.  For each clock it
+*           reports the cost of a read, its resolution and how often it
+*           stood still or went backwards between two reads, first with
+*           one thread and then with several reading at once.
+*
+* Invocation:
+*        clockbench [-n <reads per thread>] [-t <threads>]
+*
+*    -n <reads>   : reads per clock per thread (default 2000000)
+*    -t <threads> : threads of the contended runs (default the number
+*                   of online CPUs, at least 2)
+*
+* Output:
+*   CSV on stdout, one header line and then a line per clock and
+*   thread count:
+*       printf("%s,%d,%llu,%.2f,%.2f,%.3f,%lld,%llu,%llu,%lld\n",
+*             clock, threads, reads, nsPerRead, worstThreadNsPerRead,
+*             reportedResNs, minStepNs, repeats, backwards, maxBackwardsNs);
+*
+*   clock    : gettimeofday, realtime, monotonic, monotonic_raw,
+*              realtime_coarse, monotonic_coarse, tsc
+*   reads    : reads per thread
+*   nsPerRead: mean over the threads, worstThreadNsPerRead the slowest one
+*   reportedResNs : clock_getres(), 1000 for gettimeofday, a tick for the TSC
+*   minStepNs: smallest nonzero difference seen between two reads
+*   repeats  : reads that returned the same time as the one before
+*   backwards: reads earlier than the one before, on the same thread,
+*              and by how much at most
+*
+*   The TSC is read raw (rdtsc) and converted with the calibration
+*   from timeBase.c, it is left out if it is not invariant.
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CLOCKBENCH_HAVE_TSC 1
+#endif
+
+#define CLOCKBENCH_DEFAULT_READS 2000000
+#define CLOCKBENCH_MAX_THREADS 256
+
+//Clock IDs, in output order
+enum {
+  BENCH_GETTIMEOFDAY = 0,
+  BENCH_REALTIME,
+  BENCH_MONOTONIC,
+  BENCH_MONOTONIC_RAW,
+  BENCH_REALTIME_COARSE,
+  BENCH_MONOTONIC_COARSE,
+  BENCH_TSC,
+  BENCH_CLOCKS
+};
+
+static const char *benchClockNames[BENCH_CLOCKS] = {
+  "gettimeofday", "realtime", "monotonic", "monotonic_raw",
+  "realtime_coarse", "monotonic_coarse", "tsc"
+};
+
+static const clockid_t benchClockIDs[BENCH_CLOCKS] = {
+  CLOCK_REALTIME, CLOCK_REALTIME, CLOCK_MONOTONIC, CLOCK_MONOTONIC_RAW,
+  CLOCK_REALTIME_COARSE, CLOCK_MONOTONIC_COARSE, CLOCK_MONOTONIC_RAW
+};
+
+typedef struct {
+  int clock;
+  uint64_t reads;
+  pthread_barrier_t *start;
+  //results
+  int64_t elapsedNs;
+  int64_t minStep;
+  uint64_t repeats;
+  uint64_t backwards;
+  int64_t maxBackwards;
+} __attribute__((aligned(CACHE_LINE_SIZE))) benchThread;
+
+void *benchMain(void *arg);
+void runBench(int clock, uint32_t threads, uint64_t reads);
+
+/*************************************************************
+*
+* Function: BENCH_LOOP(READ)
+*
+* Summary: Reads a clock t->reads times, READ leaving the time in
+*          now, and keeps the step statistics.  A macro so each
+*          clock gets a loop with its read inlined rather than one
+*          loop calling through a function pointer, which would add
+*          its own cost to every read.
+*
+***************************************************************/
+#define BENCH_LOOP(READ)                                   \
+  do {                                                     \
+    READ;                                                  \
+    last = now;                                            \
+    for (i = 0; i < t->reads; i++) {                       \
+      READ;                                                \
+      step = now - last;                                   \
+      if (step == 0) {                                     \
+        t->repeats++;                                      \
+      } else if (step < 0) {                               \
+        t->backwards++;                                    \
+        if (-step > t->maxBackwards)                       \
+          t->maxBackwards = -step;                         \
+      } else if (step < t->minStep) {                      \
+        t->minStep = step;                                 \
+      }                                                    \
+      last = now;                                          \
+    }                                                      \
+  } while (0)
+
+/*************************************************************
+*
+* Function: void *benchMain(void *arg)
+*
+* Summary: One thread of a run, all threads start together at the
+*          barrier.  Steps are kept in the clock's own units (us for
+*          gettimeofday, ticks for the TSC) and converted afterwards.
+*
+***************************************************************/
+void *benchMain(void *arg)
+{
+  benchThread *t = (benchThread *)arg;
+  clockid_t clockID = benchClockIDs[t->clock];
+  struct timespec ts;
+  struct timeval tv;
+  int64_t start;
+  int64_t now = 0;
+  int64_t last = 0;
+  int64_t step = 0;
+  uint64_t i;
+
+  t->minStep = INT64_MAX;
+  pthread_barrier_wait(t->start);
+  start = timeNowNs();
+  switch (t->clock) {
+    case BENCH_GETTIMEOFDAY:
+      BENCH_LOOP(gettimeofday(&tv, NULL); now = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec);
+      break;
+#ifdef CLOCKBENCH_HAVE_TSC
+    case BENCH_TSC:
+      BENCH_LOOP(now = (int64_t)__rdtsc());
+      break;
+#endif
+    default:
+      BENCH_LOOP(clock_gettime(clockID, &ts); now = timespecToNs(&ts));
+  }
+  t->elapsedNs = timeNowNs() - start;
+  return NULL;
+}
+
+//Converts a step in the clock's own units to ns
+static int64_t benchStepNs(int clock, int64_t step)
+{
+  if (clock == BENCH_GETTIMEOFDAY)
+    return step * 1000;
+  if (clock == BENCH_TSC)
+    return (int64_t)((double)step * (double)NS_PER_SEC / timeSource.tscHz);
+  return step;
+}
+
+/*************************************************************
+*
+* Function: void runBench(int clock, uint32_t threads, uint64_t reads)
+*
+* Summary: Runs one clock on threads threads and prints its CSV line
+*
+***************************************************************/
+void runBench(int clock, uint32_t threads, uint64_t reads)
+{
+  benchThread *bench = NULL;
+  pthread_t *thread = NULL;
+  pthread_barrier_t start;
+  struct timespec res;
+  double reportedRes = 0.0;
+  int64_t minStep = INT64_MAX;
+  uint64_t repeats = 0;
+  uint64_t backwards = 0;
+  int64_t maxBackwards = 0;
+  double nsPerRead = 0.0;
+  double worstNsPerRead = 0.0;
+  uint32_t i;
+
+  if (posix_memalign((void **)&bench, CACHE_LINE_SIZE, threads * sizeof(benchThread)) != 0)
+    DieWithSystemMessage("posix_memalign() failed");
+  thread = calloc(threads, sizeof(pthread_t));
+  if (thread == NULL)
+    DieWithSystemMessage("calloc() failed");
+  memset(bench, 0, threads * sizeof(benchThread));
+  pthread_barrier_init(&start, NULL, threads);
+
+  for (i = 0; i < threads; i++) {
+    bench[i].clock = clock;
+    bench[i].reads = reads;
+    bench[i].start = &start;
+  }
+  //the calling thread is the first reader
+  for (i = 1; i < threads; i++) {
+    if (pthread_create(&thread[i], NULL, benchMain, &bench[i]) != 0)
+      DieWithSystemMessage("pthread_create() failed");
+  }
+  benchMain(&bench[0]);
+  for (i = 1; i < threads; i++)
+    pthread_join(thread[i], NULL);
+
+  for (i = 0; i < threads; i++) {
+    double perRead = (double)bench[i].elapsedNs / (double)reads;
+    nsPerRead += perRead / threads;
+    if (perRead > worstNsPerRead)
+      worstNsPerRead = perRead;
+    if (bench[i].minStep < minStep)
+      minStep = bench[i].minStep;
+    repeats += bench[i].repeats;
+    backwards += bench[i].backwards;
+    if (bench[i].maxBackwards > maxBackwards)
+      maxBackwards = bench[i].maxBackwards;
+  }
+
+  if (clock == BENCH_GETTIMEOFDAY)
+    reportedRes = 1000.0;
+  else if (clock == BENCH_TSC)
+    reportedRes = (double)NS_PER_SEC / timeSource.tscHz;
+  else if (clock_getres(benchClockIDs[clock], &res) == 0)
+    reportedRes = (double)timespecToNs(&res);
+
+  printf("%s,%d,%llu,%.2f,%.2f,%.3f,%lld,%llu,%llu,%lld\n",
+         benchClockNames[clock], threads, (unsigned long long)reads, nsPerRead, worstNsPerRead,
+         reportedRes, (minStep == INT64_MAX) ? -1LL : (long long)benchStepNs(clock, minStep),
+         (unsigned long long)repeats, (unsigned long long)backwards,
+         (long long)benchStepNs(clock, maxBackwards));
+  fflush(stdout);
+
+  pthread_barrier_destroy(&start);
+  free(thread);
+  free(bench);
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t reads = CLOCKBENCH_DEFAULT_READS;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t threads = (cpus > 2) ? (uint32_t)cpus : 2;
+  bool haveTSC = false;
+  int clock;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:t:")) != -1) {
+    switch (opt) {
+      case 'n':
+        reads = strtoull(optarg, NULL, 10);
+        break;
+      case 't':
+        threads = atoi(optarg);
+        break;
+      default:
+        DieWithUserMessage("Parameter(s)", "[-n <reads per thread>] [-t <threads>]");
+    }
+  }
+  if (reads < 1)
+    reads = 1;
+  if (threads < 1)
+    threads = 1;
+  if (threads > CLOCKBENCH_MAX_THREADS)
+    threads = CLOCKBENCH_MAX_THREADS;
+
+  //timeNowNs() times the runs, so it stays on CLOCK_MONOTONIC_RAW;
+  //the calibration is only wanted for the TSC's own numbers
+  haveTSC = (timeBaseInit(true) == SUCCESS);
+  timeSource.useTSC = false;
+  if (!haveTSC)
+    fprintf(stderr, "clockbench: the TSC is not invariant, leaving it out \n");
+
+  printf("clock,threads,reads,ns_per_read,worst_thread_ns_per_read,reported_res_ns,min_step_ns,repeats,backwards,max_backwards_ns\n");
+  for (clock = 0; clock < BENCH_CLOCKS; clock++) {
+    if ((clock == BENCH_TSC) && !haveTSC)
+      continue;
+    runBench(clock, 1, reads);
+    if (threads > 1)
+      runBench(clock, threads, reads);
+  }
+  exit(0);
+}
@@ -0,0 +1,91 @@
+/*********************************************************
+*
+* Module Name: LogDecode program
+*
+* File Name:  LogDecode.c
+*
+* Summary:  Turns a binary per packet log written by client -L or
+*           server -L (see packetLog.h) back into the text lines the
+*           tool prints without -L.
+*
+* Invocation:
+*        logdecode <log file>
+*
+* Output:
+*   One line per record, client records as
+*       printf("%f %4.9f %4.9f %llu %d\n",
+*             wallTime, RTTSample, smoothedRTT, receivedCount, numberRTTSamples);
+*   server records as
+*       printf("%f %d %llu %llu %d.%d %3.9f %3.9f\n", wallTime, numBytesRcvd,
+*             largestSeqRecv, sequenceNum, timeSentSeconds,
+*             timeSentNanoSeconds, OWDSample, smoothedOWD);
+*   and finally how many records the log lost to full rings:
+*       printf("UDPEchoV2:LogDecode:Summary:  %llu %llu %d\n",
+*             recordsDecoded, recordsDropped, numberRings);
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "packetLog.h"
+
+#define DECODE_RECORDS 1024
+
+int main(int argc, char *argv[]) {
+  FILE *fp = NULL;
+  packetLogFileHeader header;
+  packetLogRecord *records = NULL;
+  size_t n;
+  size_t i;
+  unsigned long long recordsDecoded = 0;
+  unsigned long long recordsDropped = 0;
+
+  if (argc != 2) // Test for correct number of arguments
+    DieWithUserMessage("Parameter(s)", "<log file>");
+
+  fp = fopen(argv[1], "r");
+  if (fp == NULL)
+    DieWithSystemMessage("fopen() failed");
+
+  if (fread(&header, sizeof(header), 1, fp) != 1)
+    DieWithUserMessage("not a packet log", argv[1]);
+  if (header.magic != PACKET_LOG_MAGIC)
+    DieWithUserMessage("not a packet log", argv[1]);
+  if ((header.version != PACKET_LOG_VERSION) || (header.recordSize != sizeof(packetLogRecord)))
+    DieWithUserMessage("unsupported packet log version", argv[1]);
+
+  records = calloc(DECODE_RECORDS, sizeof(packetLogRecord));
+  if (records == NULL)
+    DieWithSystemMessage("calloc() failed");
+
+  while ((n = fread(records, sizeof(packetLogRecord), DECODE_RECORDS, fp)) > 0) {
+    for (i = 0; i < n; i++) {
+      packetLogRecord *r = &records[i];
+      switch (r->recordType) {
+        case PACKET_LOG_CLIENT_RTT:
+          printf("%f %4.9f %4.9f %llu %d\n",
+                 r->wallTime, r->sample, r->smoothed,
+                 (unsigned long long)r->receivedCount, r->numberSamples);
+          recordsDecoded++;
+          break;
+        case PACKET_LOG_SERVER_OWD:
+          printf("%f %d %llu %llu %d.%d %3.9f %3.9f\n", r->wallTime, r->numBytes,
+                 (unsigned long long)r->largestSeqRecv,
+                 (unsigned long long)r->sequenceNum,
+                 r->timeSentSeconds,
+                 r->timeSentNanoSeconds, r->sample, r->smoothed);
+          recordsDecoded++;
+          break;
+        case PACKET_LOG_TRAILER:
+          recordsDropped += r->droppedCount;
+          break;
+        default:
+          fprintf(stderr, "logdecode: skipping record of unknown type %d \n", r->recordType);
+      }
+    }
+  }
+  fclose(fp);
+  free(records);
+
+  printf("UDPEchoV2:LogDecode:Summary:  %llu %llu %d\n",
+         recordsDecoded, recordsDropped, header.numberRings);
+  exit(0);
+}
@@ -0,0 +1,360 @@
+/*********************************************************
+*
+* Module Name: MicroBench program
+*
+* File Name:  MicroBench.c
+*
+* Summary:  Times the per packet building blocks of the client and
+*           server on their own, so the stage that limits throughput
+*           can be found and a change to one of them measured:
+*             pack       packMessageHeader()
+*             unpack     unpackMessageHeader()
+*             swapbytes  swapbytes() of a uint64_t
+*             htonll     htonll()
+*             ewma       the smoothed RTT/OWD update
+*             owd        the server's OWD: header time to ns, subtract,
+*                        convert, sum, min/max and smooth
+*             histogram  histogramRecord()
+*             sequence   seqTrackerUpdate() with some reordering
+*             rxpath     unpack + owd + histogram + sequence, what the
+*                        server spends per datagram besides the syscalls
+*           Each runs over batches of distinct buffers/samples, and the
+*           codec ones also with buffers offset from their alignment.
+*
+* Invocation:
+*        microbench [-n <ops>] [-f <benchmark>]
+*
+*    -n <ops>       : operations per measurement (default 4000000)
+*    -f <benchmark> : only run the benchmarks whose name starts with this
+*
+* Output:
+*   CSV on stdout, one header line and a line per benchmark, batch size
+*   and alignment:
+*       printf("%s,%d,%d,%llu,%.3f,%.3f\n",
+*             benchmark, batch, align, ops, nsPerOp, cyclesPerOp);
+*
+*   align is the byte offset of each buffer from a cache line.  Each
+*   measurement is the best of MICROBENCH_REPEATS.  cyclesPerOp counts
+*   TSC ticks, which run at the nominal clock rate rather than the
+*   core's current one, 0 where there is no TSC.
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "utils.h"
+#include "timeBase.h"
+#include "latencyHistogram.h"
+#include "seqTracker.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MICROBENCH_TSC() __rdtsc()
+#else
+#define MICROBENCH_TSC() 0
+#endif
+
+#define MICROBENCH_DEFAULT_OPS 4000000
+#define MICROBENCH_REPEATS 3
+//Room between buffers, a header plus the largest alignment offset
+#define MICROBENCH_STRIDE (2 * CACHE_LINE_SIZE)
+
+static const uint32_t benchBatchSizes[] = {1, 8, 64, MAX_BATCH_SIZE};
+static const uint32_t benchAligns[] = {0, 1, 2, 4};
+#define BENCH_BATCHES (sizeof(benchBatchSizes) / sizeof(benchBatchSizes[0]))
+#define BENCH_ALIGNS (sizeof(benchAligns) / sizeof(benchAligns[0]))
+
+//What every benchmark works on, set up once
+typedef struct {
+  char *buffers;                   //MAX_BATCH_SIZE buffers MICROBENCH_STRIDE apart
+  messageHeaderDefault *headers;   //MAX_BATCH_SIZE headers
+  double *samples;                 //MAX_BATCH_SIZE latency samples in seconds
+  int64_t *rxTimes;                //MAX_BATCH_SIZE receive times in ns
+  uint64_t *seqs;                  //MAX_BATCH_SIZE sequence numbers, a few swapped
+  latencyHistogram histogram;
+  seqTracker sequence;
+} benchData;
+
+typedef uint64_t (*benchFunction)(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+
+typedef struct {
+  const char *name;
+  benchFunction run;
+  bool alignVariants;
+} benchEntry;
+
+//Results go here so the compiler cannot drop the work
+volatile uint64_t benchSink = 0;
+
+uint64_t benchPack(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+uint64_t benchUnpack(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+uint64_t benchSwapbytes(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+uint64_t benchHtonll(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+uint64_t benchEWMA(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+uint64_t benchOWD(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+uint64_t benchHistogram(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+uint64_t benchSequence(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+uint64_t benchRxPath(benchData *d, uint64_t ops, uint32_t batch, uint32_t align);
+void runMeasurement(benchData *d, const benchEntry *entry, uint64_t ops, uint32_t batch, uint32_t align);
+
+static const benchEntry benchTable[] = {
+  {"pack", benchPack, true},
+  {"unpack", benchUnpack, true},
+  {"swapbytes", benchSwapbytes, true},
+  {"htonll", benchHtonll, false},
+  {"ewma", benchEWMA, false},
+  {"owd", benchOWD, false},
+  {"histogram", benchHistogram, false},
+  {"sequence", benchSequence, false},
+  {"rxpath", benchRxPath, true},
+};
+
+static char *benchBuffer(benchData *d, uint32_t i, uint32_t align)
+{
+  return d->buffers + (size_t)i * MICROBENCH_STRIDE + align;
+}
+
+uint64_t benchPack(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  uint64_t done;
+  uint32_t i;
+
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++) {
+      d->headers[i].sequenceNum = done + i;
+      packMessageHeader(benchBuffer(d, i, align), &d->headers[i]);
+    }
+  }
+  return (uint64_t)benchBuffer(d, 0, align)[3];
+}
+
+uint64_t benchUnpack(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  messageHeaderDefault header;
+  uint64_t sum = 0;
+  uint64_t done;
+  uint32_t i;
+
+  for (i = 0; i < batch; i++)
+    packMessageHeader(benchBuffer(d, i, align), &d->headers[i]);
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++) {
+      unpackMessageHeader(benchBuffer(d, i, align), &header);
+      sum += header.sequenceNum;
+    }
+  }
+  return sum;
+}
+
+uint64_t benchSwapbytes(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  uint64_t done;
+  uint32_t i;
+
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++)
+      swapbytes(benchBuffer(d, i, align), sizeof(uint64_t));
+  }
+  return (uint64_t)benchBuffer(d, 0, align)[0];
+}
+
+uint64_t benchHtonll(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  uint64_t sum = 0;
+  uint64_t done;
+  uint32_t i;
+
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++)
+      sum += htonll(d->seqs[i] + done);
+  }
+  return sum;
+}
+
+uint64_t benchEWMA(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  double alpha = 0.10;
+  double smoothed = 0.0;
+  uint64_t done;
+  uint32_t i;
+
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++)
+      smoothed = (1-alpha)*smoothed + alpha*d->samples[i];
+  }
+  return (uint64_t)(smoothed * NS_PER_SEC);
+}
+
+uint64_t benchOWD(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  double alpha = 0.10;
+  double smoothedOWD = 0.0;
+  double OWDSum = 0.0;
+  double minOWD = 1.0e9;
+  double maxOWD = 0.0;
+  uint64_t done;
+  uint32_t i;
+
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++) {
+      messageHeaderDefault *h = &d->headers[i];
+      int64_t sendTime = (int64_t)h->timeSentSeconds * NS_PER_SEC + h->timeSentNanoSeconds;
+      double OWDSample = nsToSecs(d->rxTimes[i] - sendTime);
+      OWDSum += OWDSample;
+      if (OWDSample < minOWD)
+        minOWD = OWDSample;
+      if (OWDSample > maxOWD)
+        maxOWD = OWDSample;
+      smoothedOWD = (1-alpha)*smoothedOWD + alpha*OWDSample;
+    }
+  }
+  return (uint64_t)((OWDSum + minOWD + maxOWD + smoothedOWD) * NS_PER_SEC);
+}
+
+uint64_t benchHistogram(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  uint64_t done;
+  uint32_t i;
+
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++)
+      histogramRecord(&d->histogram, d->samples[i]);
+  }
+  return d->histogram.count;
+}
+
+uint64_t benchSequence(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  uint64_t done;
+  uint32_t i;
+
+  seqTrackerInit(&d->sequence, 1);
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++)
+      seqTrackerUpdate(&d->sequence, done + d->seqs[i]);
+  }
+  return (d->sequence.inOrderCount + d->sequence.reorderedCount);
+}
+
+uint64_t benchRxPath(benchData *d, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  messageHeaderDefault header;
+  double alpha = 0.10;
+  double smoothedOWD = 0.0;
+  double OWDSum = 0.0;
+  uint64_t done;
+  uint32_t i;
+
+  for (i = 0; i < batch; i++)
+    packMessageHeader(benchBuffer(d, i, align), &d->headers[i]);
+  seqTrackerInit(&d->sequence, 1);
+  for (done = 0; done < ops; done += batch) {
+    for (i = 0; i < batch; i++) {
+      unpackMessageHeader(benchBuffer(d, i, align), &header);
+      int64_t sendTime = (int64_t)header.timeSentSeconds * NS_PER_SEC + header.timeSentNanoSeconds;
+      double OWDSample = nsToSecs(d->rxTimes[i] - sendTime);
+      OWDSum += OWDSample;
+      histogramRecord(&d->histogram, OWDSample);
+      smoothedOWD = (1-alpha)*smoothedOWD + alpha*OWDSample;
+      seqTrackerUpdate(&d->sequence, done + header.sequenceNum);
+    }
+  }
+  return (uint64_t)((OWDSum + smoothedOWD) * NS_PER_SEC) + (d->sequence.inOrderCount + d->sequence.reorderedCount);
+}
+
+/*************************************************************
+*
+* Function: void runMeasurement(benchData *d, const benchEntry *entry,
+*                               uint64_t ops, uint32_t batch, uint32_t align)
+*
+* Summary: Times one benchmark variant MICROBENCH_REPEATS times after
+*          a warm up run and prints the best as a CSV line
+*
+***************************************************************/
+void runMeasurement(benchData *d, const benchEntry *entry, uint64_t ops, uint32_t batch, uint32_t align)
+{
+  double bestNs = 0.0;
+  double bestCycles = 0.0;
+  int repeat;
+
+  //whole batches only
+  ops = ((ops + batch - 1) / batch) * batch;
+  benchSink += entry->run(d, ops / 16 + batch, batch, align);
+  for (repeat = 0; repeat < MICROBENCH_REPEATS; repeat++) {
+    int64_t start = timeNowNs();
+    uint64_t startTicks = MICROBENCH_TSC();
+    benchSink += entry->run(d, ops, batch, align);
+    uint64_t ticks = MICROBENCH_TSC() - startTicks;
+    int64_t elapsed = timeNowNs() - start;
+    if ((repeat == 0) || ((double)elapsed < bestNs)) {
+      bestNs = (double)elapsed;
+      bestCycles = (double)ticks;
+    }
+  }
+  printf("%s,%d,%d,%llu,%.3f,%.3f\n", entry->name, batch, align,
+         (unsigned long long)ops, bestNs / (double)ops, bestCycles / (double)ops);
+  fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t ops = MICROBENCH_DEFAULT_OPS;
+  char *filter = NULL;
+  benchData d;
+  uint32_t b, a, i;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:f:")) != -1) {
+    switch (opt) {
+      case 'n':
+        ops = strtoull(optarg, NULL, 10);
+        break;
+      case 'f':
+        filter = optarg;
+        break;
+      default:
+        DieWithUserMessage("Parameter(s)", "[-n <ops>] [-f <benchmark>]");
+    }
+  }
+  if (ops < 1)
+    ops = 1;
+
+  timeBaseInit(false);
+  memset(&d, 0, sizeof(d));
+  if (posix_memalign((void **)&d.buffers, CACHE_LINE_SIZE, (size_t)MAX_BATCH_SIZE * MICROBENCH_STRIDE) != 0)
+    DieWithSystemMessage("posix_memalign() failed");
+  memset(d.buffers, 0, (size_t)MAX_BATCH_SIZE * MICROBENCH_STRIDE);
+  d.headers = calloc(MAX_BATCH_SIZE, sizeof(messageHeaderDefault));
+  d.samples = calloc(MAX_BATCH_SIZE, sizeof(double));
+  d.rxTimes = calloc(MAX_BATCH_SIZE, sizeof(int64_t));
+  d.seqs = calloc(MAX_BATCH_SIZE, sizeof(uint64_t));
+  if ((d.headers == NULL) || (d.samples == NULL) || (d.rxTimes == NULL) || (d.seqs == NULL))
+    DieWithSystemMessage("calloc() failed");
+
+  //Plausible traffic: ~20us OWDs with some spread, every 16th pair reordered,
+  //sequence numbers from 1 as on the wire
+  srandom(1);
+  for (i = 0; i < MAX_BATCH_SIZE; i++) {
+    int64_t sendTime = timeWallNs() + (int64_t)i * 1000;
+    d.headers[i].sequenceNum = i + 1;
+    d.headers[i].timeSentSeconds = (uint32_t)(sendTime / NS_PER_SEC);
+    d.headers[i].timeSentNanoSeconds = (uint32_t)(sendTime % NS_PER_SEC);
+    d.headers[i].opMode = PING_MODE;
+    d.samples[i] = 0.000020 + (double)(random() % 10000) * 1.0e-9;
+    d.rxTimes[i] = sendTime + (int64_t)(d.samples[i] * NS_PER_SEC);
+    d.seqs[i] = i + 1;
+  }
+  for (i = 0; i + 1 < MAX_BATCH_SIZE; i += 16) {
+    d.seqs[i] = i + 2;
+    d.seqs[i + 1] = i + 1;
+  }
+  histogramInit(&d.histogram);
+
+  printf("benchmark,batch,align,ops,ns_per_op,cycles_per_op\n");
+  for (i = 0; i < sizeof(benchTable) / sizeof(benchTable[0]); i++) {
+    if ((filter != NULL) && (strncmp(benchTable[i].name, filter, strlen(filter)) != 0))
+      continue;
+    for (b = 0; b < BENCH_BATCHES; b++) {
+      for (a = 0; a < (benchTable[i].alignVariants ? BENCH_ALIGNS : 1); a++)
+        runMeasurement(&d, &benchTable[i], ops, benchBatchSizes[b], benchAligns[a]);
+    }
+  }
+  exit(0);
+}
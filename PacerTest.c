@@ -0,0 +1,111 @@
+/*********************************************************
+*
+* Module Name: PacerTest program
+*
+* File Name:  PacerTest.c
+*
+* Summary:  Checks the pacer's error accounting (see pacer.h) on the
+*           real clock: that a sender released early on bucket credit
+*           shows no error, and that a sender that is behind shows how
+*           far.  Each check prints a line and the program exits
+*           non-zero if any of them failed.
+*
+* Invocation:
+*        pacertest
+*
+* Output:
+*       printf("UDPEchoV2:PacerTest:%s:  %s %lld %lld %llu %llu\n",
+*             check, PASS|FAIL, errMin, errMax, packets, under1us);
+*
+*   errMin and errMax are in ns, under1us is the packets in the first
+*   error bucket.  The checks allow a millisecond of scheduling delay,
+*   on a loaded host they can still fail.
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+#include "pacer.h"
+
+//Interval of every check, long enough that a release is never a slot late
+#define PACER_TEST_INTERVAL_NS 1000000LL
+#define PACER_TEST_RATE ((double)NS_PER_SEC / PACER_TEST_INTERVAL_NS)
+
+static int failures = 0;
+
+static void pacerTestSleep(int64_t ns)
+{
+  struct timespec nap;
+
+  nap.tv_sec = ns / NS_PER_SEC;
+  nap.tv_nsec = ns % NS_PER_SEC;
+  while (clock_nanosleep(CLOCK_MONOTONIC, 0, &nap, &nap) == EINTR)
+    ;
+}
+
+static void pacerTestReport(const char *check, bool passed, pacer *p)
+{
+  printf("UDPEchoV2:PacerTest:%s:  %s %lld %lld %llu %llu\n", check,
+         passed ? "PASS" : "FAIL", (long long)p->errMin, (long long)p->errMax,
+         (unsigned long long)p->packetCount, (unsigned long long)p->errBuckets[0]);
+  if (!passed)
+    failures++;
+}
+
+//burst 4, called back to back: after the first every packet goes out at
+//its allowance, ahead of its slot, so none of them is late.  The error
+//used to be taken from the allowance and came to 3 intervals.
+static void checkSteadyBurst()
+{
+  pacer p;
+  uint32_t i;
+
+  pacerInit(&p, PACER_TEST_RATE, 4, PACER_DEFAULT_SPIN_NS);
+  for (i = 0; i < 50; i++)
+    pacerWait(&p);
+  pacerTestReport("SteadyBurst", (p.errMax < PACER_TEST_INTERVAL_NS), &p);
+}
+
+//burst 8 after an idle spell: the first packet is late by the spell, the
+//seven released on bucket credit right behind it are not late at all
+static void checkCreditAfterIdle()
+{
+  pacer p;
+  int64_t lateErr;
+  int64_t creditErrMax = 0;
+  int64_t err;
+  uint32_t i;
+
+  pacerInit(&p, PACER_TEST_RATE, 8, PACER_DEFAULT_SPIN_NS);
+  pacerWait(&p);
+  pacerTestSleep(20 * PACER_TEST_INTERVAL_NS);
+  lateErr = pacerWait(&p);
+  for (i = 0; i < 7; i++) {
+    err = pacerWait(&p);
+    if (err > creditErrMax)
+      creditErrMax = err;
+  }
+  pacerTestReport("CreditAfterIdle",
+                  (lateErr >= 18 * PACER_TEST_INTERVAL_NS) && (creditErrMax == 0), &p);
+}
+
+//burst 1, a sender 5 intervals behind: the error is how late it was
+static void checkLateSender()
+{
+  pacer p;
+  int64_t err;
+
+  pacerInit(&p, PACER_TEST_RATE, 1, PACER_DEFAULT_SPIN_NS);
+  pacerWait(&p);
+  pacerTestSleep(5 * PACER_TEST_INTERVAL_NS);
+  err = pacerWait(&p);
+  pacerTestReport("LateSender", (err >= 3 * PACER_TEST_INTERVAL_NS) &&
+                  (err < 6 * PACER_TEST_INTERVAL_NS), &p);
+}
+
+int main(int argc, char *argv[]) {
+  timeBaseInit(false);
+  checkSteadyBurst();
+  checkCreditAfterIdle();
+  checkLateSender();
+  exit((failures == 0) ? 0 : 1);
+}
@@ -58,24 +58,49 @@ enum sizeConstants {
 //It does NOT include the overhead data needed / used by our message header (or any TCP/IP/Frame headers)
 
 //Min must hold at lesat the messageHeader
-#define MESSAGEMIN 12
+#define MESSAGEMIN MESSAGE_HEADER_SIZE
 #define MESSAGE_DEFAULT_SIZE 24
 //Note: for UDP, this will cause frag. although if using localhost the mtu is usually >60Kbytes
 #define MESSAGEMAX 50000
 
 #define MAX_MSG_HDR 128
 
+//Max number of datagrams the server moves per recvmmsg()/sendmmsg() call
+#define MAX_BATCH_SIZE 256
+//Receive buffers per server io_uring worker, must be a power of two
+#define URING_BUFFER_COUNT 256
+//Max number of server worker threads / SO_REUSEPORT sockets
+#define MAX_WORKERS 64
+
+//Used to keep per thread data on separate cache lines
+#define CACHE_LINE_SIZE 64
+
 
 #define ECHOMAX 10000     /* Longest string to echo */
 #define ERROR_LIMIT 5
 
 typedef struct {
-  uint32_t sequenceNum;
+  uint64_t sequenceNum;
   uint32_t timeSentSeconds;
   uint32_t timeSentNanoSeconds;
   uint16_t opMode;
+  uint16_t flags;
 } messageHeaderDefault;
 
+//On the wire the header is five network order uint32_t:
+//  sequenceNum (low 32 bits), timeSentSeconds, timeSentNanoSeconds,
+//  opMode | (flags << 16), sequenceNum (high 32 bits)
+//The high half goes last so the first 16 bytes keep their old layout.
+#define MESSAGE_HEADER_SIZE 20
+
+//With MSG_FLAG_TIMESTAMPS the header is followed by two int64_t the
+//server fills in, its CLOCK_REALTIME ns at receive and at echo, each as
+//two network order uint32_t, high word first (see clockOffset.h)
+#define MESSAGE_TIMESTAMPS_SIZE 16
+#define MESSAGE_EXT_HEADER_SIZE (MESSAGE_HEADER_SIZE + MESSAGE_TIMESTAMPS_SIZE)
+#define SERVER_RX_TIMESTAMP 0
+#define SERVER_TX_TIMESTAMP 1
+
 
 
 #ifndef LINUX
@@ -89,6 +114,10 @@ typedef struct {
                          // client only maintains a single RTT sample active at a time
 #define ONE_WAY_MODE  2  // server does not issue an ack
 
+//Header flags
+#define MSG_FLAG_ECHO_REQUEST 0x0001  //LIMITED_RTT: the one probe the server echoes
+#define MSG_FLAG_TIMESTAMPS   0x0002  //the echo carries the server's receive and echo times
+
 
 //Definition, FALSE is 0,  TRUE is anything other
 #define TRUE 1
@@ -0,0 +1,220 @@
+/*********************************************************
+*
+* Module Name: udpecho-stat program
+*
+* File Name:  UDPEchoStat.c
+*
+* Summary:  Attaches to the live statistics a client or server started
+*           with -M publishes in /dev/shm (see statsShm.h) and shows
+*           them, once or sampled every interval.  Reading the segment
+*           takes no system call in the process being watched.
+*
+* Invocation:
+*        udpecho-stat -l
+*        udpecho-stat [-i <secs>] [-n <samples>] <pid | segment name>
+*
+*    -l             : list the segments in /dev/shm
+*    -i <secs>      : print an Interval line every secs seconds until the
+*                     program exits (or -n samples were taken)
+*    -n <samples>   : stop after this many Interval lines
+*    pid            : the server's, else the client's, segment of that process
+*
+* Output:
+*   -l prints a line per segment, stale when its process is gone:
+*       printf("UDPEchoV2:Stat:List:  %s %s %d %s %8.3f\n",
+*             name, role, pid, state, uptime);
+*
+*   Without -i the segment, its cumulative counters and latency
+*   distribution (RTT for a client, OWD for a server) in seconds:
+*       printf("UDPEchoV2:Stat:Segment:  %s %s %d %s %8.3f %6.3f %llu\n",
+*             name, role, pid, state, uptime, publishAge, publishCount);
+*       printf("UDPEchoV2:Stat:Counters:  %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
+*             sent, sentBytes, received, receivedBytes, expected, arrived,
+*             reordered, RxErrors, TxErrors, timeouts);
+*       printf("UDPEchoV2:Stat:Latency:  %llu %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f\n",
+*             samples, min, p50, p90, p99, p99.9, p99.99, max, mean, stdDev);
+*
+*   With -i the same Interval lines as the programs' own -i (see
+*   intervalReport.h), tagged Stat, the times being those of the
+*   snapshots the program published.
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+#include "statsShm.h"
+
+#include <dirent.h>
+#include <ctype.h>
+
+#define STAT_USAGE "-l | [-i <secs>] [-n <samples>] <pid | segment name>"
+
+static const char *stateName(statsShmSegment *segment)
+{
+  if (atomic_load(&segment->state) == STATS_SHM_EXITED)
+    return "exited";
+  if ((kill(segment->pid, 0) < 0) && (errno == ESRCH))
+    return "stale";
+  return "running";
+}
+
+/*************************************************************
+*
+* Function: void listSegments()
+*
+* Summary: Prints the udpecho segments found in /dev/shm
+*
+***************************************************************/
+void listSegments()
+{
+  DIR *dir = opendir(STATS_SHM_DIR);
+  struct dirent *entry;
+  char name[sizeof(entry->d_name) + 2];
+  statsShmSegment *segment;
+
+  if (dir == NULL)
+    DieWithSystemMessage("opendir(" STATS_SHM_DIR ") failed");
+  while ((entry = readdir(dir)) != NULL) {
+    if (strncmp(entry->d_name, STATS_SHM_PREFIX, strlen(STATS_SHM_PREFIX)) != 0)
+      continue;
+    snprintf(name, sizeof(name), "/%s", entry->d_name);
+    segment = statsShmAttach(name);
+    if (segment == NULL)
+      continue;
+    printf("UDPEchoV2:Stat:List:  %s %s %d %s %8.3f\n",
+          name, segment->role, segment->pid, stateName(segment),
+          nsToSecs(timeWallNs() - segment->startWallNs));
+    statsShmDetach(segment);
+  }
+  closedir(dir);
+}
+
+/*************************************************************
+*
+* Function: statsShmSegment *attachTarget(char *target, char *name, size_t nameSize)
+*
+* Summary: Finds the segment for a pid or a name ("udpecho-server-12",
+*          "/udpecho-server-12" or "/dev/shm/udpecho-server-12")
+*
+* outputs:
+*   returns the segment with its name in name, dies if there is none
+*
+***************************************************************/
+statsShmSegment *attachTarget(char *target, char *name, size_t nameSize)
+{
+  statsShmSegment *segment = NULL;
+  char *p = target;
+
+  while (isdigit((unsigned char)*p))
+    p++;
+  if ((*p == '\0') && (p != target)) {
+    snprintf(name, nameSize, "/%sserver-%s", STATS_SHM_PREFIX, target);
+    segment = statsShmAttach(name);
+    if (segment == NULL) {
+      snprintf(name, nameSize, "/%sclient-%s", STATS_SHM_PREFIX, target);
+      segment = statsShmAttach(name);
+    }
+  } else {
+    if (strncmp(target, STATS_SHM_DIR "/", strlen(STATS_SHM_DIR) + 1) == 0)
+      target += strlen(STATS_SHM_DIR);
+    snprintf(name, nameSize, "%s%s", (target[0] == '/') ? "" : "/", target);
+    segment = statsShmAttach(name);
+  }
+  if (segment == NULL)
+    DieWithSystemMessage("no udpecho statistics segment found");
+  return segment;
+}
+
+int main(int argc, char *argv[]) {
+  statsShmSegment *segment = NULL;
+  char name[STATS_SHM_NAME_SIZE + 16];
+  intervalCounters *now = NULL;
+  intervalCounters *before = NULL;
+  intervalCounters *swap = NULL;
+  latencyHistogram *delta = NULL;
+  int64_t nowWallNs = 0;
+  int64_t beforeWallNs = 0;
+  int64_t firstWallNs = 0;
+  double intervalSecs = 0.0;
+  long samples = 0;
+  long taken = 0;
+  bool list = false;
+  struct timespec nap;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "li:n:")) != -1) {
+    switch (opt) {
+      case 'l':
+        list = true;
+        break;
+      case 'i':
+        intervalSecs = atof(optarg);
+        break;
+      case 'n':
+        samples = atol(optarg);
+        break;
+      default:
+        DieWithUserMessage("Parameter(s)", STAT_USAGE);
+    }
+  }
+  if (list) {
+    listSegments();
+    exit(0);
+  }
+  if (argc - optind != 1)
+    DieWithUserMessage("Parameter(s)", STAT_USAGE);
+
+  timeBaseInit(false);
+  segment = attachTarget(argv[optind], name, sizeof(name));
+  now = calloc(1, sizeof(intervalCounters));
+  before = calloc(1, sizeof(intervalCounters));
+  delta = calloc(1, sizeof(latencyHistogram));
+  if ((now == NULL) || (before == NULL) || (delta == NULL))
+    DieWithSystemMessage("calloc() failed");
+  if (statsShmRead(segment, now, &nowWallNs) != SUCCESS)
+    DieWithUserMessage("the segment kept changing while it was read", name);
+
+  if (intervalSecs <= 0.0) {
+    latencyHistogram *h = &now->latency;
+    printf("UDPEchoV2:Stat:Segment:  %s %s %d %s %8.3f %6.3f %llu\n",
+          name, segment->role, segment->pid, stateName(segment),
+          nsToSecs(timeWallNs() - segment->startWallNs), nsToSecs(timeWallNs() - nowWallNs),
+          (unsigned long long)segment->publishCount);
+    printf("UDPEchoV2:Stat:Counters:  %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
+          (unsigned long long)now->sentCount, (unsigned long long)now->sentBytes,
+          (unsigned long long)now->receivedCount, (unsigned long long)now->receivedBytes,
+          (unsigned long long)now->expectedCount, (unsigned long long)now->arrivedCount,
+          (unsigned long long)now->reorderedCount, (unsigned long long)now->RxErrorCount,
+          (unsigned long long)now->TxErrorCount, (unsigned long long)now->timeoutCount);
+    printf("UDPEchoV2:Stat:Latency:  %llu %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f\n",
+          (unsigned long long)h->count, histogramMin(h),
+          histogramPercentile(h, 50.0), histogramPercentile(h, 90.0),
+          histogramPercentile(h, 99.0), histogramPercentile(h, 99.9),
+          histogramPercentile(h, 99.99), histogramMax(h),
+          histogramMean(h), histogramStdDev(h));
+    statsShmDetach(segment);
+    exit(0);
+  }
+
+  firstWallNs = nowWallNs;
+  nap.tv_sec = (time_t)intervalSecs;
+  nap.tv_nsec = (long)((intervalSecs - (double)nap.tv_sec) * NS_PER_SEC);
+  while ((samples <= 0) || (taken < samples)) {
+    bool exited;
+    swap = before;
+    before = now;
+    now = swap;
+    beforeWallNs = nowWallNs;
+    nanosleep(&nap, NULL);
+    //read the state first, so the counters read after it are the final ones
+    exited = (atomic_load(&segment->state) == STATS_SHM_EXITED);
+    if (statsShmRead(segment, now, &nowWallNs) != SUCCESS)
+      DieWithUserMessage("the segment kept changing while it was read", name);
+    intervalReportLine("Stat", now, before, delta,
+                       nsToSecs(nowWallNs - firstWallNs), nsToSecs(nowWallNs - beforeWallNs));
+    taken++;
+    if (exited || (strcmp(stateName(segment), "stale") == 0))
+      break;
+  }
+  statsShmDetach(segment);
+  exit(0);
+}
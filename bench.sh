@@ -0,0 +1,157 @@
+#!/bin/bash
+#########################################################
+#
+# Module Name: Loopback benchmark sweep
+#
+# File Name:  bench.sh
+#
+# Summary:  Starts the server on loopback and runs the client against it
+#           over a matrix of message sizes, modes, rates and server worker
+#           counts.  Each run's client and server summary lines are parsed
+#           into one report row, so two builds can be compared on any Linux
+#           box without a network.  Run by 'make bench'.
+#
+# Invocation:
+#        ./bench.sh [-o <output dir>]
+#
+#   The matrix comes from the environment, the defaults in brackets:
+#     BENCH_SIZES    message sizes in bytes           [64 1024 8192]
+#     BENCH_MODES    opModes                          [0 1 2]
+#     BENCH_RATES    packets/sec for opMode 1 and 2   [20000 100000]
+#     BENCH_WORKERS  server worker threads (-w)       [1 2]
+#     BENCH_PACKETS  datagrams per run                [20000]
+#     BENCH_PORT     server port                      [6200]
+#     CLIENT_ARGS / SERVER_ARGS  extra options for every run, e.g. -C
+#   opMode 0 is a ping-pong with no delay, so it ignores BENCH_RATES.
+#
+# Output:
+#   In the output directory (default bench-results):
+#     bench.csv   one header line and a row per run
+#     bench.json  the same rows, one JSON object per line
+#     run-N.client / run-N.server  the raw output of run N
+#
+#   Row columns:
+#     build,run,mode,size,rate,workers,packets,sent_pps,recv_pps,
+#     throughput_bps,loss_rate,latency,lat_samples,lat_min,lat_p50,
+#     lat_p90,lat_p99,lat_p999,lat_max,lat_mean
+#   latency says what the lat_ columns are, the client's RTT in opMode 0
+#   and 1 and the server's OWD in opMode 2, all in seconds.  throughput
+#   is payload bits/sec as received, recv_pps the datagrams/sec behind it.
+#
+#########################################################
+
+outDir=bench-results
+while getopts "o:" opt; do
+  case $opt in
+    o) outDir=$OPTARG ;;
+    *) echo "Usage: $0 [-o <output dir>]" >&2; exit 1 ;;
+  esac
+done
+
+sizes=${BENCH_SIZES:-64 1024 8192}
+modes=${BENCH_MODES:-0 1 2}
+rates=${BENCH_RATES:-20000 100000}
+workerCounts=${BENCH_WORKERS:-1 2}
+packets=${BENCH_PACKETS:-20000}
+port=${BENCH_PORT:-6200}
+
+cd "$(dirname "$0")" || exit 1
+if [ ! -x ./client ] || [ ! -x ./server ]; then
+  echo "bench: build the client and server first (make)" >&2
+  exit 1
+fi
+mkdir -p "$outDir" || exit 1
+build=$(git describe --always --dirty 2>/dev/null || echo unknown)
+csv=$outDir/bench.csv
+json=$outDir/bench.json
+columns="build,run,mode,size,rate,workers,packets,sent_pps,recv_pps,throughput_bps,loss_rate,latency,lat_samples,lat_min,lat_p50,lat_p90,lat_p99,lat_p999,lat_max,lat_mean"
+echo "$columns" > "$csv"
+: > "$json"
+
+# summaryField <file> <tag> <field>: a field of a summary line, $1 being the tag
+summaryField() {
+  awk -v tag="UDPEchoV2:$2:" -v field="$3" '$1 == tag { value = $field } END { print (value == "") ? 0 : value }' "$1"
+}
+
+# emitRow <values...>: appends a row to both reports
+emitRow() {
+  local IFS=,
+  local values=("$@")
+  echo "${values[*]}" >> "$csv"
+  awk -v names="$columns" -v values="${values[*]}" 'BEGIN {
+    n = split(names, name, ","); split(values, value, ",");
+    line = "{";
+    for (i = 1; i <= n; i++) {
+      quoted = (value[i] !~ /^-?[0-9.]+(e[-+]?[0-9]+)?$/);
+      line = line sprintf("%s\"%s\": %s%s%s", (i > 1) ? ", " : "", name[i], quoted ? "\"" : "", value[i], quoted ? "\"" : "");
+    }
+    print line "}";
+  }' >> "$json"
+}
+
+# runOne <mode> <size> <rate> <workers>
+run=0
+runOne() {
+  local mode=$1 size=$2 rate=$3 workers=$4
+  local clientOut=$outDir/run-$run.client
+  local serverOut=$outDir/run-$run.server
+  local rateArgs="" serverPid
+
+  ./server $SERVER_ARGS -w "$workers" "$port" > "$serverOut" 2>&1 &
+  serverPid=$!
+  sleep 0.3
+  if [ "$mode" != 0 ]; then
+    rateArgs="-R $rate"
+  fi
+  ./client $CLIENT_ARGS $rateArgs localhost "$port" 0 "$size" "$packets" "$mode" > "$clientOut" 2>&1
+  # let the last datagrams land before the server reports
+  sleep 0.3
+  kill -INT "$serverPid"
+  wait "$serverPid" 2>/dev/null
+
+  local duration sent sentPps recvPps bps loss latencyFrom latencyFile latencyTag
+  duration=$(summaryField "$clientOut" Client:Summary 3)
+  sent=$(summaryField "$clientOut" Client:Summary 6)
+  [ "$mode" != 0 ] && sent=$(summaryField "$clientOut" Client:Summary 7)
+  sentPps=$(awk -v n="$sent" -v d="$duration" 'BEGIN { printf "%.1f", (d > 0) ? (n - 1) / d : 0 }')
+  case $mode in
+    0)
+      recvPps=$(awk -v n="$(summaryField "$clientOut" Client:Summary 7)" -v d="$duration" 'BEGIN { printf "%.1f", (d > 0) ? n / d : 0 }')
+      bps=$(awk -v p="$recvPps" -v s="$size" 'BEGIN { printf "%.1f", p * s * 8 }')
+      loss=$(summaryField "$clientOut" Client:Summary 5)
+      latencyFrom=rtt; latencyFile=$clientOut; latencyTag=Client:Latency ;;
+    1)
+      bps=$(summaryField "$serverOut" Server:LimitedRTT 4)
+      loss=$(summaryField "$serverOut" Server:Summary 6)
+      latencyFrom=rtt; latencyFile=$clientOut; latencyTag=Client:Latency ;;
+    *)
+      bps=$(summaryField "$serverOut" Server:OneWay 7)
+      loss=$(summaryField "$serverOut" Server:OneWay 4)
+      latencyFrom=owd; latencyFile=$serverOut; latencyTag=Server:Latency ;;
+  esac
+  [ "$mode" != 0 ] && recvPps=$(awk -v b="$bps" -v s="$size" 'BEGIN { printf "%.1f", b / (8 * s) }')
+
+  local lat=()
+  for field in 2 3 4 5 6 7 9 10; do
+    lat+=("$(summaryField "$latencyFile" "$latencyTag" $field)")
+  done
+  emitRow "$build" "$run" "$mode" "$size" "$rate" "$workers" "$packets" "$sentPps" "$recvPps" \
+          "$bps" "$loss" "$latencyFrom" "${lat[@]}"
+  echo "bench: run $run mode $mode size $size rate $rate workers $workers: $recvPps pps, loss $loss" >&2
+  run=$((run + 1))
+}
+
+for workers in $workerCounts; do
+  for mode in $modes; do
+    for size in $sizes; do
+      if [ "$mode" = 0 ]; then
+        runOne "$mode" "$size" 0 "$workers"
+      else
+        for rate in $rates; do
+          runOne "$mode" "$size" "$rate" "$workers"
+        done
+      fi
+    done
+  done
+done
+echo "bench: $run runs, reports in $csv and $json" >&2
@@ -6,24 +6,114 @@
 * Summary:
 *  This file contains the client portion of a client/server
 *    UDP-based performance tool.
-*  
+*
 * Params:
 *  char *  server = argv[1];
 *  uint32_t  serverPort = atoi(argv[2]);
 *  uint32_t delay atoll(argv[3]);
 *  uint32_t messageSize = atoi(argv[4]);
 *  uin32_t nIterations = atoi(argv[5]);
+*  uint16_t opMode = atoi(argv[6]);
+*
+*  opModes (UDPEcho.h):
+*    PING_MODE 0    : every probe is echoed, one RTT sample per probe
+*    LIMITED_RTT 1  : a paced stream (see -r/-R) of which only one packet
+*                     at a time is marked MSG_FLAG_ECHO_REQUEST and echoed.
+*                     The next one is marked once its reply is back or
+*                     its rto has passed (see -t), so RTT is sampled under load
+*                     without the echoes doubling the load.
+*    ONE_WAY_MODE 2 : a paced stream the server never echoes, loss, OWD
+*                     and jitter are measured at the server
 *
 *  Usage :   client
+*             [-W <window>]
+*             [-r <bits/sec>] [-R <packets/sec>] [-B <burst>] [-S <spin usecs>]
+*             [-T] [-H <histogram file>] [-L <log file>] [-G <segments>] [-Z] [-C]
+*             [-i <secs>] [-M] [-t <usecs>] [-k <backoff>]
+*             [-p <usecs>] [-c <cpu>] [-F <priority>]
+*             [-q <bytes>] [-Q <bytes>] [-D] [-O]
+*             [-A <max loss>] [-s <size,size,...>] [-d <secs>] [-w <secs>] [-e <resolution>]
 *             <Server IP>
 *             <Server Port>
 *             [<Iteration Delay (usecs)>]
 *             [<Message Size (bytes)>]
 *             [<# of iterations>]
 *
+*    -W <window> : opMode 0 keeps up to window probes in flight rather than
+*                  waiting for each reply before sending the next probe.
+*                  The iteration delay then paces the sends.
+*    -r <bits/sec>      : opMode 1 and 2 target rate in payload bits/sec, a k, M or G
+*                         suffix scales by 10^3, 10^6 or 10^9
+*    -R <packets/sec>   : opMode 1 and 2 target rate in packets/sec
+*                         With neither, opMode 1 and 2 send one packet per iteration
+*                         delay, and a delay of 0 sends unpaced.
+*    -B <burst>         : token bucket depth, packets that may go back to back (default 1)
+*    -S <spin usecs>    : the pacer spins rather than sleeps this close to a deadline
+*    -T                 : take RTT samples from kernel (SO_TIMESTAMPING) TX and RX
+*                         timestamps instead of clock reads around sendto/recvfrom
+*    -H <histogram file> : write the RTT histogram buckets to this file at exit
+*    -L <log file>      : write the per iteration output as binary records to this
+*                         file from a background thread instead of printing it.
+*                         Decode it with logdecode.
+*    -G <segments>      : opMode 1 and 2 send bursts of up to segments datagrams
+*                         with one UDP_SEGMENT (GSO) sendmsg() (see udpSegment.h).
+*                         The pacer burst is raised to segments, and every datagram
+*                         of a burst carries the time the burst was sent.
+*    -Z                 : send with MSG_ZEROCOPY out of a pool of pinned buffers
+*                         (see zeroCopy.h).  Not with -T in opMode 0, both use
+*                         the socket error queue.
+*    -C                 : time RTTs and pacing with the TSC rather than
+*                         CLOCK_MONOTONIC_RAW, if it is invariant (see timeBase.h)
+*    -i <secs>          : print an Interval line every secs seconds (e.g. 0.1)
+*                         instead of the per iteration output (see intervalReport.h)
+*    -M                 : publish live counters to /dev/shm/udpecho-client-<pid>
+*                         for udpecho-stat (see statsShm.h)
+*    -t <usecs>         : opMode 0 and 1 give a probe up after an rto that follows
+*                         the RTT (see rtoEstimator.h), never less than usecs
+*                         (default 1000) nor more than 2 seconds
+*    -k <backoff>       : each timeout multiplies the rto by backoff (default 2,
+*                         1 turns backing off off)
+*    -p <usecs>         : busy poll mode (see lowLatency.h).  The socket gets
+*                         SO_BUSY_POLL usecs (0 for the default 50), replies are
+*                         waited for by spinning on a non-blocking receive rather
+*                         than sleeping in epoll/poll, and memory is mlockall()ed
+*    -c <cpu>           : pin the sending and receiving thread to cpu
+*    -F <priority>      : run that thread SCHED_FIFO at this priority
+*    -q <bytes>         : SO_RCVBUF of the socket, forced past net.core.rmem_max
+*                         when privileged (see sockDrops.h)
+*    -Q <bytes>         : SO_SNDBUF of the socket, likewise
+*    -D                 : count the replies the socket dropped and the host's
+*                         UDP errors (see the Drops line below).  Implied by
+*                         -q and -Q.
+*    -O                 : opMode 0 and 1 ask the server to echo its receive and
+*                         echo times, to estimate its clock offset and drift and
+*                         the one way delays (see clockOffset.h).  The message
+*                         size is raised to MESSAGE_EXT_HEADER_SIZE if smaller.
+*    -A <max loss>      : instead of the run above, search for the highest packet
+*                         rate each message size gets through with a loss of no
+*                         more than max loss (0 to 1, e.g. 0 or 0.001), as the
+*                         RFC 2544 throughput test does (see rateSearch.h).  Every
+*                         datagram is echoed, the loss is that of the round trip.
+*                         The first trial runs at -R (or -r) if given, else as fast
+*                         as the client can send.  opMode and iterations are ignored.
+*    -s <size,...>      : with -A, the message sizes to search, one after the
+*                         other (default the message size)
+*    -d <secs>          : with -A, the length of a trial (default 1)
+*    -w <secs>          : with -A, traffic sent at the trial's rate before each
+*                         trial and not counted (default 0.2)
+*    -e <resolution>    : with -A, a size is done once the rates that passed and
+*                         failed are closer than this share of the first (default 0.01)
+*
+*  Signals (see signalControl.h):
+*    SIGINT, SIGTERM    : stop sending, leave the loop and print the summary
+*                         as if the iterations had run out.  A second one
+*                         exits without it.
+*    SIGUSR1            : print a Snapshot line of the counters so far and
+*                         carry on
+*
 * outputs:  
 *    The per iteration information printed to stdout:
-*      printf("%f %4.9f %4.9f %d %d\n", 
+*      printf("%f %4.9f %4.9f %llu %d\n", 
 *             wallTime, RTTSample, smoothedRTT, 
 *             receivedCount,  numberRTTSamples);
 *
@@ -32,16 +122,168 @@
 *       smoothedRTT: computes a smoothed RTT average using a weighted filter
 *       numberRTTSamples: The number of samples received
 *
+*    In opMode 0 and 1 the summary is followed by the RTT distribution, from a
+*    log-linear histogram (see latencyHistogram.h), all in seconds:
+*      printf("UDPEchoV2:Client:Latency:  %d %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f\n",
+*             numberRTTSamples, min, p50, p90, p99, p99.9, p99.99, max, mean, stdDev);
+*
+*    With -L, the number of records logged and lost to a full log ring:
+*      printf("UDPEchoV2:Client:Log:  %llu %llu\n", recordsWritten, recordsDropped);
+*
+*    In opMode 0, how the reply sequence numbers arrived (see seqTracker.h):
+*      printf("UDPEchoV2:Client:Sequence:  %llu %llu %llu %llu %llu %llu %4.3f\n",
+*             inOrder, reordered, duplicates, lost, late, maxReorderDistance,
+*             avgReorderDistance);
+*
+*    In opMode 0 and 1 the timeouts: probes given up on, replies that came
+*    after their probe was given up on, the estimator's smoothed RTT and
+*    RTT variation, its last rto and the smallest and largest rto used,
+*    all in seconds, and the floor and backoff it ran with:
+*      printf("UDPEchoV2:Client:RTO:  %d %d %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %2.2f\n",
+*             timeouts, lateReplies, srtt, rttvar, rto, minRto, maxRto,
+*             rtoFloor, backoff);
+*
+*    With -p, -c or -F, the settings the kernel granted: SO_BUSY_POLL usecs
+*    (-1 if refused), whether memory is locked, the SCHED_FIFO priority (-1
+*    if refused, 0 if not asked for), the cpu (-1 for none) and whether the
+*    pinning took, and how often a spinning receive found nothing:
+*      printf("UDPEchoV2:Client:BusyPoll:  %d %d %d %d %d %d %llu\n",
+*             busyPoll, busyPollUsecs, memoryLocked, fifoPriority, cpu, pinned, emptyPolls);
+*
+*    With -D, -q or -Q, the buffer sizes asked for (0 for the default) and
+*    granted (the kernel doubles the request), the datagrams the socket
+*    dropped, the change of the host's UDP RcvbufErrors, InErrors and
+*    SndbufErrors over the run, and totalLost less the socket's drops.  In
+*    opMode 0 that is what was lost in transit, either way, or at the server:
+*      printf("UDPEchoV2:Client:Drops:  %d %d %d %d %llu %llu %llu %llu %6.0f\n",
+*             rcvbufRequested, rcvbufGranted, sndbufRequested, sndbufGranted,
+*             socketDrops, rcvbufErrors, inErrors, sndbufErrors, transitLost);
+*
+*    In windowed mode the summary is followed by:
+*      printf("UDPEchoV2:Client:Window:  %d %d %d %d %d %d\n",
+*             windowSize, maxInFlight, lateCount, duplicateCount,
+*             timeoutCount, unknownCount);
+*
+*    In opMode 1 the RTT probes carried by the stream:
+*      printf("UDPEchoV2:Client:LimitedRTT:  %d %d %d %d %4.9f\n",
+*             probesSent, probesAnswered, probeTimeouts, strayReplies, avgRTT);
+*
+*    In opMode 2 what was sent, the rate in payload bits/sec:
+*      printf("UDPEchoV2:Client:OneWay:  %d %d %llu %6.6f %14.1f\n",
+*             packetsSent, TxErrorCount, bytesSent, sendDuration, sendRate);
+*
+*    In opMode 1 and 2 the summary is followed by the pacer's results, pacing
+*    errors in microseconds and the share of sends in each error bucket:
+*      printf("UDPEchoV2:Client:Pacing:  %12.3f %12.3f %14.1f %14.1f %d %4.3f %4.3f %4.3f %4.3f %3.2f %3.2f %3.2f %3.2f %3.2f\n",
+*             targetPps, achievedPps, targetBps, achievedBps, burst,
+*             errMean, errMin, errMax, errStdDev,
+*             pctUnder1us, pctUnder10us, pctUnder100us, pctUnder1ms, pctOver1ms);
+*
+*    With -G, the burst size asked for, the sendmsg() calls made and the
+*    datagrams each carried on average:
+*      printf("UDPEchoV2:Client:GSO:  %d %llu %4.3f\n",
+*             gsoSegments, gsoSendCount, avgSegmentsPerSend);
+*
+*    With -Z, the sends made zero copy, how many of them the kernel really
+*    sent in place or copied after all, those that went out as normal
+*    sends, and whether the pool is mlock()ed:
+*      printf("UDPEchoV2:Client:ZeroCopy:  %llu %llu %llu %llu %d\n",
+*             sends, zeroCopyCompleted, copiedCompleted, fallbackSends, pinned);
+*
+*    With -T, the summary is followed by the number of RTT samples that
+*    used kernel timestamps and how much longer the user space RTT of
+*    those same samples was, which is the tool's own overhead:
+*      printf("UDPEchoV2:Client:Timestamps:  %d %d %4.9f %4.9f %4.9f\n",
+*             kernelRTTSamples, fallbackRTTSamples, avgUserRTT, avgKernelRTT, avgGap);
+*
+*    With -O, the echoes that carried the server's times, those that did
+*    not, the server's clock less the client's at the last of them and its
+*    drift in ppm, the lowest round trip less the server's part, the mean
+*    forward and reverse delays with the offset taken out and the mean and
+*    largest time the server held a probe, all in seconds.  -T makes the
+*    client's times kernel timestamps, as it does the server's:
+*      printf("UDPEchoV2:Client:ClockOffset:  %llu %d %4.9f %4.3f %4.9f %4.9f %4.9f %4.9f %4.9f\n",
+*             samples, unstamped, offset, driftPpm, minDelay,
+*             avgForwardOWD, avgReverseOWD, avgResidence, maxResidence);
+*
+*    With -A, no summary but a line per trial, the offered and achieved
+*    packets/sec, datagrams sent and echoed back, the loss and whether it
+*    passed:
+*      printf("UDPEchoV2:Client:SearchTrial:  %d %12.1f %12.1f %llu %llu %2.6f %d\n",
+*             messageSize, offeredPps, achievedPps, sent, received, loss, passed);
+*    and once a size is done the highest rate that passed, in packets/sec and
+*    payload bits/sec, the achieved rate and loss of that trial and the
+*    number of trials (a maxPps of 0 means not even the lowest rate tried passed):
+*      printf("UDPEchoV2:Client:Throughput:  %d %12.1f %14.1f %12.1f %2.6f %d\n",
+*             messageSize, maxPps, maxBps, achievedPps, loss, trials);
+*
+*    With -i, every interval and once more before the summary, the change
+*    since the last one.  Loss is that of the replies in opMode 0 and of
+*    the RTT probes in opMode 1, the latency is the RTT; opMode 2 leaves
+*    both to the server:
+*      printf("UDPEchoV2:Client:Interval:  %12.6f %8.3f %6.3f %llu %llu %12.1f %12.1f %10.3f %10.3f %2.4f %llu %llu %4.9f %4.9f %4.9f %4.9f\n",
+*             wallTime, elapsed, intervalSecs, sent, received, sentPps, receivedPps,
+*             sentMbps, receivedMbps, lossRate, reordered, RTTSamples, p50, p90, p99, max);
+*
 * A1: 3/12/2025   Extend with opMode 1 -  CBR traf gen 
 *
 *********************************************************/
 #include "UDPEcho.h"
 #include "AddressUtility.h"
 #include "utils.h"
+#include "timeBase.h"
+#include "probeWindow.h"
+#include "pacer.h"
+#include "sockTimestamp.h"
+#include "latencyHistogram.h"
+#include "packetLog.h"
+#include "seqTracker.h"
+#include "udpSegment.h"
+#include "zeroCopy.h"
+#include "intervalReport.h"
+#include "statsShm.h"
+#include "signalControl.h"
+#include "rtoEstimator.h"
+#include "lowLatency.h"
+#include "sockDrops.h"
+#include "clockOffset.h"
+#include "rateSearch.h"
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <stddef.h>
 
 void myUsage();
 void clientCNTCCode();
-void CatchAlarm(int ignored);
+void runWindowedLoop(int sock, struct addrinfo *servAddr, char *TxBuffer, char *RxBuffer,
+                     int32_t messageSize, int32_t nIterations, bool loopForever, double iterationDelay);
+double pickRTTSample(int64_t userRTT, int64_t kernelTxTime, int64_t kernelRxTime);
+void reportRTTSample(double RTTSample, double smoothedRTT);
+void collectProbeReplies(int sock, char *RxBuffer, int32_t messageSize, int64_t maxWait);
+uint16_t nextProbeFlags();
+char *nextTxBuffer(char *TxBuffer);
+ssize_t sendTxBuffer(int sock, char *buffer, size_t len, struct addrinfo *servAddr);
+void runSegmentedLoop(int sock, struct addrinfo *servAddr, char *TxBuffer, char *RxBuffer,
+                      int32_t messageSize, int32_t nIterations, bool loopForever);
+void clientIntervalSnapshot(intervalCounters *counters);
+void clientPublishCounters(bool force);
+void openReplyWait(int sock);
+void runThroughputSearch(int sock, struct addrinfo *servAddr, char *TxBuffer, char *RxBuffer);
+double runSearchTrial(int sock, struct addrinfo *servAddr, char *TxBuffer, char *RxBuffer,
+                      int32_t size, double pps, uint64_t *sequenceNumber,
+                      uint64_t *sent, uint64_t *received, double *achievedPps);
+uint64_t drainSearchReplies(int sock, char *RxBuffer, int32_t size, uint64_t firstSeq, uint64_t endSeq);
+void recordEchoTimestamps(char *RxBuffer, ssize_t numBytes, messageHeaderDefault *RxHeader,
+                          int64_t kernelTxTime, int64_t kernelRxTime);
+int waitForReply(int sock, char *RxBuffer, int32_t messageSize, uint64_t sequenceNum, int64_t Tstart,
+                 messageHeaderDefault *RxHeader, ssize_t *numBytes, int64_t *Tstop, int64_t *kernelRxTime);
+
+//What waitForReply() waited for
+#define REPLY_MATCHED 0
+#define REPLY_TIMEOUT 1
+#define REPLY_ERROR   2
+#define REPLY_STOPPED 3
 
 extern char Version[];
 
@@ -60,7 +302,7 @@ char* outputFile = NULL;
 uint16_t opMode = 0;
 
 //Stats and counters - these are global as the asynchronous handlers need access
-uint32_t numberOfTrials=0; /*counts number of attempts */
+uint64_t numberOfTrials=0; /*counts number of attempts */
 uint32_t numberLost=0;
 uint32_t numberOutOfOrder=0;
 uint32_t numberTOs=0;
@@ -69,30 +311,138 @@ uint32_t totalGaps=0;
 
 uint32_t TxErrorCount=0;
 uint32_t RxErrorCount=0;
-uint32_t largestSeqRecv = 0;
-uint32_t receivedCount = 0;
+uint64_t largestSeqRecv = 0;
+uint64_t receivedCount = 0;
+//reorder, duplicate and loss accounting of the replies
+seqTracker replySequence;
+
+//Max probes in flight, 1 is the classic stop-and-wait ping
+uint32_t windowSize = 1;
+probeWindow window;
+
+//How long a probe is waited for, adapted to the RTT
+rtoEstimator probeRto;
+int64_t rtoMinNs = RTO_DEFAULT_MIN_NS;
+double rtoBackoff = RTO_DEFAULT_BACKOFF;
+//replies to probes that had already timed out
+uint32_t lateReplies = 0;
+//opMode 0 stop-and-wait: epoll over the socket and the rto timerfd
+int replyEpoll = -1;
+int replyTimer = -1;
+
+//Busy poll mode, pinning and SCHED_FIFO, as asked for and as granted
+lowLatencySettings lowLatency;
+int clientCpu = -1;
+//receives that found nothing while spinning
+uint64_t emptyPolls = 0;
+
+//Socket buffer sizes, 0 leaves the system default, and what was granted
+int rcvbufBytes = 0;
+int sndbufBytes = 0;
+int rcvbufGranted = 0;
+int sndbufGranted = 0;
+//Count socket drops and the host's UDP errors, from where the run started
+bool dropAccounting = false;
+udpSnmpCounters snmpStart;
+
+//Four timestamp echoes and the clock offset estimated from them
+bool echoTimestamps = false;
+clockOffsetEstimator clockOffset;
+//replies that came back without the server's times
+uint32_t unstampedReplies = 0;
+
+//Throughput search: loss threshold, sizes, trial and warm-up length,
+//the resolution and the ceiling from -R, 0 to find it by sending unpaced
+bool throughputSearch = false;
+double searchMaxLoss = 0.0;
+int32_t searchSizes[RATE_SEARCH_MAX_SIZES];
+uint32_t searchSizeCount = 0;
+double searchTrialSecs = RATE_SEARCH_DEFAULT_TRIAL_SECS;
+double searchWarmupSecs = RATE_SEARCH_DEFAULT_WARMUP_SECS;
+double searchResolution = RATE_SEARCH_DEFAULT_RESOLUTION;
+double searchCeilingPps = 0.0;
+
+//LIMITED_RTT: the one echo request in flight within the paced stream
+bool probeOutstanding = false;
+uint64_t probeSeq = 0;
+//the last probe given up on, its reply would be late
+uint64_t timedOutProbeSeq = 0;
+int64_t probeTxTime = 0;
+uint32_t probesSent = 0;
+uint32_t probeTimeouts = 0;
+//replies that did not match the outstanding probe
+uint32_t strayReplies = 0;
+double probeSmoothedRTT = 0.0;
+//sends that went out whole, and the first and last of them
+uint32_t streamPackets = 0;
+int64_t firstTxTime = 0;
+int64_t lastTxTime = 0;
+
+//opMode 1 and 2 GSO: datagrams per sendmsg(), 1 sends them one at a time
+uint32_t gsoSegments = 1;
+uint64_t gsoSendCount = 0;
+
+//MSG_ZEROCOPY sends out of a pool of pinned buffers
+bool zeroCopy = false;
+zeroCopyPool txPool;
+
+//time with the TSC rather than CLOCK_MONOTONIC_RAW
+bool useTSC = false;
+
+//opMode 1 and 2 pacing, a target of 0 falls back to the iteration delay
+double targetBitRate = 0.0;
+double targetPacketRate = 0.0;
+uint32_t pacerBurst = 1;
+int64_t pacerSpinNs = PACER_DEFAULT_SPIN_NS;
+int32_t pacedMessageSize = 0;
+pacer txPacer;
+
+//RTT from SO_TIMESTAMPING kernel timestamps
+bool kernelTimestamps = false;
+uint32_t kernelRTTSamples = 0;
+double kernelRTTSum = 0.0;
+//user space RTT of the same samples, to show the tool's overhead
+double userRTTSum = 0.0;
 
 
 double RTTSum = 0.0;
 uint32_t numberRTTSamples=0;
+latencyHistogram RTTHistogram;
+//where to dump the RTT histogram, NULL for no dump
+char *histogramFile = NULL;
+
+//Binary per packet log
+char *logFile = NULL;
+packetLog rxLog;
+
+//Seconds between Interval lines, 0 prints the per iteration output instead
+double reportInterval = 0.0;
+intervalReporter reporter;
+
+//Live counters in /dev/shm for udpecho-stat
+bool publishStats = false;
+statsShm liveStats;
+
+//The global stats as the send loop last published them, for the
+//reporter, the statistics segment and SIGUSR1
+intervalPublished clientPublished;
 
 //Maintains current wall clock time
 double wallTime = 0.0;
 
-//Prior to sendto, records the current wall clock time
-double lastMsgTxWallTime = 0.0;
-struct timespec msgTxTime;    
+//Prior to sendto, records the current wall clock time in ns
+int64_t lastMsgTxWallTime = 0;
 
 
 
-static const unsigned int TIMEOUT_SECS = 2; // Seconds between retransmits
+static const int64_t TIMEOUT_NS = 2 * NS_PER_SEC; // Longest a probe is waited for, the rto ceiling
 size_t totalBytesSent = 0;
 
 void myUsage()
 {
 
 
-  printf("UDPEchoV2:client(v%s): <Server IP> <Server Port> <Iteration Delay (usecs)> <Message Size (bytes)>] <# of iterations> <opMode> 'outputFile'\n",
+  printf("UDPEchoV2:client(v%s): [-W <window>] [-r <bits/sec>] [-R <packets/sec>] [-B <burst>] [-S <spin usecs>] [-T] [-H <histogram file>] [-L <log file>] [-G <segments>] [-Z] [-C] [-i <secs>] [-M] [-t <usecs>] [-k <backoff>] [-p <usecs>] [-c <cpu>] [-F <priority>] [-q <bytes>] [-Q <bytes>] [-D] [-O] [-A <max loss>] [-s <size,size,...>] [-d <secs>] [-w <secs>] [-e <resolution>] <Server IP> <Server Port> <Iteration Delay (usecs)> <Message Size (bytes)>] <# of iterations> <opMode> 'outputFile'\n",
                 Version);
 }
 
@@ -100,7 +450,7 @@ void myUsage()
 /*************************************************************
 *
 * Function: Main program for  UDPEcho client
-*           
+*
 * inputs: 
 *  char *  server = argv[1];
 *  uint32_t  serverPort = atoi(argv[2]);
@@ -124,6 +474,9 @@ void myUsage()
 int main(int argc, char *argv[]) 
 {
   int32_t rc = NOERROR;
+  char *sizeToken = NULL;
+  char *sizeSave = NULL;
+  uint32_t i;
   uint32_t delay=0;
   int32_t  messageSize=0;
   int32_t nIterations=  -1;
@@ -134,26 +487,21 @@ int main(int argc, char *argv[])
   struct addrinfo *servAddr = NULL;;    // Holder for returned list of server addrs
 
   int rtnVal = 0;
-  int sock = -1;
-  struct sigaction handler; // Signal handler
   ssize_t numBytes = 0;     // Measures the number of bytes sent during operation
-  struct sockaddr_storage fromAddr; // Source address of server
-  socklen_t fromAddrLen = 0;
   char *TxBuffer = NULL;
+  //what is sent, TxBuffer or with -Z a pool buffer
+  char *txBuf = NULL;
   char *RxBuffer = NULL;
-  //Used to help pack and unpack the network buffer
-  uint32_t *TxIntPtr  = NULL;
-  uint32_t *RxIntPtr  = NULL;
   bool loopForever=false;
   bool loopFlag=true;
   double iterationDelay = 0.0;
-  uint32_t sequenceNumber=0;
+  uint64_t sequenceNumber=0;
   struct timespec reqDelay;
   struct timespec remDelay;
 
-  //Used for the RTT sample
-  double  Tstart = 0.0;
-  double  Tstop = 0.0;
+  //Used for the RTT sample, timeNowNs()
+  int64_t Tstart = 0;
+  int64_t Tstop = 0;
   //most recent RTT sample
   double RTTSample = 0.0;
   //smoothed avg
@@ -162,7 +510,118 @@ int main(int argc, char *argv[])
   messageHeaderDefault *TxHeaderPtr=NULL;
   messageHeaderDefault *RxHeaderPtr=NULL;
   uint32_t count = 0;
+  int64_t kernelRxTime = 0;
+  int64_t kernelTxTime = 0;
+  int64_t tsTime = 0;
+  uint32_t tsKey = 0;
+  int opt;
+
+  lowLatencyInit(&lowLatency);
+  while ((opt = getopt(argc, argv, "W:r:R:B:S:TH:L:G:ZCi:Mt:k:p:c:F:q:Q:DOA:s:d:w:e:")) != -1) {
+    switch (opt) {
+      case 'W':
+        windowSize = atoi(optarg);
+        break;
+      case 'r':
+        targetBitRate = parseRate(optarg);
+        break;
+      case 'R':
+        targetPacketRate = parseRate(optarg);
+        break;
+      case 'B':
+        pacerBurst = atoi(optarg);
+        break;
+      case 'S':
+        pacerSpinNs = (int64_t)atoi(optarg) * 1000;
+        break;
+      case 'T':
+        kernelTimestamps = true;
+        break;
+      case 'H':
+        histogramFile = optarg;
+        break;
+      case 'L':
+        logFile = optarg;
+        break;
+      case 'G':
+        gsoSegments = atoi(optarg);
+        break;
+      case 'Z':
+        zeroCopy = true;
+        break;
+      case 'C':
+        useTSC = true;
+        break;
+      case 'i':
+        reportInterval = atof(optarg);
+        break;
+      case 'M':
+        publishStats = true;
+        break;
+      case 't':
+        rtoMinNs = (int64_t)atoi(optarg) * 1000;
+        break;
+      case 'k':
+        rtoBackoff = atof(optarg);
+        break;
+      case 'p':
+        lowLatency.busyPoll = true;
+        lowLatency.busyPollRequested = atoi(optarg);
+        break;
+      case 'c':
+        clientCpu = atoi(optarg);
+        break;
+      case 'F':
+        lowLatency.fifoRequested = atoi(optarg);
+        break;
+      case 'q':
+        rcvbufBytes = atoi(optarg);
+        dropAccounting = true;
+        break;
+      case 'Q':
+        sndbufBytes = atoi(optarg);
+        dropAccounting = true;
+        break;
+      case 'D':
+        dropAccounting = true;
+        break;
+      case 'O':
+        echoTimestamps = true;
+        break;
+      case 'A':
+        throughputSearch = true;
+        searchMaxLoss = atof(optarg);
+        break;
+      case 's':
+        for (sizeToken = strtok_r(optarg, ",", &sizeSave); sizeToken != NULL;
+             sizeToken = strtok_r(NULL, ",", &sizeSave)) {
+          if (searchSizeCount == RATE_SEARCH_MAX_SIZES) {
+            printf("client: only the first %d sizes are searched \n", RATE_SEARCH_MAX_SIZES);
+            break;
+          }
+          searchSizes[searchSizeCount++] = atoi(sizeToken);
+        }
+        break;
+      case 'd':
+        searchTrialSecs = atof(optarg);
+        break;
+      case 'w':
+        searchWarmupSecs = atof(optarg);
+        break;
+      case 'e':
+        searchResolution = atof(optarg);
+        break;
+      default:
+        myUsage();
+        exit(1);
+    }
+  }
+  //Shift the positional params down so they stay at argv[1..]
+  argc -= optind - 1;
+  argv += optind - 1;
 
+  if (windowSize < 1)
+    windowSize = 1;
 
 
   if (argc <= 3)    /* need at least server name and port */
@@ -171,6 +630,11 @@ int main(int argc, char *argv[])
     exit(1);
   }
 
+  if (timeBaseInit(useTSC) != SUCCESS)
+    printf("client: the TSC is not invariant, timing with CLOCK_MONOTONIC_RAW \n");
+  else if (useTSC)
+    printf("client: timing with the TSC at %.0f Hz \n", timeSource.tscHz);
+
   wallTime = getCurTimeD();
   startTime = wallTime;
 
@@ -194,6 +658,8 @@ int main(int argc, char *argv[])
     messageSize= atoi(argv[4]);
     if (messageSize > MAX_DATA_BUFFER)
       messageSize = MAX_DATA_BUFFER;
+    if (messageSize < MESSAGEMIN)
+      messageSize = MESSAGEMIN;
   }
 
   if (argc >5) {
@@ -207,6 +673,38 @@ int main(int argc, char *argv[])
     opMode = atoi(argv[6]);
   }
 
+  if (echoTimestamps && (opMode == ONE_WAY_MODE)) {
+    printf("client: opMode 2 has no echoes to carry the server's times, ignoring -O \n");
+    echoTimestamps = false;
+  }
+  if (echoTimestamps && (messageSize < MESSAGE_EXT_HEADER_SIZE)) {
+    printf("client: messageSize %d too small for the server's times, using %d \n", messageSize, MESSAGE_EXT_HEADER_SIZE);
+    messageSize = MESSAGE_EXT_HEADER_SIZE;
+  }
+  clockOffsetInit(&clockOffset);
+
+  //The search echoes everything, and every buffer is sized for its largest message
+  if (throughputSearch) {
+    if (searchSizeCount == 0)
+      searchSizes[searchSizeCount++] = messageSize;
+    messageSize = MESSAGEMIN;
+    for (i = 0; i < searchSizeCount; i++) {
+      if (searchSizes[i] > MAX_DATA_BUFFER)
+        searchSizes[i] = MAX_DATA_BUFFER;
+      if (searchSizes[i] < MESSAGEMIN)
+        searchSizes[i] = MESSAGEMIN;
+      if (searchSizes[i] > messageSize)
+        messageSize = searchSizes[i];
+    }
+    opMode = PING_MODE;
+    windowSize = 1;
+    searchCeilingPps = targetPacketRate;
+    if (searchTrialSecs <= 0.0)
+      searchTrialSecs = RATE_SEARCH_DEFAULT_TRIAL_SECS;
+    if (searchWarmupSecs < 0.0)
+      searchWarmupSecs = 0.0;
+  }
+
 //outputFile
   if (argc > 7) {
     outputFile = argv[7];
@@ -214,7 +712,13 @@ int main(int argc, char *argv[])
     freopen(outputFile, "w", stdout);
   }
 
-  signal (SIGINT, clientCNTCCode);
+  //Before any thread is started, they all have to block the signals it takes over
+  if (signalControlStart("Client", clientIntervalSnapshot) != NOERROR)
+    DieWithSystemMessage("failed to set up the signal handling");
+  signalControlAddThread(pthread_self());
+
+  if ((logFile != NULL) && (packetLogOpen(&rxLog, logFile, 1) != NOERROR))
+    DieWithSystemMessage("failed to open the packet log");
 
   iterationDelay = ((double)delay)/1000000;/* Iteration delay in seconds */
   reqDelay.tv_sec = (uint32_t)floor(iterationDelay);
@@ -227,19 +731,39 @@ int main(int argc, char *argv[])
   remDelay.tv_sec = 0;
   remDelay.tv_nsec = 0;
 
+  //opMode 1 and 2 pacing: an explicit rate wins, else one packet per iteration delay
+  if (targetBitRate > 0.0)
+    targetPacketRate = targetBitRate / (8.0 * (double)messageSize);
+  else if ((targetPacketRate <= 0.0) && (delay > 0))
+    targetPacketRate = 1.0 / iterationDelay;
+  pacedMessageSize = messageSize;
+  if (gsoSegments < 1)
+    gsoSegments = 1;
+  if (opMode == PING_MODE)
+    gsoSegments = 1;
+  //A burst has to fit one UDP payload
+  if (gsoSegments > UDP_MAX_GSO_SEGMENTS)
+    gsoSegments = UDP_MAX_GSO_SEGMENTS;
+  if (gsoSegments * messageSize > GRO_BUFFER_SIZE - MAX_MSG_HDR)
+    gsoSegments = (GRO_BUFFER_SIZE - MAX_MSG_HDR) / messageSize;
+  if (gsoSegments < 1)
+    gsoSegments = 1;
+  if (pacerBurst < gsoSegments)
+    pacerBurst = gsoSegments;
+  pacerInit(&txPacer, targetPacketRate, pacerBurst, pacerSpinNs);
+
 
   sequenceNumber++;
+  seqTrackerInit(&replySequence, sequenceNumber);
 
 
   //Init memory for first send
-  TxBuffer = malloc((size_t)messageSize);
+  TxBuffer = malloc((size_t)messageSize * gsoSegments);
   if (TxBuffer == NULL) {
-    printf("client: HARD ERROR malloc of Tx  %d bytes failed \n", messageSize);
+    printf("client: HARD ERROR malloc of Tx  %d bytes failed \n", messageSize * gsoSegments);
     exit(1);
   }
-  memset(TxBuffer, 0, messageSize);
-  //This pointer is used when packing the header into the network buffer
-  TxIntPtr  = (uint32_t *) TxBuffer;
+  memset(TxBuffer, 0, (size_t)messageSize * gsoSegments);
 
   messageHeaderDefault TxHeader;
   TxHeaderPtr=&TxHeader;
@@ -247,7 +771,7 @@ int main(int argc, char *argv[])
 
   //Design note:  We will use separate header data structures. 
   //And then to pack or unpack the/from the buffer we do each uint32_t at a time performing
-  //  the conversion to the correct byte order.
+  //  the conversion to the correct byte order (packMessageHeader/unpackMessageHeader).
 
 
 //typedef struct {
@@ -267,9 +791,6 @@ int main(int argc, char *argv[])
   messageHeaderDefault RxHeader;
   RxHeaderPtr=&RxHeader;
 
-  //This pointer is used when packing the header into the network buffer
-  RxIntPtr  = (uint32_t *) RxBuffer;
-
 
 #ifdef TRACEME
   printf("client: server:%s  service:%s  messageSize:%d \n", 
@@ -357,47 +878,112 @@ int main(int argc, char *argv[])
   if (sock < 0)
     DieWithSystemMessage("socket() failed");
 
-  // Set signal handler for alarm signal
-  handler.sa_handler = CatchAlarm;
-  if (sigfillset(&handler.sa_mask) < 0) // Block everything in handler
-    DieWithSystemMessage("sigfillset() failed");
-  handler.sa_flags = 0;
+  if (kernelTimestamps) {
+    //Only PING_MODE pairs TX timestamps with replies
+    if (enableSocketTimestamps(sock, (opMode == PING_MODE)) != NOERROR)
+      DieWithSystemMessage("setsockopt(SO_TIMESTAMPING) failed");
+  }
+
+  //Every receive already passes MSG_DONTWAIT where it spins, the sends stay blocking
+  if (lowLatencySocket(&lowLatency, sock, false) != NOERROR)
+    perror("client: setsockopt(SO_BUSY_POLL) failed ");
+  if (lowLatencyLockMemory(&lowLatency) != NOERROR)
+    perror("client: mlockall() failed, memory is not locked ");
+
+  if (dropAccounting) {
+    if (sockSetBuffer(sock, true, rcvbufBytes, &rcvbufGranted) != NOERROR)
+      perror("client: setsockopt(SO_RCVBUF) failed ");
+    else if ((rcvbufBytes > 0) && (rcvbufGranted < 2 * rcvbufBytes))
+      printf("client: SO_RCVBUF is %d, net.core.rmem_max caps it without CAP_NET_ADMIN \n", rcvbufGranted);
+    if (sockSetBuffer(sock, false, sndbufBytes, &sndbufGranted) != NOERROR)
+      perror("client: setsockopt(SO_SNDBUF) failed ");
+    else if ((sndbufBytes > 0) && (sndbufGranted < 2 * sndbufBytes))
+      printf("client: SO_SNDBUF is %d, net.core.wmem_max caps it without CAP_NET_ADMIN \n", sndbufGranted);
+    if (udpSnmpRead(&snmpStart) != NOERROR)
+      printf("client: could not read /proc/net/snmp, the host's UDP errors are not reported \n");
+  }
+
+  if (zeroCopy && kernelTimestamps && (opMode == PING_MODE)) {
+    printf("client: -Z and -T both use the socket error queue, ignoring -Z \n");
+    zeroCopy = false;
+  }
+  if (zeroCopy) {
+    if (zeroCopyInit(&txPool, sock, ZERO_COPY_POOL_BUFFERS, (size_t)messageSize * gsoSegments) != SUCCESS)
+      DieWithSystemMessage("zero copy setup (SO_ZEROCOPY) failed");
+    if (!txPool.pinned)
+      printf("client: could not mlock the zero copy buffers (RLIMIT_MEMLOCK), using them unpinned \n");
+  }
+
+  rtoInit(&probeRto, rtoMinNs, TIMEOUT_NS, rtoBackoff);
+  if ((opMode == PING_MODE) && (windowSize <= 1))
+    openReplyWait(sock);
+
+  if ((reportInterval > 0.0) &&
+      (intervalReportStart(&reporter, "Client", reportInterval, clientIntervalSnapshot) != NOERROR))
+    DieWithSystemMessage("failed to start the interval reporter");
+  if (publishStats) {
+    if (statsShmOpen(&liveStats, "client", clientIntervalSnapshot) != NOERROR)
+      DieWithSystemMessage("failed to create the statistics segment");
+    printf("client: publishing live statistics to %s%s \n", STATS_SHM_DIR, liveStats.name);
+  }
+  //Last, so the helper threads started above are neither pinned nor SCHED_FIFO
+  if (lowLatencyThread(&lowLatency, clientCpu) != NOERROR) {
+    if ((clientCpu >= 0) && (!lowLatency.pinned))
+      printf("client: failed to pin to cpu %d \n", clientCpu);
+    if (lowLatency.fifoApplied < 0)
+      printf("client: could not get SCHED_FIFO priority %d \n", lowLatency.fifoRequested);
+  }
 
-  if (sigaction(SIGALRM, &handler, 0) < 0)
-    DieWithSystemMessage("sigaction() failed for SIGALRM");
 
 
+  if (throughputSearch)
+    runThroughputSearch(sock, servAddr, TxBuffer, RxBuffer);
+  if ((opMode == PING_MODE) && (windowSize > 1)) {
+    runWindowedLoop(sock, servAddr, TxBuffer, RxBuffer, messageSize,
+                    nIterations, loopForever, iterationDelay);
+    clientCNTCCode();
+  }
+  if ((opMode != PING_MODE) && (gsoSegments > 1)) {
+    runSegmentedLoop(sock, servAddr, TxBuffer, RxBuffer, messageSize,
+                     nIterations, loopForever);
+    clientCNTCCode();
+  }
 
   while (loopFlag)
   {
-
-    lastMsgTxWallTime = getCurTime(&msgTxTime);
-    wallTime = lastMsgTxWallTime;
+    if (signalStopRequested())
+      clientCNTCCode();
+    clientPublishCounters(false);
+    //CBR: hold the target rate, the timestamp is taken after the wait
+    if ((opMode != PING_MODE) && (loopForever || (numberOfTrials < (uint64_t)nIterations)))
+      pacerWait(&txPacer);
+
+    lastMsgTxWallTime = timeWallNs();
     //Update the TxHeader
     TxHeaderPtr->sequenceNum = sequenceNumber++;
-    TxHeaderPtr->timeSentSeconds = msgTxTime.tv_sec;
-    TxHeaderPtr->timeSentNanoSeconds = msgTxTime.tv_nsec;
+    TxHeaderPtr->timeSentSeconds = (uint32_t)(lastMsgTxWallTime / NS_PER_SEC);
+    TxHeaderPtr->timeSentNanoSeconds = (uint32_t)(lastMsgTxWallTime % NS_PER_SEC);
     TxHeaderPtr->opMode = opMode;       // Updated to also include the opMode
+    TxHeaderPtr->flags = nextProbeFlags() | (echoTimestamps ? MSG_FLAG_TIMESTAMPS : 0);
 
     //pack the header into the network buffer
-    TxIntPtr  = (uint32_t *) TxBuffer;
-    *TxIntPtr++  = htonl(TxHeaderPtr->sequenceNum);
-    *TxIntPtr++  = htonl(TxHeaderPtr->timeSentSeconds);
-    *TxIntPtr++  = htonl(TxHeaderPtr->timeSentNanoSeconds);
-    *TxIntPtr++  = htonl(TxHeaderPtr->opMode);
+    txBuf = nextTxBuffer(TxBuffer);
+    packMessageHeader(txBuf, TxHeaderPtr);
     rc = NOERROR;
     numberOfTrials++;
     if ( (!loopForever) &&  (numberOfTrials > nIterations) )
     {
          loopFlag=false;
+         //give the last probe its chance to come back
+         if (opMode == LIMITED_RTT)
+           collectProbeReplies(sock, RxBuffer, messageSize, probeTxTime + rtoCurrent(&probeRto) - timeNowNs());
 	 //A1
          clientCNTCCode();
          break;
     }
-    Tstart= getTimestampD();
+    Tstart = timeNowNs();
     // Send the string to the server
-    numBytes = sendto(sock, TxBuffer, messageSize, 0,
-      servAddr->ai_addr, servAddr->ai_addrlen);
+    numBytes = sendTxBuffer(sock, txBuf, messageSize, servAddr);
     totalBytesSent += numBytes;
     if (numBytes < 0) {
         TxErrorCount++;
@@ -412,61 +998,65 @@ int main(int argc, char *argv[])
 //#endif
         continue;
     }
+    if (firstTxTime == 0)
+      firstTxTime = Tstart;
+    lastTxTime = Tstart;
+    streamPackets++;
+
+      if (opMode == LIMITED_RTT) {
+        if (TxHeaderPtr->flags & MSG_FLAG_ECHO_REQUEST) {
+          probeOutstanding = true;
+          probeSeq = TxHeaderPtr->sequenceNum;
+          probeTxTime = Tstart;
+          probesSent++;
+        }
+        collectProbeReplies(sock, RxBuffer, messageSize, 0);
+      }
 
       if (opMode == 0) {
 
-          // Receive a response
-    
-          // Set length of from address structure (in-out parameter)
-          fromAddrLen = sizeof(fromAddr);
-          alarm(TIMEOUT_SECS); // Set the timeout
-    
-          //returns -1 on error else bytes received
-          rc =  recvfrom(sock, RxBuffer, messageSize, 0, (struct sockaddr *) &fromAddr, &fromAddrLen);
-          if (rc == ERROR) {
-            if (errno == EINTR) {     // Alarm went off
+          // Wait for the reply, for at most the probe's rto
+          rc = waitForReply(sock, RxBuffer, messageSize, TxHeaderPtr->sequenceNum, Tstart,
+                            RxHeaderPtr, &numBytes, &Tstop, &kernelRxTime);
+          if (rc == REPLY_STOPPED)
+            continue;
+          if (rc == REPLY_TIMEOUT) {
+            numberTOs++;
       //#ifdef TRACEME
-                printf("client: recvfrom error EINTR, numberTOs:%d \n",numberTOs);
+            printf("client: no reply within %4.9f, numberTOs:%d \n", nsToSecs(probeRto.rtoNs), numberTOs);
       //#endif
-              rc = NOERROR;
-              continue;
-            } else {
-              RxErrorCount++;
-      //#ifdef TRACEME
-                perror("client: recvfrom other error \n");
-      //#endif
-            }
+            rtoTimeout(&probeRto);
+            rc = NOERROR;
+            continue;
           }
-          else {
+          if (rc == REPLY_MATCHED) {
             //succeeded!
-            numBytes=rc;
-            alarm(0);
-      //Obtain RTT sample
-            Tstop =  getTimestampD();
-            RTTSample= Tstop - Tstart;
+            rtoSample(&probeRto, Tstop - Tstart);
+            //the TX timestamp is queued before the datagram leaves, so it is there by now
+            kernelTxTime = 0;
+            while (kernelTimestamps && (readTxTimestamp(sock, &tsKey, &tsTime) == 1))
+              kernelTxTime = tsTime;
+            RTTSample= pickRTTSample(Tstop - Tstart, kernelTxTime, kernelRxTime);
+            recordEchoTimestamps(RxBuffer, numBytes, RxHeaderPtr, kernelTxTime, kernelRxTime);
             RTTSum += RTTSample;
             numberRTTSamples++;
+            histogramRecord(&RTTHistogram, RTTSample);
             smoothedRTT = (1-alpha)*smoothedRTT + alpha*RTTSample;
             rc = NOERROR;
             receivedCount++;
             wallTime = getCurTimeD();
     
-            RxIntPtr  = (uint32_t *) RxBuffer;
-            RxHeaderPtr->sequenceNum =  ntohl(*RxIntPtr++);
-            RxHeaderPtr->timeSentSeconds =  ntohl(*RxIntPtr++);
-            RxHeaderPtr->timeSentNanoSeconds  =  ntohl(*RxIntPtr++);
-    
-            printf("%f %4.9f %4.9f %d %d\n", 
-                  wallTime, RTTSample, smoothedRTT, 
-                  receivedCount,  numberRTTSamples);
+            reportRTTSample(RTTSample, smoothedRTT);
       #ifdef TRACEME
             printf("client: succeeded to recv %d bytes from server \n", (int) numBytes);
-            printf("Rxed: %d %d %d \n", 
-                  RxHeaderPtr->sequenceNum, 
+            printf("Rxed: %llu %d %d \n", 
+                  (unsigned long long)RxHeaderPtr->sequenceNum, 
                   RxHeaderPtr->timeSentSeconds, RxHeaderPtr->timeSentNanoSeconds);
       #endif
           }
-          //delay requested amount
+          //delay requested amount, a long one with the reply published
+          if (iterationDelay * NS_PER_SEC >= INTERVAL_PUBLISH_NS)
+            clientPublishCounters(true);
           rc = nanosleep((const struct timespec*)&reqDelay, &remDelay);
         
       }
@@ -476,12 +1066,956 @@ int main(int argc, char *argv[])
   exit(0);
 }
 
-// Handler for SIGALRM
-void CatchAlarm(int ignored) {
-  numberTOs++;
+/*************************************************************
+*
+* Function: void openReplyWait(int sock)
+*
+* Summary: Sets up the opMode 0 stop-and-wait receive: a timerfd for
+*          the rto and an epoll set holding it and the socket
+*
+***************************************************************/
+void openReplyWait(int sock)
+{
+  struct epoll_event event;
+
+  replyTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (replyTimer < 0)
+    DieWithSystemMessage("timerfd_create() failed");
+  replyEpoll = epoll_create1(EPOLL_CLOEXEC);
+  if (replyEpoll < 0)
+    DieWithSystemMessage("epoll_create1() failed");
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = sock;
+  if (epoll_ctl(replyEpoll, EPOLL_CTL_ADD, sock, &event) < 0)
+    DieWithSystemMessage("epoll_ctl() failed");
+  event.data.fd = replyTimer;
+  if (epoll_ctl(replyEpoll, EPOLL_CTL_ADD, replyTimer, &event) < 0)
+    DieWithSystemMessage("epoll_ctl() failed");
+}
+
+/*************************************************************
+*
+* Function: int waitForReply(int sock, char *RxBuffer, int32_t messageSize,
+*               uint64_t sequenceNum, int64_t Tstart, messageHeaderDefault *RxHeader,
+*               ssize_t *numBytes, int64_t *Tstop, int64_t *kernelRxTime)
+*
+* Summary: opMode 0 stop-and-wait receive.  Waits in epoll_wait() for
+*          the reply to probe sequenceNum, sent at Tstart, or for the
+*          timerfd armed with the probe's rto.  Replies to probes that
+*          already timed out are counted as late and skipped, they
+*          would otherwise be taken for this probe's reply.  In busy
+*          poll mode it spins on the receive and the clock instead.
+*
+* Inputs:
+*   int sock : the client socket, in the set openReplyWait() made
+*   char *RxBuffer : messageSize byte receive buffer
+*
+* outputs:  
+*   returns REPLY_MATCHED with the reply in RxBuffer, its header in
+*   RxHeader, its length, arrival time and kernel RX timestamp set;
+*   REPLY_TIMEOUT, REPLY_ERROR after a receive error, or REPLY_STOPPED
+*   if a stop was requested (see signalControl.h)
+*
+***************************************************************/
+int waitForReply(int sock, char *RxBuffer, int32_t messageSize, uint64_t sequenceNum, int64_t Tstart,
+                 messageHeaderDefault *RxHeader, ssize_t *numBytes, int64_t *Tstop, int64_t *kernelRxTime)
+{
+  struct sockaddr_storage fromAddr;
+  socklen_t fromAddrLen = 0;
+  struct epoll_event events[2];
+  struct itimerspec timer;
+  uint64_t expirations = 0;
+  int64_t deadline = Tstart + rtoCurrent(&probeRto);
+  int64_t waitNs = deadline - timeNowNs();
+  bool timedOut = false;
+  int numEvents;
+  int i;
+
+  //A relative timer, timeNowNs() may be a clock the kernel does not know
+  memset(&timer, 0, sizeof(timer));
+  if (waitNs < 1)
+    waitNs = 1;
+  timer.it_value.tv_sec = (time_t)(waitNs / NS_PER_SEC);
+  timer.it_value.tv_nsec = (long)(waitNs % NS_PER_SEC);
+  if ((!lowLatency.busyPoll) && (timerfd_settime(replyTimer, 0, &timer, NULL) < 0))
+    DieWithSystemMessage("timerfd_settime() failed");
+
+  for (;;) {
+    //What has arrived goes first, a reply racing the timer still counts
+    fromAddrLen = sizeof(fromAddr);
+    *numBytes = recvWithTimestamp(sock, RxBuffer, messageSize, MSG_DONTWAIT,
+                                  (struct sockaddr *) &fromAddr, &fromAddrLen, kernelRxTime);
+    if (*numBytes >= 0) {
+      *Tstop = timeNowNs();
+      if (*numBytes < MESSAGE_HEADER_SIZE) {
+        RxErrorCount++;
+        continue;
+      }
+      unpackMessageHeader(RxBuffer, RxHeader);
+      if (RxHeader->sequenceNum > largestSeqRecv)
+        largestSeqRecv = RxHeader->sequenceNum;
+      seqTrackerUpdate(&replySequence, RxHeader->sequenceNum);
+      if (RxHeader->sequenceNum != sequenceNum) {
+        lateReplies++;
+        continue;
+      }
+      memset(&timer, 0, sizeof(timer));
+      timerfd_settime(replyTimer, 0, &timer, NULL);
+      return REPLY_MATCHED;
+    }
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+      RxErrorCount++;
+      perror("client: recvfrom other error \n");
+      return REPLY_ERROR;
+    }
+    if (timedOut)
+      return REPLY_TIMEOUT;
+    if (signalStopRequested())
+      return REPLY_STOPPED;
+
+    if (lowLatency.busyPoll) {
+      emptyPolls++;
+      timedOut = (timeNowNs() >= deadline);
+      continue;
+    }
+    numEvents = epoll_wait(replyEpoll, events, 2, -1);
+    for (i = 0; i < numEvents; i++) {
+      if ((events[i].data.fd == replyTimer) &&
+          (read(replyTimer, &expirations, sizeof(expirations)) == sizeof(expirations)))
+        timedOut = true;
+    }
+  }
+}
+
+/*************************************************************
+*
+* Function: void runWindowedLoop(int sock, struct addrinfo *servAddr,
+*               char *TxBuffer, char *RxBuffer, int32_t messageSize,
+*               int32_t nIterations, bool loopForever, double iterationDelay)
+*
+* Summary: Pipelined opMode 0.  Keeps up to windowSize probes in flight,
+*          sending a new one every iterationDelay seconds while the
+*          window has room.  Replies are matched to their probe by
+*          sequence number so each RTT is measured against the send
+*          time of the probe it echoes.  Probes outstanding longer than
+*          their rto are counted as timeouts and leave the window.
+*          A probe that fails to send is only counted in TxErrorCount.
+*
+* Inputs:
+*   int sock : the client socket
+*   struct addrinfo *servAddr : the server to probe
+*   char *TxBuffer, *RxBuffer : messageSize byte send and receive buffers
+*   int32_t nIterations : number of probes to send unless loopForever
+*   double iterationDelay : seconds between sends
+*
+* outputs:  updates the global stats, returns once every probe has
+*           been answered or has timed out, or at a stop signal
+*
+***************************************************************/
+void runWindowedLoop(int sock, struct addrinfo *servAddr, char *TxBuffer, char *RxBuffer,
+                     int32_t messageSize, int32_t nIterations, bool loopForever, double iterationDelay)
+{
+  messageHeaderDefault TxHeader;
+  messageHeaderDefault RxHeader;
+  struct sockaddr_storage fromAddr;
+  socklen_t fromAddrLen = 0;
+  struct pollfd pollSock;
+  struct timespec waitTime;
+  uint64_t sequenceNumber = 1;
+  bool sending = true;
+  int64_t delayNs = (int64_t)(iterationDelay * NS_PER_SEC);
+  int64_t nextSendTime = 0;
+  int64_t now = 0;
+  int64_t deadline = 0;
+  int64_t waitNs = 0;
+  int64_t Tstart = 0;
+  int64_t Tstop = 0;
+  int64_t RTTNs = 0;
+  int64_t rto = 0;
+  uint32_t expired = 0;
+  double RTTSample = 0.0;
+  double smoothedRTT = 0.0;
+  double alpha = 0.10;
+  ssize_t numBytes = 0;
+  int64_t kernelRxTime = 0;
+  int64_t tsTime = 0;
+  uint32_t tsKey = 0;
+  char *txBuf = NULL;
+  //TX timestamp IDs count successful sends, this maps them back to sequence numbers
+  uint64_t *txKeySeq = NULL;
+  uint32_t txKey = 0;
+
+  if (probeWindowInit(&window, windowSize, sequenceNumber) != SUCCESS) {
+    printf("client: HARD ERROR malloc of %d probe slots failed \n", windowSize);
+    exit(1);
+  }
+  txKeySeq = calloc(windowSize, sizeof(uint64_t));
+  if (txKeySeq == NULL) {
+    printf("client: HARD ERROR malloc of %d probe slots failed \n", windowSize);
+    exit(1);
+  }
+
+  pollSock.fd = sock;
+  pollSock.events = POLLIN;
+  nextSendTime = timeNowNs();
+
+  while (sending || (window.inFlight > 0))
+  {
+    if (signalStopRequested())
+      break;
+    clientPublishCounters(false);
+    now = timeNowNs();
+
+    //Send as many probes as the window and the pacing allow
+    while (sending && probeWindowCanSend(&window) && (now >= nextSendTime)) {
+      if ((!loopForever) && (numberOfTrials >= (uint64_t)nIterations)) {
+        //the main loop counts one trial past the end, keep the summary the same
+        numberOfTrials++;
+        sending = false;
+        break;
+      }
+      lastMsgTxWallTime = timeWallNs();
+      TxHeader.sequenceNum = sequenceNumber++;
+      TxHeader.timeSentSeconds = (uint32_t)(lastMsgTxWallTime / NS_PER_SEC);
+      TxHeader.timeSentNanoSeconds = (uint32_t)(lastMsgTxWallTime % NS_PER_SEC);
+      TxHeader.opMode = opMode;
+      TxHeader.flags = echoTimestamps ? MSG_FLAG_TIMESTAMPS : 0;
+
+      //pack the header into the network buffer
+      txBuf = nextTxBuffer(TxBuffer);
+      packMessageHeader(txBuf, &TxHeader);
+      numberOfTrials++;
+
+      Tstart = timeNowNs();
+      numBytes = sendTxBuffer(sock, txBuf, messageSize, servAddr);
+      if (numBytes < 0) {
+        //A failed send is a trial, but not a probe to wait for or time out
+        TxErrorCount++;
+        perror("client: sendto error \n");
+      } else {
+        totalBytesSent += numBytes;
+        txKeySeq[txKey % windowSize] = TxHeader.sequenceNum;
+        txKey++;
+        probeWindowSent(&window, TxHeader.sequenceNum, Tstart);
+      }
+
+      //Keep to the schedule, but do not burst to catch up after a stall
+      nextSendTime += delayNs;
+      now = timeNowNs();
+      if (nextSendTime < now - delayNs)
+        nextSendTime = now;
+    }
+
+    rto = rtoCurrent(&probeRto);
+    expired = probeWindowExpire(&window, now, rto);
+    if (expired > 0) {
+      numberTOs += expired;
+      rtoTimeout(&probeRto);
+    }
+    if ((!sending) && (window.inFlight == 0))
+      break;
+
+    //Sleep until a reply, the next send or the next timeout
+    waitNs = TIMEOUT_NS;
+    deadline = probeWindowNextDeadline(&window, rtoCurrent(&probeRto));
+    if (deadline > 0)
+      waitNs = deadline - now;
+    if (sending && probeWindowCanSend(&window) && (nextSendTime - now < waitNs))
+      waitNs = nextSendTime - now;
+    if (waitNs < 0)
+      waitNs = 0;
+    waitTime.tv_sec = (time_t)(waitNs / NS_PER_SEC);
+    waitTime.tv_nsec = (long)(waitNs % NS_PER_SEC);
+
+    //Busy polling goes straight to the receive below
+    if ((!lowLatency.busyPoll) && (ppoll(&pollSock, 1, &waitTime, NULL) <= 0))
+      continue;
+
+    //TX timestamps first, so they are attached before their replies are matched
+    while (kernelTimestamps && (readTxTimestamp(sock, &tsKey, &tsTime) == 1)) {
+      if (txKey - tsKey <= windowSize)
+        probeWindowSetKernelTx(&window, txKeySeq[tsKey % windowSize], tsTime);
+    }
+
+    //Drain every reply that is queued
+    for (;;) {
+      fromAddrLen = sizeof(fromAddr);
+      numBytes = recvWithTimestamp(sock, RxBuffer, messageSize, MSG_DONTWAIT,
+                          (struct sockaddr *) &fromAddr, &fromAddrLen, &kernelRxTime);
+      if (numBytes < 0) {
+        if (errno == EINTR)
+          continue;
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+          RxErrorCount++;
+          perror("client: recvfrom other error \n");
+        } else if (lowLatency.busyPoll) {
+          emptyPolls++;
+        }
+        break;
+      }
+      Tstop = timeNowNs();
+      if (numBytes < MESSAGE_HEADER_SIZE) {
+        RxErrorCount++;
+        continue;
+      }
+
+      unpackMessageHeader(RxBuffer, &RxHeader);
+      if (RxHeader.sequenceNum > largestSeqRecv)
+        largestSeqRecv = RxHeader.sequenceNum;
+      seqTrackerUpdate(&replySequence, RxHeader.sequenceNum);
+
+      //Late, duplicate and unknown replies are only counted by the window
+      tsTime = probeWindowKernelTx(&window, RxHeader.sequenceNum);
+      if (probeWindowAck(&window, RxHeader.sequenceNum, Tstop, &RTTNs) != PROBE_MATCHED)
+        continue;
+      rtoSample(&probeRto, RTTNs);
+      RTTSample = pickRTTSample(RTTNs, tsTime, kernelRxTime);
+      recordEchoTimestamps(RxBuffer, numBytes, &RxHeader, tsTime, kernelRxTime);
+
+      receivedCount++;
+      RTTSum += RTTSample;
+      numberRTTSamples++;
+      histogramRecord(&RTTHistogram, RTTSample);
+      smoothedRTT = (1-alpha)*smoothedRTT + alpha*RTTSample;
+      wallTime = getCurTimeD();
+      reportRTTSample(RTTSample, smoothedRTT);
+    }
+  }
+  free(txKeySeq);
 }
 
+/*************************************************************
+*
+* Function: double pickRTTSample(int64_t userRTT, int64_t kernelTxTime,
+*                                int64_t kernelRxTime)
+*
+* Summary: Chooses the RTT sample to use.  With -T and both kernel
+*          timestamps present it is the kernel RTT, otherwise the
+*          user space one.
+*
+* Inputs:
+*   int64_t userRTT : RTT in ns from clock reads around sendto/recvfrom
+*   int64_t kernelTxTime, kernelRxTime : kernel timestamps in ns, 0 if missing
+*
+* outputs:  
+*   returns the RTT sample in seconds and counts it in the timestamp stats
+*
+***************************************************************/
+double pickRTTSample(int64_t userRTT, int64_t kernelTxTime, int64_t kernelRxTime)
+{
+  double kernelRTT = 0.0;
+
+  if ((!kernelTimestamps) || (kernelTxTime <= 0) || (kernelRxTime <= 0))
+    return nsToSecs(userRTT);
+
+  kernelRTT = nsToSecs(kernelRxTime - kernelTxTime);
+  kernelRTTSamples++;
+  kernelRTTSum += kernelRTT;
+  userRTTSum += nsToSecs(userRTT);
+  return kernelRTT;
+}
+
+/*************************************************************
+*
+* Function: void runSegmentedLoop(int sock, struct addrinfo *servAddr,
+*               char *TxBuffer, char *RxBuffer, int32_t messageSize,
+*               int32_t nIterations, bool loopForever)
+*
+* Summary: opMode 1 and 2 with GSO.  Gathers up to gsoSegments paced
+*          datagrams into TxBuffer and sends them with one UDP_SEGMENT
+*          sendmsg().  The pacer still releases each datagram, so the
+*          rate and the pacing stats hold; the headers are stamped
+*          with one clock read just before the send.
+*
+* Inputs:
+*   char *TxBuffer : room for gsoSegments datagrams of messageSize bytes
+*   int32_t nIterations : number of datagrams to send unless loopForever
+*
+* outputs:  updates the global stats, returns once every datagram is
+*           sent and, in LIMITED_RTT, the last probe is answered or
+*           has timed out, or at a stop signal
+*
+***************************************************************/
+void runSegmentedLoop(int sock, struct addrinfo *servAddr, char *TxBuffer, char *RxBuffer,
+                      int32_t messageSize, int32_t nIterations, bool loopForever)
+{
+  messageHeaderDefault TxHeader;
+  uint64_t sequenceNumber = 1;
+  uint64_t burstFirstSeq = 0;
+  uint16_t burstFlags[UDP_MAX_GSO_SEGMENTS];
+  uint32_t count = 0;
+  uint32_t i = 0;
+  int32_t probeIndex = -1;
+  int64_t Tstart = 0;
+  ssize_t numBytes = 0;
+  char *txBuf = NULL;
+
+  while ((loopForever || (numberOfTrials < (uint64_t)nIterations)) && (!signalStopRequested())) {
+    clientPublishCounters(false);
+    count = 0;
+    probeIndex = -1;
+    burstFirstSeq = sequenceNumber;
+    while ((count < gsoSegments) && (loopForever || (numberOfTrials < (uint64_t)nIterations))) {
+      pacerWait(&txPacer);
+      burstFlags[count] = (probeIndex < 0) ? nextProbeFlags() : 0;
+      if (echoTimestamps)
+        burstFlags[count] |= MSG_FLAG_TIMESTAMPS;
+      if (burstFlags[count] & MSG_FLAG_ECHO_REQUEST)
+        probeIndex = count;
+      sequenceNumber++;
+      numberOfTrials++;
+      count++;
+    }
+
+    txBuf = nextTxBuffer(TxBuffer);
+    lastMsgTxWallTime = timeWallNs();
+    for (i = 0; i < count; i++) {
+      TxHeader.sequenceNum = burstFirstSeq + i;
+      TxHeader.timeSentSeconds = (uint32_t)(lastMsgTxWallTime / NS_PER_SEC);
+      TxHeader.timeSentNanoSeconds = (uint32_t)(lastMsgTxWallTime % NS_PER_SEC);
+      TxHeader.opMode = opMode;
+      TxHeader.flags = burstFlags[i];
+      packMessageHeader(txBuf + (size_t)i * messageSize, &TxHeader);
+    }
 
+    Tstart = timeNowNs();
+    numBytes = sendSegments(sock, txBuf, (size_t)count * messageSize, (uint16_t)messageSize,
+                            servAddr->ai_addr, servAddr->ai_addrlen, zeroCopy ? MSG_ZEROCOPY : 0);
+    if (zeroCopy) {
+      if ((numBytes < 0) && (errno == ENOBUFS)) {
+        //out of option memory for zero copy, send this one normally
+        txPool.fallbackCount++;
+        numBytes = sendSegments(sock, txBuf, (size_t)count * messageSize, (uint16_t)messageSize,
+                                servAddr->ai_addr, servAddr->ai_addrlen, 0);
+      } else if (numBytes >= 0) {
+        zeroCopySent(&txPool, txBuf);
+      }
+      zeroCopyPut(&txPool, txBuf);
+    }
+    gsoSendCount++;
+    if (numBytes < 0) {
+      TxErrorCount += count;
+      perror("client: sendmsg(UDP_SEGMENT) error \n");
+      continue;
+    }
+    totalBytesSent += numBytes;
+    if (firstTxTime == 0)
+      firstTxTime = Tstart;
+    lastTxTime = Tstart;
+    streamPackets += count;
+
+    if (opMode == LIMITED_RTT) {
+      if (probeIndex >= 0) {
+        probeOutstanding = true;
+        probeSeq = burstFirstSeq + probeIndex;
+        probeTxTime = Tstart;
+        probesSent++;
+      }
+      collectProbeReplies(sock, RxBuffer, messageSize, 0);
+    }
+  }
+  //the main loop counts one trial past the end, keep the summary the same
+  numberOfTrials++;
+  if (opMode == LIMITED_RTT)
+    collectProbeReplies(sock, RxBuffer, messageSize, probeTxTime + rtoCurrent(&probeRto) - timeNowNs());
+}
+
+/*************************************************************
+*
+* Function: char *nextTxBuffer(char *TxBuffer)
+*
+* Summary: The buffer to build the next send in: with -Z a free pool
+*          buffer, since the previous ones may still be in flight,
+*          otherwise TxBuffer itself.
+*
+***************************************************************/
+char *nextTxBuffer(char *TxBuffer)
+{
+  if (!zeroCopy)
+    return TxBuffer;
+  return zeroCopyGetBuffer(&txPool);
+}
+
+/*************************************************************
+*
+* Function: ssize_t sendTxBuffer(int sock, char *buffer, size_t len,
+*                                struct addrinfo *servAddr)
+*
+* Summary: Sends a buffer from nextTxBuffer() to the server, with -Z
+*          as a MSG_ZEROCOPY send, and hands the buffer back to the pool.
+*
+* outputs:  
+*   returns what sendto() returned
+*
+***************************************************************/
+ssize_t sendTxBuffer(int sock, char *buffer, size_t len, struct addrinfo *servAddr)
+{
+  ssize_t numBytes;
+
+  if (!zeroCopy)
+    return sendto(sock, buffer, len, 0, servAddr->ai_addr, servAddr->ai_addrlen);
+  numBytes = zeroCopySendto(&txPool, buffer, len, servAddr->ai_addr, servAddr->ai_addrlen);
+  zeroCopyPut(&txPool, buffer);
+  return numBytes;
+}
+
+/*************************************************************
+*
+* Function: uint16_t nextProbeFlags()
+*
+* Summary: Header flags for the next datagram of the stream.  In
+*          LIMITED_RTT it is marked MSG_FLAG_ECHO_REQUEST when no probe
+*          is outstanding; a probe unanswered for its rto is
+*          counted as a timeout and given up on first.
+*
+***************************************************************/
+uint16_t nextProbeFlags()
+{
+  if (opMode != LIMITED_RTT)
+    return 0;
+  if (probeOutstanding && (timeNowNs() - probeTxTime > rtoCurrent(&probeRto))) {
+    probeTimeouts++;
+    numberTOs++;
+    probeOutstanding = false;
+    timedOutProbeSeq = probeSeq;
+    rtoTimeout(&probeRto);
+  }
+  return probeOutstanding ? 0 : MSG_FLAG_ECHO_REQUEST;
+}
+
+/*************************************************************
+*
+* Function: void runThroughputSearch(int sock, struct addrinfo *servAddr,
+*                                    char *TxBuffer, char *RxBuffer)
+*
+* Summary: -A: for each message size, searches for the highest packet
+*          rate whose trials stay within searchMaxLoss (see rateSearch.h)
+*          and prints it, then exits.
+*
+* Inputs:
+*   TxBuffer, RxBuffer : buffers of the largest size searched
+*
+* outputs:  does not return
+*
+* notes:
+*   Without -R or -r the first trial sends as fast as the client can,
+*   its achieved rate is then the ceiling the search runs below.  A
+*   SIGINT or SIGTERM ends the search after the trial in progress.
+*
+***************************************************************/
+void runThroughputSearch(int sock, struct addrinfo *servAddr, char *TxBuffer, char *RxBuffer)
+{
+  rateSearch search;
+  uint64_t sequenceNumber = 1;
+  uint64_t sent = 0;
+  uint64_t received = 0;
+  double ceilingPps = 0.0;
+  double offeredPps = 0.0;
+  double achievedPps = 0.0;
+  double loss = 0.0;
+  bool passed = false;
+  uint32_t i;
+
+  for (i = 0; (i < searchSizeCount) && (!signalStopRequested()); i++) {
+    int32_t size = searchSizes[i];
+    pacedMessageSize = size;
+    ceilingPps = searchCeilingPps;
+    if (targetBitRate > 0.0)
+      ceilingPps = targetBitRate / (8.0 * (double)size);
+    if (ceilingPps <= 0.0) {
+      loss = runSearchTrial(sock, servAddr, TxBuffer, RxBuffer, size, 0.0, &sequenceNumber,
+                            &sent, &received, &achievedPps);
+      if (loss < 0.0)
+        break;
+      ceilingPps = achievedPps;
+      rateSearchInit(&search, ceilingPps, searchMaxLoss, searchResolution, RATE_SEARCH_MAX_TRIALS);
+      passed = rateSearchResult(&search, ceilingPps, achievedPps, loss);
+      printf("UDPEchoV2:Client:SearchTrial:  %d %12.1f %12.1f %llu %llu %2.6f %d\n",
+            size, 0.0, achievedPps, (unsigned long long)sent, (unsigned long long)received, loss, passed);
+    } else {
+      rateSearchInit(&search, ceilingPps, searchMaxLoss, searchResolution, RATE_SEARCH_MAX_TRIALS);
+    }
+    while ((offeredPps = rateSearchNext(&search)) > 0.0) {
+      loss = runSearchTrial(sock, servAddr, TxBuffer, RxBuffer, size, offeredPps, &sequenceNumber,
+                            &sent, &received, &achievedPps);
+      if (loss < 0.0)
+        break;
+      passed = rateSearchResult(&search, offeredPps, achievedPps, loss);
+      printf("UDPEchoV2:Client:SearchTrial:  %d %12.1f %12.1f %llu %llu %2.6f %d\n",
+            size, offeredPps, achievedPps, (unsigned long long)sent, (unsigned long long)received, loss, passed);
+    }
+    printf("UDPEchoV2:Client:Throughput:  %d %12.1f %14.1f %12.1f %2.6f %d\n",
+          size, search.passPps, search.passPps * 8.0 * size, search.passAchievedPps,
+          search.passLoss, search.trialCount);
+  }
+  signalControlStop();
+  intervalReportStop(&reporter);
+  statsShmClose(&liveStats);
+  packetLogClose(&rxLog);
+  close(sock);
+  exit(0);
+}
+
+/*************************************************************
+*
+* Function: double runSearchTrial(int sock, struct addrinfo *servAddr,
+*               char *TxBuffer, char *RxBuffer, int32_t size, double pps,
+*               uint64_t *sequenceNumber, uint64_t *sent, uint64_t *received,
+*               double *achievedPps)
+*
+* Summary: One search trial: searchWarmupSecs of echoed datagrams of
+*          size bytes at pps that are not counted, then searchTrialSecs
+*          that are, then up to RATE_SEARCH_DRAIN_NS for the last replies.
+*
+* Inputs:
+*   double pps : offered packets/sec, 0 sends unpaced
+*   uint64_t *sequenceNumber : the next sequence number, kept across
+*                              trials so a late reply is never counted twice
+*
+* outputs:  
+*   returns the loss of the counted datagrams, 0 to 1, or -1 if a stop
+*   was requested.  Fills in the datagrams sent and echoed and the rate
+*   they were sent at.
+*
+* notes:
+*   The socket is read every RATE_SEARCH_READ_EVERY sends rather than
+*   after each one, so the replies cost the sender few system calls;
+*   the receive buffer holds that many easily.
+*
+***************************************************************/
+double runSearchTrial(int sock, struct addrinfo *servAddr, char *TxBuffer, char *RxBuffer,
+                      int32_t size, double pps, uint64_t *sequenceNumber,
+                      uint64_t *sent, uint64_t *received, double *achievedPps)
+{
+  messageHeaderDefault TxHeader;
+  struct pollfd pollSock;
+  char *txBuf = NULL;
+  ssize_t numBytes = 0;
+  uint64_t firstSeq = UINT64_MAX;
+  uint64_t sends = 0;
+  int64_t now = timeNowNs();
+  int64_t phaseEnd = now + (int64_t)(searchWarmupSecs * NS_PER_SEC);
+  int64_t deadline = 0;
+  bool measuring = false;
+
+  *sent = 0;
+  *received = 0;
+  *achievedPps = 0.0;
+  memset(&TxHeader, 0, sizeof(TxHeader));
+  TxHeader.opMode = PING_MODE;
+  pacerInit(&txPacer, pps, pacerBurst, pacerSpinNs);
+  for (;;) {
+    if (signalStopRequested())
+      return -1.0;
+    clientPublishCounters(false);
+    now = timeNowNs();
+    if (now >= phaseEnd) {
+      if (measuring)
+        break;
+      //The warm-up is over, restart the pacer so its achieved rate is the trial's
+      measuring = true;
+      firstSeq = *sequenceNumber;
+      pacerInit(&txPacer, pps, pacerBurst, pacerSpinNs);
+      phaseEnd = now + (int64_t)(searchTrialSecs * NS_PER_SEC);
+    }
+    pacerWait(&txPacer);
+
+    lastMsgTxWallTime = timeWallNs();
+    TxHeader.sequenceNum = (*sequenceNumber)++;
+    TxHeader.timeSentSeconds = (uint32_t)(lastMsgTxWallTime / NS_PER_SEC);
+    TxHeader.timeSentNanoSeconds = (uint32_t)(lastMsgTxWallTime % NS_PER_SEC);
+    txBuf = nextTxBuffer(TxBuffer);
+    packMessageHeader(txBuf, &TxHeader);
+    numberOfTrials++;
+    if (measuring)
+      (*sent)++;
+    //A failed send is the sender's own loss, it counts against the trial
+    numBytes = sendTxBuffer(sock, txBuf, size, servAddr);
+    if (numBytes != size)
+      TxErrorCount++;
+    else
+      totalBytesSent += numBytes;
+    if ((++sends % RATE_SEARCH_READ_EVERY) == 0)
+      *received += drainSearchReplies(sock, RxBuffer, size, firstSeq, *sequenceNumber);
+  }
+  *achievedPps = pacerAchievedRate(&txPacer);
+
+  //The replies still on their way
+  pollSock.fd = sock;
+  pollSock.events = POLLIN;
+  deadline = timeNowNs() + RATE_SEARCH_DRAIN_NS;
+  for (;;) {
+    *received += drainSearchReplies(sock, RxBuffer, size, firstSeq, *sequenceNumber);
+    now = timeNowNs();
+    if ((*received >= *sent) || (now >= deadline) || signalStopRequested())
+      break;
+    poll(&pollSock, 1, (int)((deadline - now) / 1000000) + 1);
+  }
+  if (*sent == 0)
+    return 0.0;
+  return 1.0 - (double)*received / (double)*sent;
+}
+
+/*************************************************************
+*
+* Function: uint64_t drainSearchReplies(int sock, char *RxBuffer,
+*                   int32_t size, uint64_t firstSeq, uint64_t endSeq)
+*
+* Summary: Reads every reply queued on the socket
+*
+* outputs:  
+*   returns the replies to sequence numbers from firstSeq up to but not
+*   including endSeq, those of the trial being counted
+*
+***************************************************************/
+uint64_t drainSearchReplies(int sock, char *RxBuffer, int32_t size, uint64_t firstSeq, uint64_t endSeq)
+{
+  messageHeaderDefault RxHeader;
+  ssize_t numBytes = 0;
+  uint64_t count = 0;
+
+  for (;;) {
+    numBytes = recv(sock, RxBuffer, size, MSG_DONTWAIT);
+    if (numBytes < 0) {
+      if (errno == EINTR)
+        continue;
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+        RxErrorCount++;
+        perror("client: recv other error \n");
+      }
+      return count;
+    }
+    if (numBytes < MESSAGE_HEADER_SIZE) {
+      RxErrorCount++;
+      continue;
+    }
+    unpackMessageHeader(RxBuffer, &RxHeader);
+    receivedCount++;
+    if (RxHeader.sequenceNum > largestSeqRecv)
+      largestSeqRecv = RxHeader.sequenceNum;
+    seqTrackerUpdate(&replySequence, RxHeader.sequenceNum);
+    if ((RxHeader.sequenceNum >= firstSeq) && (RxHeader.sequenceNum < endSeq))
+      count++;
+  }
+}
+
+/*************************************************************
+*
+* Function: void recordEchoTimestamps(char *RxBuffer, ssize_t numBytes,
+*               messageHeaderDefault *RxHeader, int64_t kernelTxTime,
+*               int64_t kernelRxTime)
+*
+* Summary: With -O, adds a matched reply's four timestamps to the clock
+*          offset estimate.  Called right after the reply was received.
+*
+* Inputs:
+*   char *RxBuffer, ssize_t numBytes : the reply
+*   messageHeaderDefault *RxHeader : its unpacked header, which holds
+*                                    the time the probe was sent
+*   int64_t kernelTxTime, kernelRxTime : kernel timestamps in ns, used
+*                                        for t1 and t4 when there are both
+*
+***************************************************************/
+void recordEchoTimestamps(char *RxBuffer, ssize_t numBytes, messageHeaderDefault *RxHeader,
+                          int64_t kernelTxTime, int64_t kernelRxTime)
+{
+  int64_t clientRxTime;
+  int64_t clientTxTime;
+  int64_t serverRxTime = 0;
+  int64_t serverTxTime = 0;
+
+  if (!echoTimestamps)
+    return;
+  clientRxTime = timeWallNs();
+  clientTxTime = (int64_t)RxHeader->timeSentSeconds * NS_PER_SEC + RxHeader->timeSentNanoSeconds;
+  if ((kernelTxTime > 0) && (kernelRxTime > 0)) {
+    clientTxTime = kernelTxTime;
+    clientRxTime = kernelRxTime;
+  }
+  if (numBytes >= MESSAGE_EXT_HEADER_SIZE)
+    unpackServerTimestamps(RxBuffer, &serverRxTime, &serverTxTime);
+  if ((serverRxTime == 0) || (serverTxTime == 0)) {
+    unstampedReplies++;
+    return;
+  }
+  clockOffsetSample(&clockOffset, clientTxTime, serverRxTime, serverTxTime, clientRxTime);
+}
+
+/*************************************************************
+*
+* Function: void collectProbeReplies(int sock, char *RxBuffer,
+*                                    int32_t messageSize, int64_t maxWait)
+*
+* Summary: LIMITED_RTT receive side.  Reads the replies waiting on the
+*          socket and takes an RTT sample from the one that echoes the
+*          outstanding probe, which frees the stream to mark the next.
+*
+* Inputs:
+*   int sock : the client socket
+*   char *RxBuffer : messageSize byte receive buffer
+*   int64_t maxWait : ns to wait for the probe's reply, 0 only
+*                     reads what has already arrived
+*
+* outputs:  updates the global stats, returns once the socket is empty
+*           and either the probe is answered or maxWait has passed
+*
+***************************************************************/
+void collectProbeReplies(int sock, char *RxBuffer, int32_t messageSize, int64_t maxWait)
+{
+  struct sockaddr_storage fromAddr;
+  socklen_t fromAddrLen = 0;
+  struct pollfd pollSock;
+  messageHeaderDefault RxHeader;
+  int64_t deadline = timeNowNs() + maxWait;
+  int64_t waitNs = 0;
+  int64_t Tstop = 0;
+  double RTTSample = 0.0;
+  double alpha = 0.10;
+  ssize_t numBytes = 0;
+
+  pollSock.fd = sock;
+  pollSock.events = POLLIN;
+  for (;;) {
+    fromAddrLen = sizeof(fromAddr);
+    numBytes = recvfrom(sock, RxBuffer, messageSize, MSG_DONTWAIT,
+                        (struct sockaddr *) &fromAddr, &fromAddrLen);
+    if (numBytes < 0) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+        RxErrorCount++;
+        perror("client: recvfrom other error \n");
+      }
+      waitNs = deadline - timeNowNs();
+      if ((!probeOutstanding) || (waitNs <= 0) || signalStopRequested())
+        return;
+      if (lowLatency.busyPoll)
+        emptyPolls++;
+      else
+        poll(&pollSock, 1, (int)(waitNs / 1000000) + 1);
+      continue;
+    }
+    Tstop = timeNowNs();
+    receivedCount++;
+    if (numBytes < MESSAGE_HEADER_SIZE) {
+      strayReplies++;
+      continue;
+    }
+    unpackMessageHeader(RxBuffer, &RxHeader);
+    if (RxHeader.sequenceNum > largestSeqRecv)
+      largestSeqRecv = RxHeader.sequenceNum;
+    if ((!probeOutstanding) || (RxHeader.sequenceNum != probeSeq)) {
+      if ((timedOutProbeSeq != 0) && (RxHeader.sequenceNum == timedOutProbeSeq))
+        lateReplies++;
+      strayReplies++;
+      continue;
+    }
+    probeOutstanding = false;
+    rtoSample(&probeRto, Tstop - probeTxTime);
+    recordEchoTimestamps(RxBuffer, numBytes, &RxHeader, 0, 0);
+    RTTSample = nsToSecs(Tstop - probeTxTime);
+    RTTSum += RTTSample;
+    numberRTTSamples++;
+    histogramRecord(&RTTHistogram, RTTSample);
+    probeSmoothedRTT = (1-alpha)*probeSmoothedRTT + alpha*RTTSample;
+    wallTime = getCurTimeD();
+    reportRTTSample(RTTSample, probeSmoothedRTT);
+  }
+}
+
+/*************************************************************
+*
+* Function: void reportRTTSample(double RTTSample, double smoothedRTT)
+*
+* Summary: Emits the per iteration line for a reply, either printed
+*          or, with -L, queued as a binary record for the log thread.
+*
+***************************************************************/
+void reportRTTSample(double RTTSample, double smoothedRTT)
+{
+  packetLogRecord record;
+
+  if (logFile == NULL) {
+    if (reportInterval > 0.0)
+      return;
+    printf("%f %4.9f %4.9f %llu %d\n", 
+          wallTime, RTTSample, smoothedRTT, 
+          (unsigned long long)receivedCount,  numberRTTSamples);
+    return;
+  }
+  memset(&record, 0, sizeof(record));
+  record.recordType = PACKET_LOG_CLIENT_RTT;
+  record.receivedCount = receivedCount;
+  record.numberSamples = numberRTTSamples;
+  record.wallTime = wallTime;
+  record.sample = RTTSample;
+  record.smoothed = smoothedRTT;
+  packetLogAppend(&rxLog, 0, &record);
+}
+
+
+/*************************************************************
+*
+* Function: void clientPublishCounters(bool force)
+*
+* Summary: Copies the global stats into clientPublished for the threads
+*          that report them.  Called by the thread that counts, at the
+*          top of each send loop, so the stats are never read while they
+*          change.
+*
+* Inputs:
+*   bool force : publish now rather than once INTERVAL_PUBLISH_NS passed
+*
+***************************************************************/
+void clientPublishCounters(bool force)
+{
+  intervalCounters *counters;
+  int64_t now = timeNowNs();
+
+  if ((!force) && (!intervalPublishDue(&clientPublished, now)))
+    return;
+  counters = intervalPublishBegin(&clientPublished);
+  memset(counters, 0, offsetof(intervalCounters, latency));
+  counters->sentCount = numberOfTrials;
+  counters->sentBytes = totalBytesSent;
+  counters->receivedCount = receivedCount;
+  counters->receivedBytes = receivedCount * pacedMessageSize;
+  counters->RxErrorCount = RxErrorCount;
+  counters->TxErrorCount = TxErrorCount;
+  counters->timeoutCount = numberTOs + probeTimeouts;
+  if (opMode == PING_MODE) {
+    //replySequence starts at 1, highestSeq is the number of replies there should be
+    counters->expectedCount = replySequence.highestSeq;
+    counters->arrivedCount = replySequence.inOrderCount + replySequence.reorderedCount;
+    counters->reorderedCount = replySequence.reorderedCount + replySequence.lateCount;
+  } else if (opMode == LIMITED_RTT) {
+    counters->expectedCount = numberRTTSamples + probeTimeouts;
+    counters->arrivedCount = numberRTTSamples;
+  }
+  memcpy(&counters->latency, &RTTHistogram, sizeof(latencyHistogram));
+  intervalPublishEnd(&clientPublished, now);
+}
+
+/*************************************************************
+*
+* Function: void clientIntervalSnapshot(intervalCounters *counters)
+*
+* Summary: The interval reporter's and the statistics segment's view
+*          of the global stats: what the send loop last published
+*
+***************************************************************/
+void clientIntervalSnapshot(intervalCounters *counters)
+{
+  intervalPublishRead(&clientPublished, counters);
+}
+
+/*************************************************************
+*
+* Function: void clientCNTCCode()
+*
+* Summary: Prints the end of run summary and exits.  Called by the
+*          loops once the iterations ran out or a stop was requested.
+*
+***************************************************************/
 void clientCNTCCode() 
 {
   double avgRTT  = 0.0;
@@ -492,15 +2026,33 @@ void clientCNTCCode()
   wallTime = getCurTimeD();
   endTime = wallTime;
   duration = endTime - startTime;
+  //the last interval and the segment's final counters should be exact
+  clientPublishCounters(true);
+  signalControlStop();
+  intervalReportStop(&reporter);
+  statsShmClose(&liveStats);
+  packetLogClose(&rxLog);
 
   if (numberRTTSamples > 0) {
      avgRTT = RTTSum /  (double)numberRTTSamples;
-  } 
+  }
 
-  totalLost =  (double)  numberOfTrials - numberRTTSamples;
+  if (opMode == LIMITED_RTT) {
+    //Only the probes are echoed, so the loss is theirs
+    totalLost = (double) probeTimeouts;
+    if (probesSent > 0)
+      avgLossRate = totalLost / (double)probesSent;
+  }
+  else if (opMode == ONE_WAY_MODE) {
+    //Nothing comes back, only the server can see what was lost
+    totalLost = 0;
+  }
+  else {
+    totalLost =  (double)  numberOfTrials - numberRTTSamples;
 
-  if (numberOfTrials >  0) {
-    avgLossRate = totalLost / (double)numberOfTrials;
+    if (numberOfTrials >  0) {
+      avgLossRate = totalLost / (double)numberOfTrials;
+    }
   }
 //uint32_t TxErrorCount=0;
 //uint32_t RxErrorCount=0;
@@ -514,19 +2066,146 @@ void clientCNTCCode()
   if (outputFile != NULL) {
     freopen("/dev/tty", "w", stdout); // resetting stdout to print back to the terminal
   }
+  numberOutOfOrder = replySequence.reorderedCount + replySequence.lateCount;
   double avgActualSendRate = 0.0;
-  if (opMode == 0) {
-    printf("UDPEchoV2:Client:Summary:  %12.6f %6.6f %4.9f %2.4f %d %d %d %d %6.0f %d %d %d \n",
-          wallTime, duration, avgRTT, avgLossRate, numberOfTrials, receivedCount, numberRTTSamples,numberTOs, totalLost,
+  if (opMode == PING_MODE) {
+    printf("UDPEchoV2:Client:Summary:  %12.6f %6.6f %4.9f %2.4f %llu %llu %d %d %6.0f %d %d %d \n",
+          wallTime, duration, avgRTT, avgLossRate, (unsigned long long)numberOfTrials,
+          (unsigned long long)receivedCount, numberRTTSamples,numberTOs, totalLost,
              RxErrorCount, TxErrorCount, numberOutOfOrder);
   }
-  else if (opMode == 1) {
+  else {
     avgRTT = 0;
     avgActualSendRate = totalBytesSent / duration;
-    printf("UDPEchoV2:Client:Summary:  %12.6f %6.6f %4.9f %4.9f %2.4f %d %d %d %d %6.0f %d %d %d\n",
-      wallTime, duration, avgRTT, avgActualSendRate, avgLossRate, numberOfTrials, receivedCount, numberRTTSamples,numberTOs, totalLost,
+    printf("UDPEchoV2:Client:Summary:  %12.6f %6.6f %4.9f %4.9f %2.4f %llu %llu %d %d %6.0f %d %d %d\n",
+      wallTime, duration, avgRTT, avgActualSendRate, avgLossRate, (unsigned long long)numberOfTrials,
+      (unsigned long long)receivedCount, numberRTTSamples,numberTOs, totalLost,
          RxErrorCount, TxErrorCount, numberOutOfOrder);
   }
+  if (opMode != PING_MODE) {
+    double achievedPps = pacerAchievedRate(&txPacer);
+    double pctErr[PACER_ERR_BUCKETS];
+    uint32_t i;
+    for (i = 0; i < PACER_ERR_BUCKETS; i++)
+      pctErr[i] = (txPacer.packetCount > 0) ? 100.0 * txPacer.errBuckets[i] / txPacer.packetCount : 0.0;
+    printf("UDPEchoV2:Client:Pacing:  %12.3f %12.3f %14.1f %14.1f %d %4.3f %4.3f %4.3f %4.3f %3.2f %3.2f %3.2f %3.2f %3.2f\n",
+          targetPacketRate, achievedPps,
+          targetPacketRate * 8.0 * pacedMessageSize, achievedPps * 8.0 * pacedMessageSize,
+          txPacer.burst,
+          pacerErrMean(&txPacer) / 1000.0,
+          (txPacer.packetCount > 0) ? txPacer.errMin / 1000.0 : 0.0,
+          (txPacer.packetCount > 0) ? txPacer.errMax / 1000.0 : 0.0,
+          pacerErrStdDev(&txPacer) / 1000.0,
+          pctErr[0], pctErr[1], pctErr[2], pctErr[3], pctErr[4]);
+  }
+  if (opMode == LIMITED_RTT) {
+    printf("UDPEchoV2:Client:LimitedRTT:  %d %d %d %d %4.9f\n",
+          probesSent, numberRTTSamples, probeTimeouts, strayReplies,
+          (numberRTTSamples > 0) ? RTTSum / numberRTTSamples : 0.0);
+  }
+  if (opMode == ONE_WAY_MODE) {
+    double sendDuration = nsToSecs(lastTxTime - firstTxTime);
+    printf("UDPEchoV2:Client:OneWay:  %d %d %llu %6.6f %14.1f\n",
+          streamPackets, TxErrorCount, (unsigned long long)totalBytesSent,
+          sendDuration, (sendDuration > 0.0) ? 8.0 * totalBytesSent / sendDuration : 0.0);
+  }
+  if ((opMode == PING_MODE) || ((opMode == LIMITED_RTT) && (numberRTTSamples > 0))) {
+    printf("UDPEchoV2:Client:Latency:  %d %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f\n",
+          numberRTTSamples, histogramMin(&RTTHistogram),
+          histogramPercentile(&RTTHistogram, 50.0), histogramPercentile(&RTTHistogram, 90.0),
+          histogramPercentile(&RTTHistogram, 99.0), histogramPercentile(&RTTHistogram, 99.9),
+          histogramPercentile(&RTTHistogram, 99.99), histogramMax(&RTTHistogram),
+          histogramMean(&RTTHistogram), histogramStdDev(&RTTHistogram));
+    if ((histogramFile != NULL) && (histogramDump(&RTTHistogram, histogramFile, "ClientRTT") != NOERROR))
+      perror("client: failed to write the RTT histogram ");
+  }
+  if ((opMode == PING_MODE) && kernelTimestamps) {
+    double avgUserRTT = 0.0;
+    double avgKernelRTT = 0.0;
+    if (kernelRTTSamples > 0) {
+      avgUserRTT = userRTTSum / kernelRTTSamples;
+      avgKernelRTT = kernelRTTSum / kernelRTTSamples;
+    }
+    printf("UDPEchoV2:Client:Timestamps:  %d %d %4.9f %4.9f %4.9f\n",
+          kernelRTTSamples, numberRTTSamples - kernelRTTSamples,
+          avgUserRTT, avgKernelRTT, avgUserRTT - avgKernelRTT);
+  }
+  if (echoTimestamps) {
+    double offset = 0.0;
+    double drift = 0.0;
+    double forward = 0.0;
+    double reverse = 0.0;
+    double residence = 0.0;
+    clockOffsetFit(&clockOffset, &offset, &drift);
+    clockOffsetOneWay(&clockOffset, &forward, &reverse, &residence);
+    printf("UDPEchoV2:Client:ClockOffset:  %llu %d %4.9f %4.3f %4.9f %4.9f %4.9f %4.9f %4.9f\n",
+          (unsigned long long)clockOffset.sampleCount, unstampedReplies, offset, drift * 1000000.0,
+          nsToSecs(clockOffset.minDelayNs), forward, reverse, residence,
+          nsToSecs(clockOffset.maxResidenceNs));
+  }
+  if (opMode == PING_MODE) {
+    double avgReorderDistance = 0.0;
+    if (replySequence.reorderedCount > 0)
+      avgReorderDistance = (double)replySequence.reorderDistanceSum / (double)replySequence.reorderedCount;
+    printf("UDPEchoV2:Client:Sequence:  %llu %llu %llu %llu %llu %llu %4.3f\n",
+          (unsigned long long)replySequence.inOrderCount, (unsigned long long)replySequence.reorderedCount,
+          (unsigned long long)replySequence.duplicateCount, (unsigned long long)seqTrackerLost(&replySequence),
+          (unsigned long long)replySequence.lateCount, (unsigned long long)replySequence.maxReorderDistance,
+          avgReorderDistance);
+  }
+  if (logFile != NULL) {
+    printf("UDPEchoV2:Client:Log:  %llu %llu\n",
+          (unsigned long long)rxLog.recordsWritten, (unsigned long long)packetLogDropped(&rxLog));
+  }
+  if (zeroCopy) {
+    //let the sends still in flight report how they went
+    while ((txPool.sendCount > txPool.zeroCopyCount + txPool.copiedCount) &&
+           (zeroCopyReap(&txPool, ZERO_COPY_WAIT_MS) > 0))
+      ;
+    printf("UDPEchoV2:Client:ZeroCopy:  %llu %llu %llu %llu %d\n",
+          (unsigned long long)txPool.sendCount, (unsigned long long)txPool.zeroCopyCount,
+          (unsigned long long)txPool.copiedCount, (unsigned long long)txPool.fallbackCount,
+          txPool.pinned);
+  }
+  if (gsoSegments > 1) {
+    printf("UDPEchoV2:Client:GSO:  %d %llu %4.3f\n",
+          gsoSegments, (unsigned long long)gsoSendCount,
+          (gsoSendCount > 0) ? (double)streamPackets / gsoSendCount : 0.0);
+  }
+  if (opMode != ONE_WAY_MODE) {
+    printf("UDPEchoV2:Client:RTO:  %d %d %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %2.2f\n",
+          numberTOs, ((opMode == PING_MODE) && (windowSize > 1)) ? window.lateCount : lateReplies,
+          nsToSecs(probeRto.srttNs), nsToSecs(probeRto.rttvarNs), nsToSecs(probeRto.rtoNs),
+          (probeRto.rtoMaxSeen > 0) ? nsToSecs(probeRto.rtoMinSeen) : 0.0, nsToSecs(probeRto.rtoMaxSeen),
+          nsToSecs(probeRto.minNs), probeRto.backoff);
+  }
+  if (lowLatency.busyPoll || (clientCpu >= 0) || (lowLatency.fifoRequested > 0)) {
+    printf("UDPEchoV2:Client:BusyPoll:  %d %d %d %d %d %d %llu\n",
+          lowLatency.busyPoll, lowLatency.busyPollApplied, lowLatency.memoryLocked,
+          lowLatency.fifoApplied, lowLatency.cpu, lowLatency.pinned, (unsigned long long)emptyPolls);
+  }
+  if (dropAccounting) {
+    udpSnmpCounters snmpEnd;
+    udpSnmpCounters snmpDelta;
+    int64_t socketDrops = sockDropCount(sock);
+    double transitLost = 0.0;
+    if (socketDrops < 0)
+      socketDrops = 0;
+    memset(&snmpDelta, 0, sizeof(snmpDelta));
+    if (udpSnmpRead(&snmpEnd) == NOERROR)
+      udpSnmpDelta(&snmpStart, &snmpEnd, &snmpDelta);
+    if (totalLost > (double)socketDrops)
+      transitLost = totalLost - (double)socketDrops;
+    printf("UDPEchoV2:Client:Drops:  %d %d %d %d %llu %llu %llu %llu %6.0f\n",
+          rcvbufBytes, rcvbufGranted, sndbufBytes, sndbufGranted,
+          (unsigned long long)socketDrops, (unsigned long long)snmpDelta.rcvbufErrors,
+          (unsigned long long)snmpDelta.inErrors, (unsigned long long)snmpDelta.sndbufErrors, transitLost);
+  }
+  if ((opMode == PING_MODE) && (windowSize > 1)) {
+    printf("UDPEchoV2:Client:Window:  %d %d %d %d %d %d\n",
+          windowSize, window.maxInFlight, window.lateCount, window.duplicateCount,
+          window.timeoutCount, window.unknownCount);
+  }
   exit(0);
 }
 
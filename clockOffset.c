@@ -0,0 +1,160 @@
+/*********************************************************
+* Module Name:  Clock offset estimator
+*
+* File Name:    clockOffset.c
+*
+* Summary:
+*   NTP style offset, drift and one way delays from four timestamp
+*   echoes.  See clockOffset.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+#include "clockOffset.h"
+
+static void clockOffsetFilterFlush(clockOffsetEstimator *c);
+static void clockOffsetLine(clockOffsetEstimator *c, double *intercept, double *slope);
+
+void clockOffsetInit(clockOffsetEstimator *c)
+{
+  memset(c, 0, sizeof(clockOffsetEstimator));
+}
+
+/*************************************************************
+*
+* Function: void clockOffsetSample(clockOffsetEstimator *c, int64_t t1,
+*                                  int64_t t2, int64_t t3, int64_t t4)
+*
+* Summary: Adds the four timestamps of one echo
+*
+* Inputs:
+*   int64_t t1, t4 : client send and receive, CLOCK_REALTIME ns
+*   int64_t t2, t3 : server receive and send, by the server's CLOCK_REALTIME
+*
+***************************************************************/
+void clockOffsetSample(clockOffsetEstimator *c, int64_t t1, int64_t t2, int64_t t3, int64_t t4)
+{
+  int64_t delayNs = (t4 - t1) - (t3 - t2);
+  double offset = nsToSecs((t2 - t1) + (t3 - t4)) / 2.0;
+  double sampleTime;
+
+  if (c->sampleCount == 0) {
+    c->t0Ns = t1;
+    c->minDelayNs = delayNs;
+    c->minDelayOffset = offset;
+  }
+  sampleTime = nsToSecs(t1 - c->t0Ns);
+  c->sampleCount++;
+  c->lastTime = sampleTime;
+  if (delayNs < c->minDelayNs) {
+    c->minDelayNs = delayNs;
+    c->minDelayOffset = offset;
+  }
+  c->forwardSum += nsToSecs(t2 - t1);
+  c->reverseSum += nsToSecs(t4 - t3);
+  c->residenceSum += nsToSecs(t3 - t2);
+  c->timeSum += sampleTime;
+  if (t3 - t2 > c->maxResidenceNs)
+    c->maxResidenceNs = t3 - t2;
+
+  if ((c->filterCount == 0) || (delayNs < c->filterDelayNs)) {
+    c->filterDelayNs = delayNs;
+    c->filterOffset = offset;
+    c->filterTime = sampleTime;
+  }
+  if (++c->filterCount == CLOCK_FILTER_SAMPLES)
+    clockOffsetFilterFlush(c);
+}
+
+/*************************************************************
+*
+* Function: void clockOffsetFit(clockOffsetEstimator *c, double *offset,
+*                               double *drift)
+*
+* Summary: The estimate so far
+*
+* outputs:
+*   double *offset : the server's clock less the client's, in seconds,
+*                    at the last sample
+*   double *drift : how fast the offset changes, seconds per second,
+*                   0 until there are two filtered samples
+*
+***************************************************************/
+void clockOffsetFit(clockOffsetEstimator *c, double *offset, double *drift)
+{
+  double intercept;
+
+  clockOffsetLine(c, &intercept, drift);
+  *offset = intercept + *drift * c->lastTime;
+}
+
+/*************************************************************
+*
+* Function: void clockOffsetOneWay(clockOffsetEstimator *c, double *forward,
+*                                  double *reverse, double *residence)
+*
+* Summary: Mean one way delays with the clock offset taken out, and
+*          the mean time the server held a datagram, in seconds
+*
+* notes:
+*   The offset line is linear in time, so the mean of the offsets at
+*   the sample times is the line at their mean time.
+*
+***************************************************************/
+void clockOffsetOneWay(clockOffsetEstimator *c, double *forward, double *reverse, double *residence)
+{
+  double intercept;
+  double slope;
+  double meanOffset;
+  double n = (double)c->sampleCount;
+
+  *forward = 0.0;
+  *reverse = 0.0;
+  *residence = 0.0;
+  if (c->sampleCount == 0)
+    return;
+  clockOffsetLine(c, &intercept, &slope);
+  meanOffset = intercept + slope * c->timeSum / n;
+  *forward = c->forwardSum / n - meanOffset;
+  *reverse = c->reverseSum / n + meanOffset;
+  *residence = c->residenceSum / n;
+}
+
+//Adds the window's lowest delay sample to the fit and starts a new window
+static void clockOffsetFilterFlush(clockOffsetEstimator *c)
+{
+  c->fitCount++;
+  c->sumX += c->filterTime;
+  c->sumY += c->filterOffset;
+  c->sumXX += c->filterTime * c->filterTime;
+  c->sumXY += c->filterTime * c->filterOffset;
+  c->filterCount = 0;
+}
+
+//The offset line, counting the window still being filled
+static void clockOffsetLine(clockOffsetEstimator *c, double *intercept, double *slope)
+{
+  double n = c->fitCount;
+  double sumX = c->sumX;
+  double sumY = c->sumY;
+  double sumXX = c->sumXX;
+  double sumXY = c->sumXY;
+  double denominator;
+
+  if (c->filterCount > 0) {
+    n += 1.0;
+    sumX += c->filterTime;
+    sumY += c->filterOffset;
+    sumXX += c->filterTime * c->filterTime;
+    sumXY += c->filterTime * c->filterOffset;
+  }
+  *intercept = c->minDelayOffset;
+  *slope = 0.0;
+  if (n < 2.0)
+    return;
+  denominator = n * sumXX - sumX * sumX;
+  if (denominator <= 0.0)
+    return;
+  *slope = (n * sumXY - sumX * sumY) / denominator;
+  *intercept = (sumY - *slope * sumX) / n;
+}
@@ -0,0 +1,68 @@
+/************************************************************************
+* File:  clockOffset.h
+*
+* Purpose:
+*   The server's clock offset and drift relative to the client, from
+*   echoes carrying four timestamps as in NTP, and with them the one way
+*   delay of each direction and the time the server held the datagram.
+*   An OWD taken straight across two hosts' clocks is off by however far
+*   apart the clocks are.
+*
+* Notes:
+*   For a probe sent at t1 by the client's clock, received at t2 and
+*   echoed at t3 by the server's and received back at t4 by the client's:
+*     offset    = ((t2 - t1) + (t3 - t4)) / 2   the server's clock less the client's
+*     delay     = (t4 - t1) - (t3 - t2)         the round trip less the server's part
+*     residence = t3 - t2
+*     forward   = t2 - t1 - offset,  reverse = t4 - t3 + offset
+*   offset assumes the two directions take as long, so how the delay is
+*   split between them is only as good as that assumption; their sum
+*   is exact either way.
+*
+*   Queueing makes a sample's offset wrong by up to half its delay, so
+*   as in NTP's clock filter only the lowest delay sample of every
+*   CLOCK_FILTER_SAMPLES is kept.  A least squares line through those
+*   gives the offset over time, its slope is the drift between the
+*   clocks.  The one way delays above use the offset that line gives at
+*   each sample's time.
+*
+************************************************************************/
+#ifndef	__clockOffset_h
+#define	__clockOffset_h
+
+//Samples the clock filter picks the lowest delay one from
+#define CLOCK_FILTER_SAMPLES 8
+
+typedef struct {
+  uint64_t sampleCount;
+  //the clock filter window being filled: its samples and its lowest delay one
+  uint32_t filterCount;
+  int64_t filterDelayNs;
+  double filterOffset;
+  double filterTime;
+  //least squares sums over the filtered samples, time in seconds from t0Ns
+  int64_t t0Ns;
+  uint32_t fitCount;
+  double sumX;
+  double sumY;
+  double sumXX;
+  double sumXY;
+  //the lowest delay of all and its offset, the estimate until there is a line
+  int64_t minDelayNs;
+  double minDelayOffset;
+  //sums of t2 - t1, t4 - t3, t3 - t2 and of the sample times, for the means
+  double forwardSum;
+  double reverseSum;
+  double residenceSum;
+  double timeSum;
+  int64_t maxResidenceNs;
+  double lastTime;
+} clockOffsetEstimator;
+
+void clockOffsetInit(clockOffsetEstimator *c);
+void clockOffsetSample(clockOffsetEstimator *c, int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+void clockOffsetFit(clockOffsetEstimator *c, double *offset, double *drift);
+void clockOffsetOneWay(clockOffsetEstimator *c, double *forward, double *reverse, double *residence);
+
+#endif
+
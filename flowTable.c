@@ -0,0 +1,283 @@
+/*********************************************************
+* Module Name:  Server flow table
+*
+* File Name:    flowTable.c
+*
+* Summary:
+*   Open addressing table of per client sessions.  See flowTable.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "AddressUtility.h"
+#include "flowTable.h"
+
+static uint32_t flowHash(const struct sockaddr *addr);
+static int flowTableGrow(flowTable *t);
+static void flowTableInsertSlot(flowTable *t, uint32_t hash, uint32_t session);
+static void flowTableRemoveSlot(flowTable *t, uint32_t hash, uint32_t session);
+
+/*************************************************************
+*
+* Function: int flowTableInit(flowTable *t, double idleTimeout)
+*
+* Summary: Allocates an empty table
+*
+* Inputs:
+*   flowTable *t : caller's table
+*   double idleTimeout : seconds without a packet before a session
+*                        is expired, 0 to keep sessions forever
+*
+* outputs:
+*   returns SUCCESS or ERROR if the table could not be allocated
+*
+***************************************************************/
+int flowTableInit(flowTable *t, double idleTimeout)
+{
+  memset(t, 0, sizeof(flowTable));
+  t->slots = calloc(FLOW_TABLE_INITIAL_SLOTS, sizeof(flowSlot));
+  t->sessions = calloc(FLOW_TABLE_INITIAL_SLOTS / 2, sizeof(flowSession));
+  if ((t->slots == NULL) || (t->sessions == NULL))
+    return ERROR;
+  t->slotMask = FLOW_TABLE_INITIAL_SLOTS - 1;
+  t->sessionCapacity = FLOW_TABLE_INITIAL_SLOTS / 2;
+  t->idleTimeout = idleTimeout;
+  seqTrackerInit(&t->expiredSequence, 1);
+  return SUCCESS;
+}
+
+//64 bit finalizer from MurmurHash3, folded to 32 bits
+static uint32_t flowHash(const struct sockaddr *addr)
+{
+  uint64_t key = 0;
+
+  if (addr->sa_family == AF_INET) {
+    struct sockaddr_in *in4 = (struct sockaddr_in *) addr;
+    key = ((uint64_t)in4->sin_addr.s_addr << 16) | in4->sin_port;
+  } else if (addr->sa_family == AF_INET6) {
+    struct sockaddr_in6 *in6 = (struct sockaddr_in6 *) addr;
+    uint64_t words[2];
+    memcpy(words, &in6->sin6_addr, sizeof(words));
+    key = words[0] ^ (words[1] * 0x9e3779b97f4a7c15ULL) ^ in6->sin6_port;
+  }
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return (uint32_t)key;
+}
+
+static void flowTableInsertSlot(flowTable *t, uint32_t hash, uint32_t session)
+{
+  uint32_t i = hash & t->slotMask;
+
+  while (t->slots[i].session != 0)
+    i = (i + 1) & t->slotMask;
+  t->slots[i].hash = hash;
+  t->slots[i].session = session;
+}
+
+/*************************************************************
+*
+* Function: static void flowTableRemoveSlot(flowTable *t, uint32_t hash,
+*                                           uint32_t session)
+*
+* Summary: Removes a session's slot and shifts back the entries
+*          after it that would otherwise become unreachable.
+*
+***************************************************************/
+static void flowTableRemoveSlot(flowTable *t, uint32_t hash, uint32_t session)
+{
+  uint32_t i = hash & t->slotMask;
+  uint32_t j;
+  uint32_t home;
+
+  while (t->slots[i].session != session) {
+    if (t->slots[i].session == 0)
+      return;
+    i = (i + 1) & t->slotMask;
+  }
+
+  j = i;
+  for (;;) {
+    j = (j + 1) & t->slotMask;
+    if (t->slots[j].session == 0)
+      break;
+    home = t->slots[j].hash & t->slotMask;
+    //j may fill the hole at i unless its home lies cyclically in (i, j]
+    if (((j > i) && ((home <= i) || (home > j))) ||
+        ((j < i) && ((home <= i) && (home > j)))) {
+      t->slots[i] = t->slots[j];
+      i = j;
+    }
+  }
+  t->slots[i].hash = 0;
+  t->slots[i].session = 0;
+}
+
+//Doubles the slot array and rehashes, and makes room for as many sessions
+static int flowTableGrow(flowTable *t)
+{
+  uint32_t oldSlots = t->slotMask + 1;
+  flowSlot *old = t->slots;
+  flowSession *sessions;
+  uint32_t i;
+
+  t->slots = calloc((size_t)oldSlots * 2, sizeof(flowSlot));
+  if (t->slots == NULL) {
+    t->slots = old;
+    return ERROR;
+  }
+  t->slotMask = oldSlots * 2 - 1;
+  for (i = 0; i < oldSlots; i++) {
+    if (old[i].session != 0)
+      flowTableInsertSlot(t, old[i].hash, old[i].session);
+  }
+  free(old);
+
+  sessions = realloc(t->sessions, (size_t)oldSlots * sizeof(flowSession));
+  if (sessions == NULL)
+    return ERROR;
+  t->sessions = sessions;
+  t->sessionCapacity = oldSlots;
+  return SUCCESS;
+}
+
+/*************************************************************
+*
+* Function: flowSession *flowTableLookup(flowTable *t,
+*                   struct sockaddr_storage *clientAddr, uint64_t seq,
+*                   double now)
+*
+* Summary: Finds the session of a client, creating it on the
+*          client's first packet.
+*
+* Inputs:
+*   flowTable *t : the table
+*   struct sockaddr_storage *clientAddr : the sender of the packet
+*   uint64_t seq : sequence number of the packet, a new session's
+*                  tracker starts there
+*   double now : wall clock time of the packet
+*
+* outputs:
+*   returns the session, or NULL (counted as overflow) if the table
+*   is full
+*
+***************************************************************/
+flowSession *flowTableLookup(flowTable *t, struct sockaddr_storage *clientAddr, uint64_t seq, double now)
+{
+  struct sockaddr *addr = (struct sockaddr *) clientAddr;
+  uint32_t hash = flowHash(addr);
+  uint32_t i = hash & t->slotMask;
+  uint32_t index;
+  flowSession *session;
+
+  for (; t->slots[i].session != 0; i = (i + 1) & t->slotMask) {
+    if (t->slots[i].hash != hash)
+      continue;
+    session = &t->sessions[t->slots[i].session - 1];
+    if (SockAddrsEqual(addr, &session->clientAddr.sa))
+      return session;
+  }
+
+  //New client
+  if ((t->activeFlows >= FLOW_TABLE_MAX_FLOWS) ||
+      ((t->activeFlows + 1 > (t->slotMask + 1) / 2) && (flowTableGrow(t) != SUCCESS))) {
+    t->overflowCount++;
+    return NULL;
+  }
+  if (t->freeHead != 0) {
+    index = t->freeHead - 1;
+    t->freeHead = t->sessions[index].nextFree;
+  } else {
+    index = t->sessionsUsed++;
+  }
+
+  session = &t->sessions[index];
+  memset(session, 0, sizeof(flowSession));
+  if (addr->sa_family == AF_INET6)
+    memcpy(&session->clientAddr, addr, sizeof(struct sockaddr_in6));
+  else
+    memcpy(&session->clientAddr, addr, sizeof(struct sockaddr_in));
+  session->hash = hash;
+  session->inUse = true;
+  session->timeFirstPacket = now;
+  //A client back after its session expired carries on from where it
+  //was, the sequence numbers before this one were the old session's
+  session->firstSeq = (seq > 0) ? seq : 1;
+  session->largestSeqRecv = session->firstSeq - 1;
+  seqTrackerInit(&session->sequence, session->firstSeq);
+  flowTableInsertSlot(t, hash, index + 1);
+
+  t->activeFlows++;
+  if (t->activeFlows > t->maxActiveFlows)
+    t->maxActiveFlows = t->activeFlows;
+  return session;
+}
+
+/*************************************************************
+*
+* Function: uint32_t flowTableExpire(flowTable *t, double now)
+*
+* Summary: Expires the sessions idle for longer than the table's
+*          idleTimeout.  Does nothing if the last sweep was less than
+*          FLOW_SWEEP_INTERVAL ago, so it can be called per packet.
+*
+* outputs:
+*   returns the number of sessions expired
+*
+***************************************************************/
+uint32_t flowTableExpire(flowTable *t, double now)
+{
+  uint32_t expired = 0;
+  uint32_t i;
+
+  if ((t->idleTimeout <= 0.0) || (now - t->lastSweep < FLOW_SWEEP_INTERVAL))
+    return 0;
+  t->lastSweep = now;
+
+  for (i = 0; i < t->sessionsUsed; i++) {
+    flowSession *session = &t->sessions[i];
+    if ((!session->inUse) || (now - session->timeLastPacket <= t->idleTimeout))
+      continue;
+    seqTrackerMerge(&t->expiredSequence, &session->sequence);
+    t->expiredLargestSeqSum += session->largestSeqRecv - (session->firstSeq - 1);
+    flowTableRemoveSlot(t, session->hash, i + 1);
+    session->inUse = false;
+    session->nextFree = t->freeHead;
+    t->freeHead = i + 1;
+    t->activeFlows--;
+    expired++;
+  }
+  t->expiredFlows += expired;
+  return expired;
+}
+
+/*************************************************************
+*
+* Function: void flowTableTotals(flowTable *t, seqTracker *sequence,
+*                                uint64_t *largestSeqSum)
+*
+* Summary: Adds the sequence accounting of every session, live or
+*          expired, into the caller's totals.
+*
+* Inputs:
+*   flowTable *t : the table
+*   seqTracker *sequence : totals, already through seqTrackerInit()
+*   uint64_t *largestSeqSum : incremented by the sequence numbers each
+*                             session spanned, i.e. what was sent to it
+*
+***************************************************************/
+void flowTableTotals(flowTable *t, seqTracker *sequence, uint64_t *largestSeqSum)
+{
+  uint32_t i;
+
+  seqTrackerMerge(sequence, &t->expiredSequence);
+  *largestSeqSum += t->expiredLargestSeqSum;
+  for (i = 0; i < t->sessionsUsed; i++) {
+    if (!t->sessions[i].inUse)
+      continue;
+    seqTrackerMerge(sequence, &t->sessions[i].sequence);
+    *largestSeqSum += t->sessions[i].largestSeqRecv - (t->sessions[i].firstSeq - 1);
+  }
+}
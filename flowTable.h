@@ -0,0 +1,109 @@
+/************************************************************************
+* File:  flowTable.h
+*
+* Purpose:
+*   Per client session table for the server.  Each client address
+*   (the sockaddr_storage recvfrom() fills in) gets a session holding
+*   the stats the server otherwise only keeps for all clients together:
+*   receive counts, largest sequence number, OWD and a seqTracker.
+*
+* Notes:
+*   Open addressing with linear probing over a compact slot array of
+*   {hash, session index} pairs, eight to a cache line.  The sessions
+*   themselves live in a separate array that is only touched once the
+*   hash matches, and SockAddrsEqual() has the final say.  Deletion
+*   shifts the following entries back rather than leaving tombstones.
+*
+*   The slot array doubles once it is half full and the session array
+*   grows with it, up to FLOW_TABLE_MAX_FLOWS sessions.  Packets from
+*   clients beyond that are counted in overflowCount and not tracked.
+*
+*   Sessions idle for longer than idleTimeout are expired, at most once
+*   every FLOW_SWEEP_INTERVAL seconds.  Their sequence accounting is
+*   folded into expiredSequence so the server totals still include it.
+*   A client that comes back after that gets a new session starting at
+*   the first sequence number it sees, so what the old session already
+*   accounted for is not counted again.  A packet from below that start
+*   arriving late is counted as a duplicate.
+*
+*   A table belongs to one worker thread.
+*
+************************************************************************/
+#ifndef	__flowTable_h
+#define	__flowTable_h
+
+#include "seqTracker.h"
+
+#define FLOW_TABLE_INITIAL_SLOTS 1024
+#define FLOW_TABLE_MAX_FLOWS (1 << 20)
+//Default seconds without a packet before a session is expired, 0 never expires
+#define FLOW_IDLE_DEFAULT_SECS 60
+#define FLOW_SWEEP_INTERVAL 1.0
+//Most per flow lines the server summary lists
+#define FLOW_SUMMARY_MAX_LINES 1000
+
+//Big enough for either address family, unlike sockaddr_storage it is only 28 bytes
+typedef union {
+  struct sockaddr sa;
+  struct sockaddr_in in4;
+  struct sockaddr_in6 in6;
+} flowAddr;
+
+typedef struct {
+  uint32_t hash;
+  //index + 1 into the session array, 0 marks an empty slot
+  uint32_t session;
+} flowSlot;
+
+typedef struct {
+  flowAddr clientAddr;
+  uint32_t hash;
+  bool inUse;
+  //next free session while not in use
+  uint32_t nextFree;
+  uint64_t receivedCount;
+  //sequence number of the session's first packet, and the largest since
+  uint64_t firstSeq;
+  uint64_t largestSeqRecv;
+  uint64_t totalBytesRecieved;
+  double timeFirstPacket;
+  double timeLastPacket;
+  double OWDSum;
+  uint32_t numberOWDSamples;
+  double smoothedOWD;
+  double minOWD;
+  double maxOWD;
+  //RFC 3550 interarrival jitter, the OWD stands in for the transit time
+  double jitter;
+  double lastOWD;
+  seqTracker sequence;
+} flowSession;
+
+typedef struct {
+  flowSlot *slots;
+  uint32_t slotMask;
+  flowSession *sessions;
+  uint32_t sessionCapacity;
+  //sessions [0, sessionsUsed) have been handed out at least once
+  uint32_t sessionsUsed;
+  //head of the free list, index + 1, 0 when empty
+  uint32_t freeHead;
+  uint32_t activeFlows;
+  uint32_t maxActiveFlows;
+  uint64_t expiredFlows;
+  uint64_t overflowCount;
+  double idleTimeout;
+  double lastSweep;
+  //what the expired sessions saw
+  seqTracker expiredSequence;
+  uint64_t expiredLargestSeqSum;
+} flowTable;
+
+int flowTableInit(flowTable *t, double idleTimeout);
+flowSession *flowTableLookup(flowTable *t, struct sockaddr_storage *clientAddr, uint64_t seq, double now);
+uint32_t flowTableExpire(flowTable *t, double now);
+void flowTableTotals(flowTable *t, seqTracker *sequence, uint64_t *largestSeqSum);
+
+#endif
+
+
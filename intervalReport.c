@@ -0,0 +1,302 @@
+/*********************************************************
+* Module Name:  Interval reporter
+*
+* File Name:    intervalReport.c
+*
+* Summary:
+*   Background thread printing the change in the client's or server's
+*   counters every interval.  See intervalReport.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+#include "intervalReport.h"
+
+#include <signal.h>
+#include <sched.h>
+
+static void *intervalReportMain(void *arg);
+static void intervalReportPrint(intervalReporter *r, int64_t now);
+static uint64_t intervalDiff(uint64_t now, uint64_t before);
+
+/*************************************************************
+*
+* Function: int intervalReportStart(intervalReporter *r, const char *tag,
+*               double intervalSecs, intervalSnapshot snapshot)
+*
+* Summary: Takes the first snapshot and starts the reporter thread
+*
+* Inputs:
+*   intervalReporter *r : caller's reporter
+*   const char *tag : program part of the report lines, e.g. "Client"
+*   double intervalSecs : seconds between reports
+*   intervalSnapshot snapshot : fills in the program's cumulative counters,
+*                               called from the reporter thread
+*
+* outputs:
+*   returns NOERROR or ERROR (errno set) if the thread could not be started
+*
+***************************************************************/
+int intervalReportStart(intervalReporter *r, const char *tag, double intervalSecs, intervalSnapshot snapshot)
+{
+  sigset_t allSignals;
+  sigset_t oldSignals;
+
+  memset(r, 0, sizeof(intervalReporter));
+  r->tag = tag;
+  r->intervalNs = (int64_t)(intervalSecs * NS_PER_SEC);
+  if (r->intervalNs < INTERVAL_REPORT_POLL_NS)
+    r->intervalNs = INTERVAL_REPORT_POLL_NS;
+  r->snapshot = snapshot;
+  r->last = calloc(1, sizeof(intervalCounters));
+  r->current = calloc(1, sizeof(intervalCounters));
+  r->delta = calloc(1, sizeof(latencyHistogram));
+  if ((r->last == NULL) || (r->current == NULL) || (r->delta == NULL))
+    return ERROR;
+
+  r->snapshot(r->last);
+  r->startNs = timeNowNs();
+  r->lastNs = r->startNs;
+  atomic_store(&r->stop, false);
+
+  //the thread inherits the mask, so no signal is ever delivered to it
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &oldSignals);
+  errno = pthread_create(&r->thread, NULL, intervalReportMain, r);
+  pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+  if (errno != 0)
+    return ERROR;
+  r->running = true;
+  return NOERROR;
+}
+
+/*************************************************************
+*
+* Function: void intervalReportStop(intervalReporter *r)
+*
+* Summary: Stops the thread and prints the last, partial, interval
+*          so the reports add up to the whole run
+*
+***************************************************************/
+void intervalReportStop(intervalReporter *r)
+{
+  if (!r->running)
+    return;
+  atomic_store(&r->stop, true);
+  pthread_join(r->thread, NULL);
+  r->running = false;
+  intervalReportPrint(r, timeNowNs());
+}
+
+static void *intervalReportMain(void *arg)
+{
+  intervalReporter *r = (intervalReporter *)arg;
+  int64_t deadline = r->startNs + r->intervalNs;
+  struct timespec nap;
+  int64_t now;
+
+  while (!atomic_load(&r->stop)) {
+    now = timeNowNs();
+    if (now >= deadline) {
+      intervalReportPrint(r, now);
+      //keep to the grid, skipping ticks the thread slept through
+      while (deadline <= now)
+        deadline += r->intervalNs;
+      continue;
+    }
+    nap.tv_sec = 0;
+    nap.tv_nsec = (deadline - now < INTERVAL_REPORT_POLL_NS) ? deadline - now : INTERVAL_REPORT_POLL_NS;
+    nanosleep(&nap, NULL);
+  }
+  return NULL;
+}
+
+//Counter difference, 0 if a racy snapshot made it run backwards
+static uint64_t intervalDiff(uint64_t now, uint64_t before)
+{
+  return (now > before) ? now - before : 0;
+}
+
+/*************************************************************
+*
+* Function: void intervalReportLine(const char *tag, intervalCounters *now,
+*               intervalCounters *before, latencyHistogram *delta,
+*               double elapsed, double secs)
+*
+* Summary: Prints the Interval line for the change from before to now
+*
+* Inputs:
+*   const char *tag : program part of the line, e.g. "Client"
+*   latencyHistogram *delta : scratch space for the interval's histogram
+*   double elapsed : seconds since reporting started
+*   double secs : seconds between the two snapshots
+*
+***************************************************************/
+void intervalReportLine(const char *tag, intervalCounters *now, intervalCounters *before,
+                        latencyHistogram *delta, double elapsed, double secs)
+{
+  uint64_t sent, received, sentBytes, receivedBytes, expected, arrived;
+  double lossRate = 0.0;
+
+  if (secs <= 0.0)
+    return;
+  sent = intervalDiff(now->sentCount, before->sentCount);
+  received = intervalDiff(now->receivedCount, before->receivedCount);
+  sentBytes = intervalDiff(now->sentBytes, before->sentBytes);
+  receivedBytes = intervalDiff(now->receivedBytes, before->receivedBytes);
+  expected = intervalDiff(now->expectedCount, before->expectedCount);
+  arrived = intervalDiff(now->arrivedCount, before->arrivedCount);
+  if ((expected > 0) && (arrived < expected))
+    lossRate = (double)(expected - arrived) / (double)expected;
+  histogramDelta(delta, &now->latency, &before->latency);
+
+  printf("UDPEchoV2:%s:Interval:  %12.6f %8.3f %6.3f %llu %llu %12.1f %12.1f %10.3f %10.3f %2.4f %llu %llu %4.9f %4.9f %4.9f %4.9f\n",
+        tag, nsToSecs(timeWallNs()), elapsed, secs,
+        (unsigned long long)sent, (unsigned long long)received,
+        (double)sent / secs, (double)received / secs,
+        8.0 * (double)sentBytes / secs / 1000000.0, 8.0 * (double)receivedBytes / secs / 1000000.0,
+        lossRate, (unsigned long long)intervalDiff(now->reorderedCount, before->reorderedCount),
+        (unsigned long long)delta->count,
+        histogramPercentile(delta, 50.0), histogramPercentile(delta, 90.0),
+        histogramPercentile(delta, 99.0), histogramMax(delta));
+  fflush(stdout);
+}
+
+/*************************************************************
+*
+* Function: void intervalReportSnapshot(const char *tag,
+*               intervalCounters *now, double elapsed)
+*
+* Summary: Prints the Snapshot line of the cumulative counters, the
+*          SIGUSR1 output (see signalControl.h)
+*
+* Inputs:
+*   const char *tag : program part of the line, e.g. "Client"
+*   double elapsed : seconds since the program started
+*
+***************************************************************/
+void intervalReportSnapshot(const char *tag, intervalCounters *now, double elapsed)
+{
+  latencyHistogram *h = &now->latency;
+  double lossRate = 0.0;
+
+  if ((now->expectedCount > 0) && (now->arrivedCount < now->expectedCount))
+    lossRate = (double)(now->expectedCount - now->arrivedCount) / (double)now->expectedCount;
+  printf("UDPEchoV2:%s:Snapshot:  %12.6f %8.3f %llu %llu %llu %llu %llu %llu %2.4f %llu %llu %llu %llu %llu %4.9f %4.9f %4.9f %4.9f\n",
+        tag, nsToSecs(timeWallNs()), elapsed,
+        (unsigned long long)now->sentCount, (unsigned long long)now->receivedCount,
+        (unsigned long long)now->sentBytes, (unsigned long long)now->receivedBytes,
+        (unsigned long long)now->expectedCount, (unsigned long long)now->arrivedCount,
+        lossRate, (unsigned long long)now->reorderedCount,
+        (unsigned long long)now->RxErrorCount, (unsigned long long)now->TxErrorCount,
+        (unsigned long long)now->timeoutCount, (unsigned long long)h->count,
+        histogramPercentile(h, 50.0), histogramPercentile(h, 90.0),
+        histogramPercentile(h, 99.0), histogramMax(h));
+  fflush(stdout);
+}
+
+/*************************************************************
+*
+* Function: static void intervalReportPrint(intervalReporter *r, int64_t now)
+*
+* Summary: Snapshots the counters, prints the interval since the last
+*          snapshot and makes this one the last
+*
+***************************************************************/
+static void intervalReportPrint(intervalReporter *r, int64_t now)
+{
+  intervalCounters *swap;
+
+  if (now <= r->lastNs)
+    return;
+  r->snapshot(r->current);
+  intervalReportLine(r->tag, r->current, r->last, r->delta,
+                     nsToSecs(now - r->startNs), nsToSecs(now - r->lastNs));
+  r->reportCount++;
+
+  swap = r->last;
+  r->last = r->current;
+  r->current = swap;
+  r->lastNs = now;
+}
+
+/*************************************************************
+*
+* Function: bool intervalPublishDue(intervalPublished *p, int64_t now)
+*
+* Summary: Whether the owning thread should republish its counters,
+*          INTERVAL_PUBLISH_NS after it last did
+*
+***************************************************************/
+bool intervalPublishDue(intervalPublished *p, int64_t now)
+{
+  return ((p->publishNs == 0) || (now - p->publishNs >= INTERVAL_PUBLISH_NS));
+}
+
+/*************************************************************
+*
+* Function: intervalCounters *intervalPublishBegin(intervalPublished *p)
+*
+* Summary: Seqlock write side, called by the owning thread only.  Makes
+*          the sequence number odd and returns the counters to fill in,
+*          intervalPublishEnd() makes it even again.
+*
+* notes:
+*   Same fencing as statsShmPublish(): the odd sequence number is
+*   visible before any counter changes, the counters before the even one.
+*
+***************************************************************/
+intervalCounters *intervalPublishBegin(intervalPublished *p)
+{
+  uint32_t sequence = atomic_load_explicit(&p->sequence, memory_order_relaxed);
+
+  atomic_store_explicit(&p->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  return &p->counters;
+}
+
+/*************************************************************
+*
+* Function: void intervalPublishEnd(intervalPublished *p, int64_t now)
+*
+* Summary: Ends a publish begun by intervalPublishBegin() and notes
+*          its time for intervalPublishDue()
+*
+***************************************************************/
+void intervalPublishEnd(intervalPublished *p, int64_t now)
+{
+  uint32_t sequence = atomic_load_explicit(&p->sequence, memory_order_relaxed);
+
+  p->publishNs = now;
+  atomic_store_explicit(&p->sequence, sequence + 1, memory_order_release);
+}
+
+/*************************************************************
+*
+* Function: void intervalPublishRead(intervalPublished *p, intervalCounters *counters)
+*
+* Summary: Seqlock read side.  Copies the counters last published and
+*          retries if they were rewritten under it.
+*
+* notes:
+*   A publish is a copy with no system call in it, so the writer always
+*   finishes one soon and the retries end.
+*
+***************************************************************/
+void intervalPublishRead(intervalPublished *p, intervalCounters *counters)
+{
+  uint32_t before;
+  uint32_t after;
+
+  do {
+    before = atomic_load_explicit(&p->sequence, memory_order_acquire);
+    if (before & 1) {
+      //mid publish, let the writer finish
+      sched_yield();
+      continue;
+    }
+    memcpy(counters, &p->counters, sizeof(intervalCounters));
+    atomic_thread_fence(memory_order_acquire);
+    after = atomic_load_explicit(&p->sequence, memory_order_relaxed);
+  } while ((before & 1) || (before != after));
+}
@@ -0,0 +1,102 @@
+/************************************************************************
+* File:  intervalReport.h
+*
+* Purpose:
+*   Periodic report lines for long runs, between the per packet output
+*   and the end of run summary.  A background thread wakes up every
+*   interval, takes a snapshot of the program's cumulative counters and
+*   prints what changed since the last one: packet and bit rates, loss,
+*   reordering and the latency percentiles of that interval alone.
+*
+* Notes:
+*   The hot path only bumps the counters and records into the latency
+*   histogram it already keeps, nothing is formatted per packet.  Every
+*   INTERVAL_PUBLISH_NS or so each packet thread copies them into an
+*   intervalPublished block of its own under a seqlock, and the snapshot
+*   callback reads those copies, never the live counters.  A snapshot
+*   can so be up to that much behind.  A thread with counts still
+*   unpublished does not block for longer than that, so a quiet
+*   thread's copy is current.  The interval histogram is the
+*   difference of two cumulative ones (see histogramDelta()).
+*
+*   Each interval prints:
+*     printf("UDPEchoV2:<tag>:Interval:  %12.6f %8.3f %6.3f %llu %llu %12.1f %12.1f %10.3f %10.3f %2.4f %llu %llu %4.9f %4.9f %4.9f %4.9f\n",
+*           wallTime, elapsed, intervalSecs, sent, received, sentPps, receivedPps,
+*           sentMbps, receivedMbps, lossRate, reordered,
+*           latencySamples, p50, p90, p99, max);
+*   elapsed is seconds since the reporter started.  lossRate is the
+*   share of the datagrams expected in the interval that did not arrive,
+*   0 when the program cannot tell.  The interval cut short by
+*   intervalReportStop() is printed too.
+*
+*   The thread blocks every signal, they stay with the program's own
+*   threads (see signalControl.h).
+*
+************************************************************************/
+#ifndef	__intervalReport_h
+#define	__intervalReport_h
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "latencyHistogram.h"
+
+//Longest the thread sleeps before it looks at the stop flag
+#define INTERVAL_REPORT_POLL_NS 10000000LL
+//How often a packet thread republishes its counters
+#define INTERVAL_PUBLISH_NS 1000000LL
+
+//Cumulative counters, as the snapshot callback finds them
+typedef struct {
+  uint64_t sentCount;
+  uint64_t sentBytes;
+  uint64_t receivedCount;
+  uint64_t receivedBytes;
+  //datagrams that should have arrived, and those of them that did
+  uint64_t expectedCount;
+  uint64_t arrivedCount;
+  uint64_t reorderedCount;
+  uint64_t RxErrorCount;
+  uint64_t TxErrorCount;
+  //RTT probes given up on, client only
+  uint64_t timeoutCount;
+  latencyHistogram latency;
+} intervalCounters;
+
+typedef void (*intervalSnapshot)(intervalCounters *counters);
+
+//One packet thread's counters as it last published them.  The sequence
+//number is odd while the thread rewrites them.  Zeroed is a valid start.
+typedef struct {
+  _Atomic uint32_t sequence __attribute__((aligned(CACHE_LINE_SIZE)));
+  int64_t publishNs;
+  intervalCounters counters;
+} intervalPublished;
+
+typedef struct {
+  const char *tag;
+  int64_t intervalNs;
+  intervalSnapshot snapshot;
+  //the previous and the current snapshot, and their difference
+  intervalCounters *last;
+  intervalCounters *current;
+  latencyHistogram *delta;
+  int64_t startNs;
+  int64_t lastNs;
+  pthread_t thread;
+  atomic_bool stop;
+  bool running;
+  uint64_t reportCount;
+} intervalReporter;
+
+int intervalReportStart(intervalReporter *r, const char *tag, double intervalSecs, intervalSnapshot snapshot);
+void intervalReportStop(intervalReporter *r);
+void intervalReportLine(const char *tag, intervalCounters *now, intervalCounters *before,
+                        latencyHistogram *delta, double elapsed, double secs);
+void intervalReportSnapshot(const char *tag, intervalCounters *now, double elapsed);
+bool intervalPublishDue(intervalPublished *p, int64_t now);
+intervalCounters *intervalPublishBegin(intervalPublished *p);
+void intervalPublishEnd(intervalPublished *p, int64_t now);
+void intervalPublishRead(intervalPublished *p, intervalCounters *counters);
+
+#endif
+
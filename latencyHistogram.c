@@ -0,0 +1,288 @@
+/*********************************************************
+* Module Name:  Latency histogram
+*
+* File Name:    latencyHistogram.c
+*
+* Summary:
+*   Log-linear histogram behind the latency percentiles in the
+*   client (RTT) and server (OWD) summaries.  See latencyHistogram.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "latencyHistogram.h"
+
+static uint32_t histogramIndex(int64_t valueNs);
+static int64_t histogramBucketLow(uint32_t index);
+static int64_t histogramBucketHigh(uint32_t index);
+
+void histogramInit(latencyHistogram *h)
+{
+  memset(h, 0, sizeof(latencyHistogram));
+}
+
+/*************************************************************
+*
+* Function: static uint32_t histogramIndex(int64_t valueNs)
+*
+* Summary: Maps a value to its bucket.  Below HIST_SUB_BUCKETS the
+*          bucket is the value itself, above it the position of the
+*          top bit picks the power of two and the next
+*          HIST_SUB_BUCKET_BITS-1 bits pick the bucket within it.
+*
+***************************************************************/
+static uint32_t histogramIndex(int64_t valueNs)
+{
+  uint32_t msb;
+  uint32_t shift;
+  uint64_t top;
+
+  if (valueNs < 0)
+    valueNs = 0;
+  if (valueNs > HIST_MAX_VALUE_NS)
+    valueNs = HIST_MAX_VALUE_NS;
+  if (valueNs < HIST_SUB_BUCKETS)
+    return (uint32_t)valueNs;
+
+  msb = 63 - __builtin_clzll((uint64_t)valueNs);
+  shift = msb - HIST_SUB_BUCKET_BITS + 1;
+  top = (uint64_t)valueNs >> shift;
+  return HIST_SUB_BUCKETS + (shift - 1) * HIST_HALF_BUCKETS + (uint32_t)(top - HIST_HALF_BUCKETS);
+}
+
+static int64_t histogramBucketLow(uint32_t index)
+{
+  uint32_t shift;
+  uint64_t top;
+
+  if (index < HIST_SUB_BUCKETS)
+    return (int64_t)index;
+  shift = (index - HIST_SUB_BUCKETS) / HIST_HALF_BUCKETS + 1;
+  top = (index - HIST_SUB_BUCKETS) % HIST_HALF_BUCKETS + HIST_HALF_BUCKETS;
+  return (int64_t)(top << shift);
+}
+
+static int64_t histogramBucketHigh(uint32_t index)
+{
+  uint32_t shift;
+
+  if (index < HIST_SUB_BUCKETS)
+    return (int64_t)index;
+  shift = (index - HIST_SUB_BUCKETS) / HIST_HALF_BUCKETS + 1;
+  return histogramBucketLow(index) + (1LL << shift) - 1;
+}
+
+/*************************************************************
+*
+* Function: void histogramRecord(latencyHistogram *h, double sample)
+*
+* Summary: Adds one sample
+*
+* Inputs:
+*   latencyHistogram *h : the histogram
+*   double sample : the sample in seconds
+*
+***************************************************************/
+void histogramRecord(latencyHistogram *h, double sample)
+{
+  int64_t valueNs = (int64_t)llround(sample * 1000000000.0);
+  double delta = 0.0;
+
+  if ((h->count == 0) || (valueNs < h->minNs))
+    h->minNs = valueNs;
+  if ((h->count == 0) || (valueNs > h->maxNs))
+    h->maxNs = valueNs;
+  h->count++;
+  delta = (double)valueNs - h->meanNs;
+  h->meanNs += delta / (double)h->count;
+  h->M2 += delta * ((double)valueNs - h->meanNs);
+  h->buckets[histogramIndex(valueNs)]++;
+}
+
+/*************************************************************
+*
+* Function: void histogramMerge(latencyHistogram *dst, latencyHistogram *src)
+*
+* Summary: Adds the samples of src into dst, e.g. to total up the
+*          server's per worker histograms.
+*
+***************************************************************/
+void histogramMerge(latencyHistogram *dst, latencyHistogram *src)
+{
+  uint64_t total;
+  double delta;
+  uint32_t i;
+
+  if (src->count == 0)
+    return;
+  if ((dst->count == 0) || (src->minNs < dst->minNs))
+    dst->minNs = src->minNs;
+  if ((dst->count == 0) || (src->maxNs > dst->maxNs))
+    dst->maxNs = src->maxNs;
+
+  //Chan et al. combination of two running means/variances
+  total = dst->count + src->count;
+  delta = src->meanNs - dst->meanNs;
+  dst->meanNs += delta * (double)src->count / (double)total;
+  dst->M2 += src->M2 + delta * delta * (double)dst->count * (double)src->count / (double)total;
+  dst->count = total;
+
+  for (i = 0; i < HIST_NUM_BUCKETS; i++)
+    dst->buckets[i] += src->buckets[i];
+}
+
+/*************************************************************
+*
+* Function: void histogramDelta(latencyHistogram *dst, latencyHistogram *now,
+*                               latencyHistogram *before)
+*
+* Summary: Sets dst to the samples recorded into a histogram between
+*          the copies before and now were taken.
+*
+* notes:
+*   The buckets subtract exactly.  min and max become the bounds of
+*   the lowest and highest bucket that changed, clamped to now's, and
+*   the mean comes from the difference of the sums, so all three are
+*   good to the bucket width.  The spread of just those samples is not
+*   known, dst has no stddev.  count is the sum of the bucket
+*   differences, a copy taken while a sample was being recorded may
+*   not agree with its own count.
+*
+***************************************************************/
+void histogramDelta(latencyHistogram *dst, latencyHistogram *now, latencyHistogram *before)
+{
+  uint32_t first = HIST_NUM_BUCKETS;
+  uint32_t last = 0;
+  double sumNs;
+  uint32_t i;
+
+  histogramInit(dst);
+  for (i = 0; i < HIST_NUM_BUCKETS; i++) {
+    if (now->buckets[i] <= before->buckets[i])
+      continue;
+    dst->buckets[i] = now->buckets[i] - before->buckets[i];
+    dst->count += dst->buckets[i];
+    if (first == HIST_NUM_BUCKETS)
+      first = i;
+    last = i;
+  }
+  if (dst->count == 0)
+    return;
+  dst->minNs = histogramBucketLow(first);
+  if (dst->minNs < now->minNs)
+    dst->minNs = now->minNs;
+  dst->maxNs = histogramBucketHigh(last);
+  if (dst->maxNs > now->maxNs)
+    dst->maxNs = now->maxNs;
+  sumNs = now->meanNs * (double)now->count - before->meanNs * (double)before->count;
+  dst->meanNs = sumNs / (double)dst->count;
+  if (dst->meanNs < (double)dst->minNs)
+    dst->meanNs = (double)dst->minNs;
+  if (dst->meanNs > (double)dst->maxNs)
+    dst->meanNs = (double)dst->maxNs;
+}
+
+/*************************************************************
+*
+* Function: double histogramPercentile(latencyHistogram *h, double percentile)
+*
+* Summary: Returns the value below which percentile % of the samples fall
+*
+* Inputs:
+*   latencyHistogram *h : the histogram
+*   double percentile : 0.0 to 100.0
+*
+* outputs:
+*   returns the value in seconds, 0.0 if the histogram is empty
+*
+* notes:
+*   Like HdrHistogram this reports the top of the bucket holding the
+*   sample, clamped to the observed min and max.
+*
+***************************************************************/
+double histogramPercentile(latencyHistogram *h, double percentile)
+{
+  uint64_t target;
+  uint64_t cumulative = 0;
+  int64_t valueNs = 0;
+  uint32_t i;
+
+  if (h->count == 0)
+    return 0.0;
+  if (percentile > 100.0)
+    percentile = 100.0;
+  target = (uint64_t)ceil(percentile / 100.0 * (double)h->count);
+  if (target < 1)
+    target = 1;
+
+  for (i = 0; i < HIST_NUM_BUCKETS; i++) {
+    cumulative += h->buckets[i];
+    if (cumulative >= target)
+      break;
+  }
+  if (i == HIST_NUM_BUCKETS)
+    i = HIST_NUM_BUCKETS - 1;
+  valueNs = histogramBucketHigh(i);
+  if (valueNs > h->maxNs)
+    valueNs = h->maxNs;
+  if (valueNs < h->minNs)
+    valueNs = h->minNs;
+  return (double)valueNs / 1000000000.0;
+}
+
+double histogramMin(latencyHistogram *h)
+{
+  return (h->count > 0) ? (double)h->minNs / 1000000000.0 : 0.0;
+}
+
+double histogramMax(latencyHistogram *h)
+{
+  return (h->count > 0) ? (double)h->maxNs / 1000000000.0 : 0.0;
+}
+
+double histogramMean(latencyHistogram *h)
+{
+  return h->meanNs / 1000000000.0;
+}
+
+double histogramStdDev(latencyHistogram *h)
+{
+  if (h->count < 2)
+    return 0.0;
+  return sqrt(h->M2 / (double)(h->count - 1)) / 1000000000.0;
+}
+
+/*************************************************************
+*
+* Function: int histogramDump(latencyHistogram *h, char *fileName, char *label)
+*
+* Summary: Writes the non empty buckets to fileName for offline merging
+*
+* Inputs:
+*   latencyHistogram *h : the histogram
+*   char *fileName : file to (over)write
+*   char *label : what the samples are, goes in the header line
+*
+* outputs:
+*   returns NOERROR or ERROR if the file could not be written
+*
+***************************************************************/
+int histogramDump(latencyHistogram *h, char *fileName, char *label)
+{
+  FILE *fp = fopen(fileName, "w");
+  uint32_t i;
+
+  if (fp == NULL)
+    return ERROR;
+
+  fprintf(fp, "# UDPEchoV2 histogram %s subBucketBits %d count %llu minNs %lld maxNs %lld\n",
+          label, HIST_SUB_BUCKET_BITS, (unsigned long long)h->count,
+          (long long)h->minNs, (long long)h->maxNs);
+  for (i = 0; i < HIST_NUM_BUCKETS; i++) {
+    if (h->buckets[i] > 0)
+      fprintf(fp, "%lld %lld %llu\n", (long long)histogramBucketLow(i),
+              (long long)histogramBucketHigh(i), (unsigned long long)h->buckets[i]);
+  }
+  if (fclose(fp) != 0)
+    return ERROR;
+  return NOERROR;
+}
@@ -0,0 +1,59 @@
+/************************************************************************
+* File:  latencyHistogram.h
+*
+* Purpose:
+*   Fixed size log-linear (HDR style) histogram of latency samples.
+*   Values up to 2^HIST_SUB_BUCKET_BITS ns get a bucket each, above that
+*   every power of two is split into 2^(HIST_SUB_BUCKET_BITS-1) equal
+*   buckets, so any value is known to within 1/128 of itself and a
+*   sample is recorded in O(1) with no allocation.
+*
+* Notes:
+*   Samples are double seconds like the rest of the tool and are kept
+*   in nanoseconds.  Negative samples (an OWD between unsynchronized
+*   clocks) count toward min/mean/stddev but land in bucket 0.
+*   Samples above HIST_MAX_VALUE_NS land in the last bucket.
+*   An all zero latencyHistogram is a valid empty histogram.
+*
+*   histogramDump() writes one line per non empty bucket:
+*     <lowNs> <highNs> <count>
+*   after a '#' header line, so dumps of several runs can be merged
+*   by adding the counts of equal lowNs.
+*
+************************************************************************/
+#ifndef	__latencyHistogram_h
+#define	__latencyHistogram_h
+
+#define HIST_SUB_BUCKET_BITS 8
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BUCKET_BITS)
+#define HIST_HALF_BUCKETS (HIST_SUB_BUCKETS / 2)
+//Highest power of two with its own buckets, values reach 2^38 ns (about 275 seconds)
+#define HIST_MAX_EXPONENT 37
+#define HIST_MAX_VALUE_NS ((1LL << (HIST_MAX_EXPONENT + 1)) - 1)
+#define HIST_NUM_BUCKETS (HIST_SUB_BUCKETS + \
+                          (HIST_MAX_EXPONENT - HIST_SUB_BUCKET_BITS + 1) * HIST_HALF_BUCKETS)
+
+typedef struct {
+  uint64_t count;
+  int64_t minNs;
+  int64_t maxNs;
+  //running mean and sum of squared deviations (Welford)
+  double meanNs;
+  double M2;
+  uint64_t buckets[HIST_NUM_BUCKETS];
+} latencyHistogram;
+
+void histogramInit(latencyHistogram *h);
+void histogramRecord(latencyHistogram *h, double sample);
+void histogramMerge(latencyHistogram *dst, latencyHistogram *src);
+void histogramDelta(latencyHistogram *dst, latencyHistogram *now, latencyHistogram *before);
+double histogramPercentile(latencyHistogram *h, double percentile);
+double histogramMin(latencyHistogram *h);
+double histogramMax(latencyHistogram *h);
+double histogramMean(latencyHistogram *h);
+double histogramStdDev(latencyHistogram *h);
+int histogramDump(latencyHistogram *h, char *fileName, char *label);
+
+#endif
+
+
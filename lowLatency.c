@@ -0,0 +1,122 @@
+/*********************************************************
+* Module Name:  Low latency settings
+*
+* File Name:    lowLatency.c
+*
+* Summary:
+*   Busy polling, mlockall(), cpu pinning and SCHED_FIFO for the
+*   client's and server's packet threads.  See lowLatency.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "utils.h"
+#include "lowLatency.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+void lowLatencyInit(lowLatencySettings *s)
+{
+  memset(s, 0, sizeof(lowLatencySettings));
+  s->cpu = -1;
+}
+
+/*************************************************************
+*
+* Function: int lowLatencySocket(lowLatencySettings *s, int sock,
+*                                bool nonBlocking)
+*
+* Summary: In busy poll mode sets SO_BUSY_POLL on the socket and, if
+*          asked to, makes it non-blocking so receives can spin on it
+*
+* Inputs:
+*   lowLatencySettings *s : busyPollRequested usecs, 0 for the default
+*   int sock : the socket
+*   bool nonBlocking : set O_NONBLOCK, for a receive call without flags
+*
+* outputs:
+*   returns NOERROR, or ERROR if SO_BUSY_POLL was refused; busyPollApplied
+*   is what the socket reports, -1 if it was refused
+*
+***************************************************************/
+int lowLatencySocket(lowLatencySettings *s, int sock, bool nonBlocking)
+{
+  int usecs = (s->busyPollRequested > 0) ? s->busyPollRequested : LOW_LATENCY_DEFAULT_BUSY_POLL_USECS;
+  socklen_t len = sizeof(usecs);
+
+  if (!s->busyPoll)
+    return NOERROR;
+  if (nonBlocking)
+    sockBlockingOff(sock);
+  s->busyPollRequested = usecs;
+  if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)) < 0) {
+    s->busyPollApplied = -1;
+    return ERROR;
+  }
+  if (getsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usecs, &len) < 0)
+    usecs = -1;
+  s->busyPollApplied = usecs;
+  return NOERROR;
+}
+
+/*************************************************************
+*
+* Function: int lowLatencyLockMemory(lowLatencySettings *s)
+*
+* Summary: In busy poll mode locks the process's memory, now and
+*          what it maps later, so no sample waits on a page fault
+*
+* outputs:
+*   returns NOERROR, or ERROR (errno set) if mlockall() failed
+*
+***************************************************************/
+int lowLatencyLockMemory(lowLatencySettings *s)
+{
+  if (!s->busyPoll)
+    return NOERROR;
+  s->memoryLocked = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+  return s->memoryLocked ? NOERROR : ERROR;
+}
+
+/*************************************************************
+*
+* Function: int lowLatencyThread(lowLatencySettings *s, int cpu)
+*
+* Summary: Pins the calling thread to cpu and, if fifoRequested is
+*          set, moves it to SCHED_FIFO at that priority
+*
+* Inputs:
+*   int cpu : cpu to pin to, -1 leaves the affinity alone
+*
+* outputs:
+*   returns NOERROR, or ERROR if either was refused.  Records the cpu,
+*   whether the pinning took and the priority granted (-1 if refused).
+*
+***************************************************************/
+int lowLatencyThread(lowLatencySettings *s, int cpu)
+{
+  struct sched_param param;
+  int rc = NOERROR;
+
+  s->cpu = cpu;
+  if (cpu >= 0) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    s->pinned = (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0);
+    if (!s->pinned)
+      rc = ERROR;
+  }
+  if (s->fifoRequested > 0) {
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = s->fifoRequested;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+      s->fifoApplied = s->fifoRequested;
+    } else {
+      s->fifoApplied = -1;
+      rc = ERROR;
+    }
+  }
+  return rc;
+}
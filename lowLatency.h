@@ -0,0 +1,50 @@
+/************************************************************************
+* File:  lowLatency.h
+*
+* Purpose:
+*   Settings for measuring the lowest RTT and OWD a host can give: busy
+*   polling sockets, memory locked against page faults, a pinned thread
+*   and SCHED_FIFO.  A blocking receive costs a wakeup, tens of
+*   microseconds of jitter on every sample, that a thread spinning on
+*   a non-blocking receive does not pay.
+*
+* Notes:
+*   Each setting is applied on a best effort basis and what the kernel
+*   actually granted is recorded in a lowLatencySettings, so the summary
+*   shows the conditions a result was measured under: SO_BUSY_POLL as
+*   read back from the socket, -1 where a setting was asked for and
+*   refused (raising SO_BUSY_POLL and SCHED_FIFO need CAP_NET_ADMIN and
+*   CAP_SYS_NICE or RLIMIT_RTPRIO).
+*
+*   A spinning SCHED_FIFO thread keeps everything of lower priority
+*   off its cpu but for the kernel's RT throttling share, pin it to a
+*   cpu of its own.
+*
+************************************************************************/
+#ifndef	__lowLatency_h
+#define	__lowLatency_h
+
+//SO_BUSY_POLL microseconds when -p is given 0
+#define LOW_LATENCY_DEFAULT_BUSY_POLL_USECS 50
+
+typedef struct {
+  //busy poll mode, and the SO_BUSY_POLL usecs asked for and granted
+  bool busyPoll;
+  int busyPollRequested;
+  int busyPollApplied;
+  bool memoryLocked;
+  //SCHED_FIFO priority asked for and granted, 0 for not asked
+  int fifoRequested;
+  int fifoApplied;
+  //cpu asked for, -1 for none, and whether the pinning took
+  int cpu;
+  bool pinned;
+} lowLatencySettings;
+
+void lowLatencyInit(lowLatencySettings *s);
+int lowLatencySocket(lowLatencySettings *s, int sock, bool nonBlocking);
+int lowLatencyLockMemory(lowLatencySettings *s);
+int lowLatencyThread(lowLatencySettings *s, int cpu);
+
+#endif
+
@@ -0,0 +1,179 @@
+/*********************************************************
+* Module Name:  CBR pacer
+*
+* File Name:    pacer.c
+*
+* Summary:
+*   Holds a target packet rate for the opMode 1 traffic generator.
+*   See pacer.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+#include "pacer.h"
+
+#include <sys/prctl.h>
+
+/***********************************************************
+* Function: int64_t pacerNowNs()
+*
+* Explanation:  Returns the pacer's clock, timeNowNs()
+*
+***********************************************************/
+int64_t pacerNowNs()
+{
+  return timeNowNs();
+}
+
+/*************************************************************
+*
+* Function: void pacerInit(pacer *p, double packetRate, uint32_t burst,
+*                          int64_t spinNs)
+*
+* Summary: Sets up a pacer for packetRate packets per second.
+*
+* Inputs:
+*   pacer *p : caller's pacer
+*   double packetRate : target packets/second, 0 disables pacing
+*   uint32_t burst : token bucket depth in packets, 1 is strict CBR
+*   int64_t spinNs : spin (rather than sleep) this close to a deadline
+*
+***************************************************************/
+void pacerInit(pacer *p, double packetRate, uint32_t burst, int64_t spinNs)
+{
+  memset(p, 0, sizeof(pacer));
+  if (packetRate > 0.0)
+    p->intervalNs = (int64_t)(1000000000.0 / packetRate);
+  p->burst = (burst < 1) ? 1 : burst;
+  p->spinNs = (spinNs < 0) ? 0 : spinNs;
+  p->errMin = INT64_MAX;
+  p->errMax = INT64_MIN;
+
+  //The default 50us timer slack would push every wakeup past the spin window
+  if (p->intervalNs > 0)
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+}
+
+/*************************************************************
+*
+* Function: int64_t pacerWait(pacer *p)
+*
+* Summary: Blocks until the next packet may be sent and records the
+*          pacing error of this send.
+*
+* Inputs:
+*   pacer *p : the pacer
+*
+* outputs:
+*   returns the pacing error in ns: how much later than its own slot
+*   the caller was released, 0 if it went early on bucket credit.
+*
+* notes:
+*   GCRA form of a token bucket: a packet may go once the clock reaches
+*   nextDeadline - (burst-1)*interval.  nextDeadline then moves one
+*   interval on from its old value, not from the release time, so spin
+*   overshoot is not carried forward.  A caller that arrives after
+*   nextDeadline has it pulled up to its arrival time, which limits any
+*   catch up to the bucket depth: with -B 1 nothing goes back to back.
+*
+*   A packet's slot is its nextDeadline before any pull up, or the
+*   previous release if that was later.  The error is taken against the
+*   slot rather than the bucket's allowance, so a sender that is behind
+*   shows it and bucket credit does not count as lateness.
+*
+***************************************************************/
+int64_t pacerWait(pacer *p)
+{
+  int64_t now = pacerNowNs();
+  int64_t allowed = 0;
+  int64_t slot = 0;
+  int64_t err = 0;
+  struct timespec sleepFor;
+
+  if (p->packetCount == 0) {
+    p->nextDeadline = now;
+    p->firstSendNs = now;
+  }
+
+  if (p->intervalNs > 0) {
+    slot = (p->nextDeadline > p->lastSendNs) ? p->nextDeadline : p->lastSendNs;
+    allowed = p->nextDeadline - (int64_t)(p->burst - 1) * p->intervalNs;
+    //max(TAT, arrival): a late caller earns no credit beyond the bucket
+    if (p->nextDeadline < now)
+      p->nextDeadline = now;
+
+    //Sleep most of the way ...  timeNowNs() may be the TSC which the
+    //kernel cannot sleep against, so the sleep is relative, the spin
+    //below takes care of the deadline itself
+    if (allowed - now > p->spinNs) {
+      int64_t sleepNs = allowed - p->spinNs - now;
+      sleepFor.tv_sec = sleepNs / NS_PER_SEC;
+      sleepFor.tv_nsec = sleepNs % NS_PER_SEC;
+      while (clock_nanosleep(CLOCK_MONOTONIC, 0, &sleepFor, &sleepFor) == EINTR)
+        ;
+    }
+    //... then spin to the deadline itself
+    do {
+      now = pacerNowNs();
+    } while (now < allowed);
+
+    p->nextDeadline += p->intervalNs;
+    if (now > slot)
+      err = now - slot;
+  }
+
+  p->lastSendNs = now;
+  p->packetCount++;
+
+  if (err < p->errMin)
+    p->errMin = err;
+  if (err > p->errMax)
+    p->errMax = err;
+  p->errSum += (double)err;
+  p->errSqSum += (double)err * (double)err;
+  if (err < 1000)
+    p->errBuckets[0]++;
+  else if (err < 10000)
+    p->errBuckets[1]++;
+  else if (err < 100000)
+    p->errBuckets[2]++;
+  else if (err < 1000000)
+    p->errBuckets[3]++;
+  else
+    p->errBuckets[4]++;
+
+  return err;
+}
+
+/*************************************************************
+*
+* Function: double pacerAchievedRate(pacer *p)
+*
+* Summary: Returns the packets/second actually released, measured
+*          from the first to the last send.
+*
+***************************************************************/
+double pacerAchievedRate(pacer *p)
+{
+  if ((p->packetCount < 2) || (p->lastSendNs <= p->firstSendNs))
+    return 0.0;
+  return (double)(p->packetCount - 1) * 1000000000.0 / (double)(p->lastSendNs - p->firstSendNs);
+}
+
+double pacerErrMean(pacer *p)
+{
+  if (p->packetCount == 0)
+    return 0.0;
+  return p->errSum / (double)p->packetCount;
+}
+
+double pacerErrStdDev(pacer *p)
+{
+  double mean = pacerErrMean(p);
+  double var = 0.0;
+
+  if (p->packetCount == 0)
+    return 0.0;
+  var = p->errSqSum / (double)p->packetCount - mean * mean;
+  return (var > 0.0) ? sqrt(var) : 0.0;
+}
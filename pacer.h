@@ -0,0 +1,51 @@
+/************************************************************************
+* File:  pacer.h
+*
+* Purpose:
+*   Constant bit rate pacing for the client's opMode 1 traffic generator.
+*   Sends are scheduled against absolute deadlines so
+*   timing errors do not accumulate, and each wait sleeps until shortly
+*   before the deadline and then spins the rest of the way.
+*   An optional token bucket lets up to burst packets go back to back.
+*
+* Notes:
+*   All times are int64_t nanoseconds from timeNowNs() (timeBase.h).
+*
+************************************************************************/
+#ifndef	__pacer_h
+#define	__pacer_h
+
+//Default time before a deadline at which the pacer stops sleeping and spins
+#define PACER_DEFAULT_SPIN_NS 50000
+
+//Pacing error buckets: <1us, <10us, <100us, <1ms, >=1ms
+#define PACER_ERR_BUCKETS 5
+
+typedef struct {
+  //0 means unpaced
+  int64_t intervalNs;
+  uint32_t burst;
+  int64_t spinNs;
+  //theoretical send time of the next packet (token bucket TAT)
+  int64_t nextDeadline;
+  int64_t firstSendNs;
+  int64_t lastSendNs;
+  uint64_t packetCount;
+  //how late each send was relative to its slot (see pacerWait())
+  int64_t errMin;
+  int64_t errMax;
+  double errSum;
+  double errSqSum;
+  uint64_t errBuckets[PACER_ERR_BUCKETS];
+} pacer;
+
+int64_t pacerNowNs();
+void pacerInit(pacer *p, double packetRate, uint32_t burst, int64_t spinNs);
+int64_t pacerWait(pacer *p);
+double pacerAchievedRate(pacer *p);
+double pacerErrMean(pacer *p);
+double pacerErrStdDev(pacer *p);
+
+#endif
+
+
@@ -0,0 +1,222 @@
+/*********************************************************
+* Module Name:  Binary per packet log
+*
+* File Name:    packetLog.c
+*
+* Summary:
+*   SPSC rings of fixed size packet records drained to a file by a
+*   background writer thread.  See packetLog.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "packetLog.h"
+
+static void *packetLogWriter(void *arg);
+static uint32_t packetLogDrain(packetLog *log);
+static void packetLogFlush(packetLog *log);
+
+/*************************************************************
+*
+* Function: int packetLogOpen(packetLog *log, char *fileName,
+*                             uint32_t numberRings)
+*
+* Summary: Creates the log file, the rings and the writer thread.
+*
+* Inputs:
+*   packetLog *log : caller's log
+*   char *fileName : file to (over)write
+*   uint32_t numberRings : one per producer thread
+*
+* outputs:
+*   returns NOERROR or ERROR (errno set) if anything could not be set up
+*
+***************************************************************/
+int packetLogOpen(packetLog *log, char *fileName, uint32_t numberRings)
+{
+  packetLogFileHeader header;
+  uint32_t i;
+
+  memset(log, 0, sizeof(packetLog));
+  log->numberRings = numberRings;
+  log->fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (log->fd < 0)
+    return ERROR;
+
+  if (posix_memalign((void **)&log->rings, CACHE_LINE_SIZE, numberRings * sizeof(packetLogRing)) != 0)
+    return ERROR;
+  memset(log->rings, 0, numberRings * sizeof(packetLogRing));
+  for (i = 0; i < numberRings; i++) {
+    log->rings[i].records = calloc(PACKET_LOG_RING_SIZE, sizeof(packetLogRecord));
+    if (log->rings[i].records == NULL)
+      return ERROR;
+  }
+  log->writeBuffer = calloc(PACKET_LOG_WRITE_RECORDS, sizeof(packetLogRecord));
+  if (log->writeBuffer == NULL)
+    return ERROR;
+
+  memset(&header, 0, sizeof(header));
+  header.magic = PACKET_LOG_MAGIC;
+  header.version = PACKET_LOG_VERSION;
+  header.recordSize = sizeof(packetLogRecord);
+  header.numberRings = numberRings;
+  if (write(log->fd, &header, sizeof(header)) != sizeof(header))
+    return ERROR;
+
+  atomic_store(&log->stop, false);
+  errno = pthread_create(&log->writer, NULL, packetLogWriter, log);
+  if (errno != 0)
+    return ERROR;
+  log->isOpen = true;
+  return NOERROR;
+}
+
+/*************************************************************
+*
+* Function: void packetLogAppend(packetLog *log, uint32_t ring,
+*                                packetLogRecord *record)
+*
+* Summary: Queues one record.  Only the thread that owns ring may
+*          append to it.  Never blocks, a full ring drops the record.
+*
+* Inputs:
+*   packetLog *log : the log
+*   uint32_t ring : the caller's ring
+*   packetLogRecord *record : filled in by the caller, ring and
+*                             droppedCount are set here
+*
+***************************************************************/
+void packetLogAppend(packetLog *log, uint32_t ring, packetLogRecord *record)
+{
+  packetLogRing *r = &log->rings[ring];
+  uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  uint64_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+  packetLogRecord *slot;
+
+  if (head - tail >= PACKET_LOG_RING_SIZE) {
+    atomic_fetch_add_explicit(&r->droppedCount, 1, memory_order_relaxed);
+    return;
+  }
+  slot = &r->records[head & (PACKET_LOG_RING_SIZE - 1)];
+  *slot = *record;
+  slot->ring = ring;
+  slot->droppedCount = atomic_load_explicit(&r->droppedCount, memory_order_relaxed);
+  atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+/*************************************************************
+*
+* Function: static uint32_t packetLogDrain(packetLog *log)
+*
+* Summary: One pass of the writer over every ring, moving whatever
+*          is queued into the write buffer (and from there to the file).
+*
+* outputs:
+*   returns the number of records moved
+*
+***************************************************************/
+static uint32_t packetLogDrain(packetLog *log)
+{
+  uint32_t moved = 0;
+  uint32_t i;
+
+  for (i = 0; i < log->numberRings; i++) {
+    packetLogRing *r = &log->rings[i];
+    uint64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+    while (tail != head) {
+      log->writeBuffer[log->bufferedRecords++] = r->records[tail & (PACKET_LOG_RING_SIZE - 1)];
+      tail++;
+      moved++;
+      if (log->bufferedRecords == PACKET_LOG_WRITE_RECORDS) {
+        //hand the slots back before the (slow) write
+        atomic_store_explicit(&r->tail, tail, memory_order_release);
+        packetLogFlush(log);
+      }
+    }
+    atomic_store_explicit(&r->tail, tail, memory_order_release);
+  }
+  packetLogFlush(log);
+  log->recordsWritten += moved;
+  return moved;
+}
+
+static void packetLogFlush(packetLog *log)
+{
+  char *next = (char *)log->writeBuffer;
+  size_t remaining = log->bufferedRecords * sizeof(packetLogRecord);
+  ssize_t rc;
+
+  while (remaining > 0) {
+    rc = write(log->fd, next, remaining);
+    if (rc < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("packetLog: write failed ");
+      break;
+    }
+    next += rc;
+    remaining -= rc;
+  }
+  log->bufferedRecords = 0;
+}
+
+static void *packetLogWriter(void *arg)
+{
+  packetLog *log = (packetLog *)arg;
+  struct timespec idle;
+
+  idle.tv_sec = 0;
+  idle.tv_nsec = PACKET_LOG_IDLE_NS;
+  for (;;) {
+    if (packetLogDrain(log) > 0)
+      continue;
+    //stop is only honored once a pass finds every ring empty
+    if (atomic_load(&log->stop))
+      break;
+    nanosleep(&idle, NULL);
+  }
+  return NULL;
+}
+
+/*************************************************************
+*
+* Function: void packetLogClose(packetLog *log)
+*
+* Summary: Stops the writer once the rings are drained, appends the
+*          trailer records and closes the file.
+*
+***************************************************************/
+void packetLogClose(packetLog *log)
+{
+  packetLogRecord trailer;
+  uint32_t i;
+
+  if (!log->isOpen)
+    return;
+  atomic_store(&log->stop, true);
+  pthread_join(log->writer, NULL);
+
+  for (i = 0; i < log->numberRings; i++) {
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.recordType = PACKET_LOG_TRAILER;
+    trailer.ring = i;
+    trailer.droppedCount = atomic_load(&log->rings[i].droppedCount);
+    log->writeBuffer[log->bufferedRecords++] = trailer;
+    if (log->bufferedRecords == PACKET_LOG_WRITE_RECORDS)
+      packetLogFlush(log);
+  }
+  packetLogFlush(log);
+  close(log->fd);
+  log->isOpen = false;
+}
+
+uint64_t packetLogDropped(packetLog *log)
+{
+  uint64_t dropped = 0;
+  uint32_t i;
+
+  for (i = 0; i < log->numberRings; i++)
+    dropped += atomic_load(&log->rings[i].droppedCount);
+  return dropped;
+}
@@ -0,0 +1,99 @@
+/************************************************************************
+* File:  packetLog.h
+*
+* Purpose:
+*   Per packet records written as fixed size binary structs rather than
+*   printf'd text.  Each producer thread owns a lock-free single
+*   producer / single consumer ring; one background thread drains all
+*   the rings to a file with large sequential write()s.
+*   logdecode (logDecode.c) turns the file back into the text columns
+*   client and server print without -L.
+*
+* Notes:
+*   A producer never blocks: when its ring is full the record is
+*   dropped and counted.  Every record carries the number of records
+*   its ring had dropped before it, and packetLogClose() appends one
+*   PACKET_LOG_TRAILER record per ring with the final count.
+*
+*   Records are written in host byte order, the file is meant to be
+*   decoded on the machine (or at least the architecture) it came from.
+*
+************************************************************************/
+#ifndef	__packetLog_h
+#define	__packetLog_h
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define PACKET_LOG_MAGIC 0x55454c47    //"UELG"
+#define PACKET_LOG_VERSION 3
+
+//Records per ring, must be a power of two
+#define PACKET_LOG_RING_SIZE 65536
+//Records gathered per write()
+#define PACKET_LOG_WRITE_RECORDS 1024
+//How long the writer sleeps when every ring is empty
+#define PACKET_LOG_IDLE_NS 1000000
+
+//Record types
+#define PACKET_LOG_CLIENT_RTT 1
+#define PACKET_LOG_SERVER_OWD 2
+#define PACKET_LOG_TRAILER 3
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t numberRings;
+  uint32_t reserved;
+} packetLogFileHeader;
+
+//One per packet, 80 bytes.  Fields a record type does not use are 0.
+typedef struct {
+  uint16_t recordType;
+  uint16_t ring;
+  uint32_t numBytes;
+  uint64_t sequenceNum;
+  uint64_t largestSeqRecv;
+  uint64_t receivedCount;
+  uint32_t numberSamples;
+  uint32_t timeSentSeconds;
+  uint32_t timeSentNanoSeconds;
+  double wallTime;
+  //RTT (client) or OWD (server) sample and its smoothed average
+  double sample;
+  double smoothed;
+  //records this ring dropped before this one
+  uint64_t droppedCount;
+} packetLogRecord;
+
+typedef struct {
+  //written by the producer only
+  _Atomic uint64_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+  _Atomic uint64_t droppedCount;
+  //written by the writer thread only
+  _Atomic uint64_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+  packetLogRecord *records __attribute__((aligned(CACHE_LINE_SIZE)));
+} packetLogRing;
+
+typedef struct {
+  packetLogRing *rings;
+  uint32_t numberRings;
+  int fd;
+  pthread_t writer;
+  atomic_bool stop;
+  packetLogRecord *writeBuffer;
+  uint32_t bufferedRecords;
+  //packet records written, not counting the trailers
+  uint64_t recordsWritten;
+  bool isOpen;
+} packetLog;
+
+int packetLogOpen(packetLog *log, char *fileName, uint32_t numberRings);
+void packetLogAppend(packetLog *log, uint32_t ring, packetLogRecord *record);
+void packetLogClose(packetLog *log);
+uint64_t packetLogDropped(packetLog *log);
+
+#endif
+
+
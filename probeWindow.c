@@ -0,0 +1,252 @@
+/*********************************************************
+* Module Name:  In-flight probe window
+*
+* File Name:    probeWindow.c
+*
+* Summary:
+*   Sequence indexed ring of outstanding probes used by the
+*   client's windowed (pipelined) ping mode.  See probeWindow.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "probeWindow.h"
+
+static void probeWindowAdvance(probeWindow *window);
+
+/*************************************************************
+*
+* Function: int probeWindowInit(probeWindow *window, uint32_t windowSize,
+*                               uint64_t firstSeq)
+*
+* Summary: Allocates the ring for up to windowSize outstanding probes.
+*
+* Inputs:
+*   probeWindow *window : caller's window to init
+*   uint32_t windowSize : max probes in flight
+*   uint64_t firstSeq : sequence number of the first probe
+*
+* outputs:
+*   returns SUCCESS or ERROR if the ring could not be allocated
+*
+***************************************************************/
+int probeWindowInit(probeWindow *window, uint32_t windowSize, uint64_t firstSeq)
+{
+  memset(window, 0, sizeof(probeWindow));
+  if (windowSize < 1)
+    windowSize = 1;
+  window->slots = calloc(windowSize, sizeof(probeSlot));
+  if (window->slots == NULL)
+    return ERROR;
+  window->windowSize = windowSize;
+  window->baseSeq = firstSeq;
+  window->nextSeq = firstSeq;
+  return SUCCESS;
+}
+
+void probeWindowFree(probeWindow *window)
+{
+  free(window->slots);
+  window->slots = NULL;
+}
+
+/*************************************************************
+*
+* Function: bool probeWindowCanSend(probeWindow *window)
+*
+* Summary: True if another probe fits in the window
+*
+***************************************************************/
+bool probeWindowCanSend(probeWindow *window)
+{
+  return (window->nextSeq - window->baseSeq) < window->windowSize;
+}
+
+/*************************************************************
+*
+* Function: void probeWindowSent(probeWindow *window, uint64_t sequenceNum,
+*                                int64_t txTime)
+*
+* Summary: Records a probe that was just sent.  Probes must be
+*          recorded in sequence order and only when
+*          probeWindowCanSend() is true.
+*
+* Inputs:
+*   probeWindow *window : the window
+*   uint64_t sequenceNum : the probe's sequence number
+*   int64_t txTime : timeNowNs() taken just before the send
+*
+***************************************************************/
+void probeWindowSent(probeWindow *window, uint64_t sequenceNum, int64_t txTime)
+{
+  probeSlot *slot = &window->slots[sequenceNum % window->windowSize];
+
+  slot->sequenceNum = sequenceNum;
+  slot->state = PROBE_INFLIGHT;
+  slot->txTime = txTime;
+  slot->kernelTxTime = 0;
+  window->nextSeq = sequenceNum + 1;
+  window->inFlight++;
+  if (window->inFlight > window->maxInFlight)
+    window->maxInFlight = window->inFlight;
+}
+
+/*************************************************************
+*
+* Function: int probeWindowAck(probeWindow *window, uint64_t sequenceNum,
+*                              int64_t rxTime, int64_t *RTTSample)
+*
+* Summary: Matches a reply against the probe it echoes.
+*
+* Inputs:
+*   probeWindow *window : the window
+*   uint64_t sequenceNum : sequence number carried by the reply
+*   int64_t rxTime : timeNowNs() taken when the reply arrived
+*   int64_t *RTTSample : filled in (ns) when the reply is PROBE_MATCHED
+*
+* outputs:
+*   returns PROBE_MATCHED, PROBE_LATE, PROBE_DUPLICATE or PROBE_UNKNOWN
+*   and updates the window's counters
+*
+* notes:
+*   A reply whose slot has since been reused by a newer probe is for
+*   a probe that left the window long ago and is counted as late.
+*
+***************************************************************/
+int probeWindowAck(probeWindow *window, uint64_t sequenceNum, int64_t rxTime, int64_t *RTTSample)
+{
+  probeSlot *slot = &window->slots[sequenceNum % window->windowSize];
+
+  //at or beyond the next sequence number to send
+  if (sequenceNum >= window->nextSeq) {
+    window->unknownCount++;
+    return PROBE_UNKNOWN;
+  }
+
+  if (slot->sequenceNum != sequenceNum) {
+    window->lateCount++;
+    return PROBE_LATE;
+  }
+
+  switch (slot->state) {
+    case PROBE_INFLIGHT:
+      *RTTSample = rxTime - slot->txTime;
+      slot->state = PROBE_ACKED;
+      window->inFlight--;
+      probeWindowAdvance(window);
+      return PROBE_MATCHED;
+    case PROBE_ACKED:
+      window->duplicateCount++;
+      return PROBE_DUPLICATE;
+    case PROBE_TIMEDOUT:
+      window->lateCount++;
+      return PROBE_LATE;
+    default:
+      window->unknownCount++;
+      return PROBE_UNKNOWN;
+  }
+}
+
+/*************************************************************
+*
+* Function: uint32_t probeWindowExpire(probeWindow *window, int64_t now,
+*                                      int64_t timeout)
+*
+* Summary: Declares every probe sent more than timeout ns ago
+*          as timed out, freeing its place in the window.
+*
+* Inputs:
+*   probeWindow *window : the window
+*   int64_t now : current timestamp (same clock as the txTimes)
+*   int64_t timeout : ns a probe may be outstanding
+*
+* outputs:
+*   returns the number of probes that timed out on this call
+*
+* notes:
+*   Probes are sent in sequence order so the scan stops at the first
+*   in-flight probe that has not expired.
+*
+***************************************************************/
+uint32_t probeWindowExpire(probeWindow *window, int64_t now, int64_t timeout)
+{
+  uint32_t expired = 0;
+  uint64_t seq;
+
+  for (seq = window->baseSeq; seq != window->nextSeq; seq++) {
+    probeSlot *slot = &window->slots[seq % window->windowSize];
+    if (slot->state != PROBE_INFLIGHT)
+      continue;
+    if (slot->txTime + timeout > now)
+      break;
+    slot->state = PROBE_TIMEDOUT;
+    window->inFlight--;
+    expired++;
+  }
+  window->timeoutCount += expired;
+  probeWindowAdvance(window);
+  return expired;
+}
+
+/*************************************************************
+*
+* Function: int64_t probeWindowNextDeadline(probeWindow *window, int64_t timeout)
+*
+* Summary: Returns the time the oldest in-flight probe times out,
+*          or 0 if nothing is in flight.
+*
+***************************************************************/
+int64_t probeWindowNextDeadline(probeWindow *window, int64_t timeout)
+{
+  uint64_t seq;
+
+  for (seq = window->baseSeq; seq != window->nextSeq; seq++) {
+    probeSlot *slot = &window->slots[seq % window->windowSize];
+    if (slot->state == PROBE_INFLIGHT)
+      return slot->txTime + timeout;
+  }
+  return 0;
+}
+
+/*************************************************************
+*
+* Function: void probeWindowSetKernelTx(probeWindow *window,
+*                      uint64_t sequenceNum, int64_t kernelTxTime)
+*
+* Summary: Attaches the kernel TX timestamp to an in-flight probe.
+*          Ignored if the probe has already left the window.
+*
+***************************************************************/
+void probeWindowSetKernelTx(probeWindow *window, uint64_t sequenceNum, int64_t kernelTxTime)
+{
+  probeSlot *slot = &window->slots[sequenceNum % window->windowSize];
+
+  if ((slot->sequenceNum == sequenceNum) && (slot->state == PROBE_INFLIGHT))
+    slot->kernelTxTime = kernelTxTime;
+}
+
+/*************************************************************
+*
+* Function: int64_t probeWindowKernelTx(probeWindow *window, uint64_t sequenceNum)
+*
+* Summary: Returns the kernel TX timestamp of a probe, 0 if unknown
+*
+***************************************************************/
+int64_t probeWindowKernelTx(probeWindow *window, uint64_t sequenceNum)
+{
+  probeSlot *slot = &window->slots[sequenceNum % window->windowSize];
+
+  if (slot->sequenceNum != sequenceNum)
+    return 0;
+  return slot->kernelTxTime;
+}
+
+//Moves baseSeq past the probes that are no longer in flight
+static void probeWindowAdvance(probeWindow *window)
+{
+  while (window->baseSeq != window->nextSeq) {
+    probeSlot *slot = &window->slots[window->baseSeq % window->windowSize];
+    if (slot->state == PROBE_INFLIGHT)
+      break;
+    window->baseSeq++;
+  }
+}
@@ -0,0 +1,69 @@
+/************************************************************************
+* File:  probeWindow.h
+*
+* Purpose:
+*   Tracks the probes a client has in flight when it keeps more than
+*   one outstanding.  Probes live in a ring indexed by sequence number
+*   that holds each probe's send timestamp, so replies can be matched
+*   in O(1) and the RTT computed for the probe the reply belongs to.
+*
+* Notes:
+*   A probe may only be sent when fewer than windowSize sequence
+*   numbers separate it from the oldest probe still in flight, so a
+*   slot is never reused while its probe is outstanding.
+*
+*   Times are int64_t nanoseconds, txTime from timeNowNs() and the
+*   kernel TX timestamp from the socket (CLOCK_REALTIME).
+*
+************************************************************************/
+#ifndef	__probeWindow_h
+#define	__probeWindow_h
+
+//Slot states
+#define PROBE_EMPTY     0
+#define PROBE_INFLIGHT  1
+#define PROBE_ACKED     2
+#define PROBE_TIMEDOUT  3
+
+//What a reply turned out to be
+#define PROBE_MATCHED   0   //first reply for a probe still in flight
+#define PROBE_LATE      1   //reply for a probe already declared timed out
+#define PROBE_DUPLICATE 2   //another reply for a probe already acked
+#define PROBE_UNKNOWN   3   //sequence number that was never sent
+
+typedef struct {
+  uint64_t sequenceNum;
+  uint32_t state;
+  int64_t txTime;
+  //kernel TX timestamp, 0 until (unless) one is read back
+  int64_t kernelTxTime;
+} probeSlot;
+
+typedef struct {
+  probeSlot *slots;
+  uint32_t windowSize;
+  uint32_t inFlight;
+  uint32_t maxInFlight;
+  //oldest sequence number that may still be in flight
+  uint64_t baseSeq;
+  //sequence number the next probe will carry
+  uint64_t nextSeq;
+  uint32_t lateCount;
+  uint32_t duplicateCount;
+  uint32_t timeoutCount;
+  uint32_t unknownCount;
+} probeWindow;
+
+int probeWindowInit(probeWindow *window, uint32_t windowSize, uint64_t firstSeq);
+void probeWindowFree(probeWindow *window);
+bool probeWindowCanSend(probeWindow *window);
+void probeWindowSent(probeWindow *window, uint64_t sequenceNum, int64_t txTime);
+int probeWindowAck(probeWindow *window, uint64_t sequenceNum, int64_t rxTime, int64_t *RTTSample);
+uint32_t probeWindowExpire(probeWindow *window, int64_t now, int64_t timeout);
+int64_t probeWindowNextDeadline(probeWindow *window, int64_t timeout);
+void probeWindowSetKernelTx(probeWindow *window, uint64_t sequenceNum, int64_t kernelTxTime);
+int64_t probeWindowKernelTx(probeWindow *window, uint64_t sequenceNum);
+
+#endif
+
+
@@ -0,0 +1,84 @@
+/*********************************************************
+* Module Name:  Rate search
+*
+* File Name:    rateSearch.c
+*
+* Summary:
+*   Binary search for the highest rate within a loss threshold.
+*   See rateSearch.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "rateSearch.h"
+
+/*************************************************************
+*
+* Function: void rateSearchInit(rateSearch *r, double ceilingPps,
+*                   double maxLoss, double resolution, uint32_t maxTrials)
+*
+* Summary: Starts a search below ceilingPps
+*
+* Inputs:
+*   double ceilingPps : the first and highest rate tried
+*   double maxLoss : loss a trial may have and still pass, 0 to 1
+*   double resolution : the search ends once the rates that passed and
+*                       failed are closer than this share of the ceiling
+*   uint32_t maxTrials : and at the latest after this many trials
+*
+***************************************************************/
+void rateSearchInit(rateSearch *r, double ceilingPps, double maxLoss, double resolution, uint32_t maxTrials)
+{
+  memset(r, 0, sizeof(rateSearch));
+  r->ceilingPps = ceilingPps;
+  r->maxLoss = (maxLoss < 0.0) ? 0.0 : maxLoss;
+  r->resolution = (resolution > 0.0) ? resolution : RATE_SEARCH_DEFAULT_RESOLUTION;
+  r->maxTrials = (maxTrials > 0) ? maxTrials : RATE_SEARCH_MAX_TRIALS;
+  r->failPps = ceilingPps;
+}
+
+/*************************************************************
+*
+* Function: double rateSearchNext(rateSearch *r)
+*
+* Summary: The rate of the next trial
+*
+* outputs:
+*   returns packets/sec, or 0 once the search is over
+*
+***************************************************************/
+double rateSearchNext(rateSearch *r)
+{
+  if (r->trialCount == 0)
+    return r->ceilingPps;
+  if ((r->trialCount >= r->maxTrials) || (r->passPps >= r->ceilingPps) ||
+      (r->failPps - r->passPps < r->resolution * r->ceilingPps))
+    return 0.0;
+  return (r->passPps + r->failPps) / 2.0;
+}
+
+/*************************************************************
+*
+* Function: bool rateSearchResult(rateSearch *r, double offeredPps,
+*                                 double achievedPps, double loss)
+*
+* Summary: Records how the trial at offeredPps went
+*
+* outputs:
+*   returns true if it passed
+*
+***************************************************************/
+bool rateSearchResult(rateSearch *r, double offeredPps, double achievedPps, double loss)
+{
+  r->trialCount++;
+  if (loss > r->maxLoss) {
+    if (offeredPps < r->failPps)
+      r->failPps = offeredPps;
+    return false;
+  }
+  if (offeredPps > r->passPps) {
+    r->passPps = offeredPps;
+    r->passAchievedPps = achievedPps;
+    r->passLoss = loss;
+  }
+  return true;
+}
@@ -0,0 +1,58 @@
+/************************************************************************
+* File:  rateSearch.h
+*
+* Purpose:
+*   The highest packet rate a path carries with no more than a given
+*   loss, found as in the RFC 2544 throughput test: trials of a fixed
+*   length at an offered rate, the rate halved towards the last one that
+*   passed after a failure and towards the last one that failed after a
+*   pass, until the two are close enough.
+*
+* Notes:
+*   The first trial runs at the ceiling, the fastest rate worth trying.
+*   If it passes the search is over, the result is only a lower bound
+*   then.  After that every trial is the midpoint of the highest rate
+*   that passed (0 at first) and the lowest that failed, and the search
+*   ends once they are less than resolution times the ceiling apart or
+*   maxTrials have run.  The result is the highest rate that passed.
+*
+*   A trial passes if its loss is no more than maxLoss, so a maxLoss of
+*   0 asks for no loss at all, as RFC 2544 does.
+*
+************************************************************************/
+#ifndef	__rateSearch_h
+#define	__rateSearch_h
+
+//Defaults of the search's end: the gap left as a share of the ceiling, and the trials
+#define RATE_SEARCH_DEFAULT_RESOLUTION 0.01
+#define RATE_SEARCH_MAX_TRIALS 20
+//Defaults of a trial's length and of the warm-up sent ahead of it, seconds
+#define RATE_SEARCH_DEFAULT_TRIAL_SECS 1.0
+#define RATE_SEARCH_DEFAULT_WARMUP_SECS 0.2
+//Sends between reads of the replies during a trial
+#define RATE_SEARCH_READ_EVERY 16
+//How long replies are waited for after a trial's last send
+#define RATE_SEARCH_DRAIN_NS 100000000LL
+//Message sizes one run may search
+#define RATE_SEARCH_MAX_SIZES 16
+
+typedef struct {
+  double ceilingPps;
+  double maxLoss;
+  double resolution;
+  uint32_t maxTrials;
+  uint32_t trialCount;
+  //highest offered rate that passed, with its achieved rate and loss,
+  //and the lowest that failed
+  double passPps;
+  double passAchievedPps;
+  double passLoss;
+  double failPps;
+} rateSearch;
+
+void rateSearchInit(rateSearch *r, double ceilingPps, double maxLoss, double resolution, uint32_t maxTrials);
+double rateSearchNext(rateSearch *r);
+bool rateSearchResult(rateSearch *r, double offeredPps, double achievedPps, double loss);
+
+#endif
+
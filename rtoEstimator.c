@@ -0,0 +1,107 @@
+/*********************************************************
+* Module Name:  RTO estimator
+*
+* File Name:    rtoEstimator.c
+*
+* Summary:
+*   Adaptive probe timeout from the smoothed RTT and its variation.
+*   See rtoEstimator.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "rtoEstimator.h"
+
+static void rtoClamp(rtoEstimator *r);
+
+/*************************************************************
+*
+* Function: void rtoInit(rtoEstimator *r, int64_t minNs, int64_t maxNs,
+*                        double backoff)
+*
+* Summary: Sets up an estimator with no samples yet
+*
+* Inputs:
+*   rtoEstimator *r : caller's estimator
+*   int64_t minNs : floor of the rto
+*   int64_t maxNs : ceiling of the rto, also what backing off stops at
+*   double backoff : factor the rto grows by on each timeout, at least 1
+*
+***************************************************************/
+void rtoInit(rtoEstimator *r, int64_t minNs, int64_t maxNs, double backoff)
+{
+  memset(r, 0, sizeof(rtoEstimator));
+  r->minNs = (minNs < 1) ? 1 : minNs;
+  r->maxNs = (maxNs < r->minNs) ? r->minNs : maxNs;
+  r->backoff = (backoff < 1.0) ? 1.0 : backoff;
+  r->rtoNs = RTO_INITIAL_NS;
+  rtoClamp(r);
+  r->rtoMinSeen = INT64_MAX;
+}
+
+/*************************************************************
+*
+* Function: int64_t rtoCurrent(rtoEstimator *r)
+*
+* Summary: The timeout for the probe about to be waited for, which is
+*          also what the summary's min and max rto record
+*
+***************************************************************/
+int64_t rtoCurrent(rtoEstimator *r)
+{
+  if (r->rtoNs < r->rtoMinSeen)
+    r->rtoMinSeen = r->rtoNs;
+  if (r->rtoNs > r->rtoMaxSeen)
+    r->rtoMaxSeen = r->rtoNs;
+  return r->rtoNs;
+}
+
+/*************************************************************
+*
+* Function: void rtoSample(rtoEstimator *r, int64_t rttNs)
+*
+* Summary: Folds an RTT sample into srtt and rttvar and recomputes
+*          the rto, which also ends any backoff
+*
+***************************************************************/
+void rtoSample(rtoEstimator *r, int64_t rttNs)
+{
+  int64_t err;
+
+  if (rttNs < 0)
+    return;
+  if (r->sampleCount == 0) {
+    r->srttNs = rttNs;
+    r->rttvarNs = rttNs / 2;
+  } else {
+    err = r->srttNs - rttNs;
+    if (err < 0)
+      err = -err;
+    r->rttvarNs += (err - r->rttvarNs) / 4;
+    r->srttNs += (rttNs - r->srttNs) / 8;
+  }
+  r->sampleCount++;
+  r->rtoNs = r->srttNs + 4 * r->rttvarNs;
+  rtoClamp(r);
+}
+
+/*************************************************************
+*
+* Function: void rtoTimeout(rtoEstimator *r)
+*
+* Summary: A probe was not answered within the rto, backs it off
+*
+***************************************************************/
+void rtoTimeout(rtoEstimator *r)
+{
+  r->timeoutCount++;
+  r->rtoNs = (int64_t)((double)r->rtoNs * r->backoff);
+  rtoClamp(r);
+}
+
+static void rtoClamp(rtoEstimator *r)
+{
+  if (r->rtoNs < r->minNs)
+    r->rtoNs = r->minNs;
+  if (r->rtoNs > r->maxNs)
+    r->rtoNs = r->maxNs;
+}
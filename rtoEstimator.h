@@ -0,0 +1,53 @@
+/************************************************************************
+* File:  rtoEstimator.h
+*
+* Purpose:
+*   Retransmission timeout for the client's opMode 0 and 1 probes, how
+*   long a probe is waited for before it counts as lost.  It follows the
+*   RTT rather than being a fixed 2 seconds, so on a LAN a lost probe
+*   costs about a millisecond instead of seconds.
+*
+* Notes:
+*   The RFC 6298 estimator on int64_t nanoseconds:
+*     srtt   = 7/8 srtt + 1/8 rtt
+*     rttvar = 3/4 rttvar + 1/4 |srtt - rtt|
+*     rto    = srtt + 4 rttvar, no less than minNs and no more than maxNs
+*   Until the first sample the rto is RTO_INITIAL_NS.  Every timeout
+*   multiplies the rto by backoff, up to maxNs, so a path that stopped
+*   answering is not probed at the rate of its old RTT; the next sample
+*   recomputes it from the estimator.  A backoff of 1 keeps the rto as it is.
+*
+*   A probe is never resent, so unlike TCP a sample is never ambiguous
+*   and Karn's rule has nothing to skip.  A reply that arrives after its
+*   probe timed out is a spurious timeout, counted by the caller.
+*
+************************************************************************/
+#ifndef	__rtoEstimator_h
+#define	__rtoEstimator_h
+
+//Defaults of the rto floor, the rto before a first sample and the backoff
+#define RTO_DEFAULT_MIN_NS 1000000LL
+#define RTO_INITIAL_NS 1000000000LL
+#define RTO_DEFAULT_BACKOFF 2.0
+
+typedef struct {
+  int64_t minNs;
+  int64_t maxNs;
+  double backoff;
+  int64_t srttNs;
+  int64_t rttvarNs;
+  int64_t rtoNs;
+  //the smallest and largest rto a probe was waited for
+  int64_t rtoMinSeen;
+  int64_t rtoMaxSeen;
+  uint64_t sampleCount;
+  uint64_t timeoutCount;
+} rtoEstimator;
+
+void rtoInit(rtoEstimator *r, int64_t minNs, int64_t maxNs, double backoff);
+int64_t rtoCurrent(rtoEstimator *r);
+void rtoSample(rtoEstimator *r, int64_t rttNs);
+void rtoTimeout(rtoEstimator *r);
+
+#endif
+
@@ -0,0 +1,145 @@
+/*********************************************************
+* Module Name:  Sequence tracker
+*
+* File Name:    seqTracker.c
+*
+* Summary:
+*   Sliding bitmap loss / reorder / duplicate detection for the
+*   sequence numbers a receiver sees.  See seqTracker.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "seqTracker.h"
+
+#define SEQ_BIT_WORD(seq) (((seq) % SEQ_TRACKER_BITS) / 64)
+#define SEQ_BIT_MASK(seq) (1ULL << ((seq) % 64))
+
+static uint64_t seqTrackerMissing(seqTracker *t);
+
+/*************************************************************
+*
+* Function: void seqTrackerInit(seqTracker *t, uint64_t firstSeq)
+*
+* Summary: Resets the tracker to expect firstSeq next.
+*
+* notes:
+*   Every bit starts out set, so the sequence numbers below firstSeq
+*   are never counted as lost.
+*
+*   firstSeq must be at least 1, as sequence numbers on the wire are.
+*   highestSeq is firstSeq - 1, so 0 would wrap it to UINT64_MAX and
+*   every arrival would then be counted as late.
+*
+***************************************************************/
+void seqTrackerInit(seqTracker *t, uint64_t firstSeq)
+{
+  memset(t, 0, sizeof(seqTracker));
+  memset(t->bitmap, 0xff, sizeof(t->bitmap));
+  t->highestSeq = firstSeq - 1;
+}
+
+/*************************************************************
+*
+* Function: int seqTrackerUpdate(seqTracker *t, uint64_t seq)
+*
+* Summary: Accounts for the arrival of one sequence number
+*
+* Inputs:
+*   seqTracker *t : the tracker
+*   uint64_t seq : sequence number carried by the packet
+*
+* outputs:
+*   returns SEQ_IN_ORDER, SEQ_REORDERED, SEQ_DUPLICATE or SEQ_LATE
+*   and updates the tracker's counters
+*
+***************************************************************/
+int seqTrackerUpdate(seqTracker *t, uint64_t seq)
+{
+  uint64_t distance;
+  uint64_t q;
+
+  if (seq > t->highestSeq) {
+    //Slide forward, every skipped slot held a sequence number now leaving the window
+    if (seq - t->highestSeq >= SEQ_TRACKER_BITS) {
+      t->lostCount += seqTrackerMissing(t);
+      t->lostCount += seq - t->highestSeq - SEQ_TRACKER_BITS;
+      memset(t->bitmap, 0, sizeof(t->bitmap));
+    } else {
+      for (q = t->highestSeq + 1; q < seq; q++) {
+        if (!(t->bitmap[SEQ_BIT_WORD(q)] & SEQ_BIT_MASK(q)))
+          t->lostCount++;
+        t->bitmap[SEQ_BIT_WORD(q)] &= ~SEQ_BIT_MASK(q);
+      }
+      if (!(t->bitmap[SEQ_BIT_WORD(seq)] & SEQ_BIT_MASK(seq)))
+        t->lostCount++;
+    }
+    t->bitmap[SEQ_BIT_WORD(seq)] |= SEQ_BIT_MASK(seq);
+    t->highestSeq = seq;
+    t->inOrderCount++;
+    return SEQ_IN_ORDER;
+  }
+
+  distance = t->highestSeq - seq;
+  if (distance >= SEQ_TRACKER_BITS) {
+    t->lateCount++;
+    return SEQ_LATE;
+  }
+  if (t->bitmap[SEQ_BIT_WORD(seq)] & SEQ_BIT_MASK(seq)) {
+    t->duplicateCount++;
+    return SEQ_DUPLICATE;
+  }
+  t->bitmap[SEQ_BIT_WORD(seq)] |= SEQ_BIT_MASK(seq);
+  t->reorderedCount++;
+  t->reorderDistanceSum += distance;
+  if (distance > t->maxReorderDistance)
+    t->maxReorderDistance = distance;
+  return SEQ_REORDERED;
+}
+
+//Sequence numbers in the window that have not arrived (yet)
+static uint64_t seqTrackerMissing(seqTracker *t)
+{
+  uint64_t missing = 0;
+  uint32_t i;
+
+  for (i = 0; i < SEQ_TRACKER_WORDS; i++)
+    missing += 64 - __builtin_popcountll(t->bitmap[i]);
+  return missing;
+}
+
+/*************************************************************
+*
+* Function: uint64_t seqTrackerLost(seqTracker *t)
+*
+* Summary: Returns the packets lost so far: those that left the
+*          window without arriving plus those still missing in it.
+*
+***************************************************************/
+uint64_t seqTrackerLost(seqTracker *t)
+{
+  return t->lostCount + seqTrackerMissing(t);
+}
+
+/*************************************************************
+*
+* Function: void seqTrackerMerge(seqTracker *dst, seqTracker *src)
+*
+* Summary: Adds the counts of src into dst, e.g. to total up the
+*          server's per worker trackers.  dst must have been through
+*          seqTrackerInit(), its bitmap is not merged; src's missing
+*          packets are folded into dst's lost count instead.
+*
+***************************************************************/
+void seqTrackerMerge(seqTracker *dst, seqTracker *src)
+{
+  dst->inOrderCount += src->inOrderCount;
+  dst->reorderedCount += src->reorderedCount;
+  dst->duplicateCount += src->duplicateCount;
+  dst->lateCount += src->lateCount;
+  dst->lostCount += seqTrackerLost(src);
+  dst->reorderDistanceSum += src->reorderDistanceSum;
+  if (src->maxReorderDistance > dst->maxReorderDistance)
+    dst->maxReorderDistance = src->maxReorderDistance;
+  if (src->highestSeq > dst->highestSeq)
+    dst->highestSeq = src->highestSeq;
+}
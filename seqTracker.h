@@ -0,0 +1,60 @@
+/************************************************************************
+* File:  seqTracker.h
+*
+* Purpose:
+*   Receive side sequence number accounting.  A sliding bitmap of the
+*   last SEQ_TRACKER_BITS sequence numbers below the highest one seen
+*   tells each arrival apart as in order, reordered (and by how far),
+*   a duplicate, or too old to tell.  Sequence numbers that slide out
+*   of the bitmap without having arrived are counted as lost.
+*
+* Notes:
+*   Fixed size, no allocation, and O(1) per packet: the bitmap is a
+*   ring indexed by sequence number, so moving the window forward
+*   only touches the bits of the sequence numbers it skips.
+*
+*   A packet more than SEQ_TRACKER_BITS behind the highest sequence
+*   number is counted as late.  It was already counted as lost when
+*   it left the window, and cannot be checked for being a duplicate.
+*
+*   Sequence numbers start at 1; 0 is not a valid firstSeq for
+*   seqTrackerInit().
+*
+************************************************************************/
+#ifndef	__seqTracker_h
+#define	__seqTracker_h
+
+//Reorder window, must be a multiple of 64
+#define SEQ_TRACKER_BITS 1024
+#define SEQ_TRACKER_WORDS (SEQ_TRACKER_BITS / 64)
+
+//What an arrival turned out to be
+#define SEQ_IN_ORDER   0   //above every sequence number seen so far
+#define SEQ_REORDERED  1   //below the highest, first arrival
+#define SEQ_DUPLICATE  2   //already seen
+#define SEQ_LATE       3   //older than the window
+
+typedef struct {
+  //highest sequence number seen, firstSeq-1 before any arrival
+  uint64_t highestSeq;
+  //bit (seq % SEQ_TRACKER_BITS) is set once seq has arrived
+  uint64_t bitmap[SEQ_TRACKER_WORDS];
+  uint64_t inOrderCount;
+  uint64_t reorderedCount;
+  uint64_t duplicateCount;
+  uint64_t lateCount;
+  //left the window without arriving
+  uint64_t lostCount;
+  //how far below the highest sequence number reordered packets arrived
+  uint64_t maxReorderDistance;
+  uint64_t reorderDistanceSum;
+} seqTracker;
+
+void seqTrackerInit(seqTracker *t, uint64_t firstSeq);
+int seqTrackerUpdate(seqTracker *t, uint64_t seq);
+uint64_t seqTrackerLost(seqTracker *t);
+void seqTrackerMerge(seqTracker *dst, seqTracker *src);
+
+#endif
+
+
@@ -6,13 +6,78 @@
 * Summary:
 *  This file contains the client portion of a client/server
 *    UDP-based performance tool.
-*  
+*
 * Usage:
-*     server <service> 
+*     server [-b <batchSize>] [-w <workers>] [-c <firstCpu>] [-T] [-H <histogram file>]
+*            [-L <log file>] [-I <idle secs>] [-U] [-P] [-g] [-Z] [-C] [-i <secs>] [-M]
+*            [-p <usecs>] [-F <priority>] [-q <bytes>] [-Q <bytes>] [-D] <service>
+*
+*     -b <batchSize> : receive up to batchSize datagrams per recvmmsg() call
+*                      and echo them back with one sendmmsg() call.
+*                      The default of 1 runs the classic recvfrom()/sendto() loop.
+*     -w <workers>   : run this many worker threads, each with its own
+*                      SO_REUSEPORT socket bound to the service (default 1).
+*                      A classic BPF reuseport program keeps each flow on one worker.
+*     -c <firstCpu>  : pin worker i to cpu (firstCpu + i) modulo the number of cpus
+*     -T             : take OWD samples from kernel (SO_TIMESTAMPING) RX timestamps
+*     -H <histogram file> : write the OWD histogram buckets to this file at exit
+*     -L <log file>  : write the per iteration output as binary records to this
+*                      file from a background thread instead of printing it.
+*                      Decode it with logdecode.
+*     -I <idle secs> : forget a client after this long without a packet
+*                      (default 60, 0 keeps every client until exit)
+*     -U             : run an io_uring event loop instead (see runUringLoop),
+*                      -b is then ignored
+*     -P             : with -U, have a kernel thread poll the submission queue
+*     -g             : enable UDP_GRO.  A receive may then hold several datagrams
+*                      of one client back to back, they are split again using
+*                      the segment size the kernel reports and each is
+*                      accounted and echoed on its own (see udpSegment.h).
+*     -Z             : echo with MSG_ZEROCOPY, receiving into a pool of pinned
+*                      buffers the echoes are then sent from (see zeroCopy.h).
+*                      Only the classic loop, ignored with -b or -U.
+*     -C             : take intervals from the TSC rather than CLOCK_MONOTONIC_RAW,
+*                      if it is invariant (see timeBase.h)
+*     -i <secs>      : print an Interval line every secs seconds (e.g. 0.1) instead
+*                      of the per iteration output (see intervalReport.h)
+*     -M             : publish live counters to /dev/shm/udpecho-server-<pid> for
+*                      udpecho-stat (see statsShm.h)
+*     -p <usecs>     : busy poll mode (see lowLatency.h).  The worker sockets get
+*                      SO_BUSY_POLL usecs (0 for the default 50) and are made
+*                      non-blocking, the workers spin on receive instead of
+*                      sleeping in it, and memory is mlockall()ed.  Pin them
+*                      with -c.  Not with -U.
+*     -F <priority>  : run the workers SCHED_FIFO at this priority
+*     -q <bytes>     : SO_RCVBUF of the worker sockets, forced past
+*                      net.core.rmem_max when privileged (see sockDrops.h)
+*     -Q <bytes>     : SO_SNDBUF of the worker sockets, likewise
+*     -D             : count the datagrams the worker sockets dropped
+*                      (SO_RXQ_OVFL) and the host's UDP errors, and split
+*                      the loss into the two (see the Drops line below).
+*                      Implied by -q and -Q.
+*
+* Signals (see signalControl.h):
+*     SIGINT, SIGTERM : the workers finish the datagram in hand and return,
+*                       then the summary below is printed.  A second one
+*                       exits without it.
+*     SIGUSR1        : prints a Snapshot line of the counters so far and
+*                      carries on
+*
+* opModes (set by the client, see UDPEcho.h):
+*     PING_MODE 0    : every datagram is echoed
+*     LIMITED_RTT 1  : only datagrams flagged MSG_FLAG_ECHO_REQUEST are echoed
+*     ONE_WAY_MODE 2 : nothing is echoed, the server reports the stream's
+*                      loss, OWD, jitter and throughput
+*
+*  A datagram flagged MSG_FLAG_TIMESTAMPS (client -O) is echoed with the
+*  server's receive time, the kernel's with -T, and the time it was
+*  handed back to the kernel written behind its header, for the client
+*  to estimate the clock offset from (see clockOffset.h).  The OWDs
+*  below are the server's clock less the client's and include that offset.
 *
 * Output:
-*  Per iteration output: 
-*       printf("%f %d %d %d %d.%d %3.9f %3.9f\n", wallTime, (int32_t) numBytesRcvd,
+*  Per iteration output, for each datagram echoed: 
+*       printf("%f %d %llu %llu %d.%d %3.9f %3.9f\n", wallTime, (int32_t) numBytesRcvd,
 *             largestSeqRecv,
 *             msgHeaderPtr->sequenceNum,
 *             msgHeaderPtr->timeSentSeconds,
@@ -20,14 +85,122 @@
 *
 *  End of program summary info: 
 *
-*  printf("UDPEchoV2:Server:Summary:  %12.6f %6.6f %4.9f %2.4f %d %d %d %6.0f %d %d %d\n",
+*  printf("UDPEchoV2:Server:Summary:  %12.6f %6.6f %4.9f %2.4f %llu %llu %llu %6.0f %d %d %d\n",
 *        wallTime, duration, avgOWD, avgLossRate, numberOfTrials, receivedCount, largestSeqRecv, totalLost,
 *        RxErrorCount, TxErrorCount, numberOutOfOrder);
 *
-*  
+*  In opMode 1 and 2 avgOWD is followed by the throughput in bytes/sec:
+*
+*  printf("UDPEchoV2:Server:Summary:  %12.6f %6.6f %4.9f %4.9f %2.4f %llu %llu %llu %6.0f %d %d %d\n",
+*        wallTime, duration, avgOWD, avgObservedThroughput, avgLossRate, numberOfTrials, receivedCount,
+*        largestSeqRecv, totalLost, RxErrorCount, TxErrorCount, numberOutOfOrder);
+*
+*  In opMode 1, how many of the datagrams asked for and got an echo, and
+*  the stream's payload bits/sec from its first to its last datagram:
+*
+*  printf("UDPEchoV2:Server:LimitedRTT:  %llu %d %14.1f\n",
+*        receivedCount, echoedCount, streamRate);
+*
+*  In opMode 2 the one way results, jitter being the mean over the clients:
+*
+*  printf("UDPEchoV2:Server:OneWay:  %llu %llu %2.4f %llu %llu %14.1f %4.9f %4.9f %4.9f %4.9f\n",
+*        receivedCount, lost, lossRate, reordered, duplicates, streamRate,
+*        avgOWD, minOWD, maxOWD, jitter);
+*
+*  Every client gets its own session (see flowTable.h).  numberOfTrials is
+*  the sum over the sessions of the sequence numbers they spanned, totalLost and
+*  numberOutOfOrder come from each client's sliding bitmap sequence tracker
+*  (see seqTracker.h), and the trackers' combined counts follow the summary:
+*
+*  printf("UDPEchoV2:Server:Sequence:  %llu %llu %llu %llu %llu %llu %4.3f\n",
+*        inOrder, reordered, duplicates, lost, late, maxReorderDistance, avgReorderDistance);
+*
+*  followed by the OWD distribution over all workers (see latencyHistogram.h), in seconds:
+*
+*  printf("UDPEchoV2:Server:Latency:  %d %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f\n",
+*        numberOWDSamples, min, p50, p90, p99, p99.9, p99.99, max, mean, stdDev);
+*
+*  When batching (batchSize > 1) a second line reports how full the batches were:
+*
+*  printf("UDPEchoV2:Server:Batch:  %d %llu %llu %4.3f %3.1f\n",
+*        batchSize, batchCallCount, batchMsgCount, avgBatchFill, avgBatchFillPct);
+*
+*  With more than one worker, each worker's share follows the summary:
+*
+*  printf("UDPEchoV2:Server:Worker:  %d %d %llu %llu %4.9f %llu %d %d\n",
+*        workerID, cpu, receivedCount, largestSeqRecv, avgOWD, totalBytesRecieved,
+*        RxErrorCount, TxErrorCount);
+*
+*  With -T the OWDs above use kernel RX timestamps and one more line shows
+*  how far behind the kernel the server's own clock read was, on average:
+*
+*  printf("UDPEchoV2:Server:Timestamps:  %d %d %4.9f %4.9f %4.9f\n",
+*        kernelOWDSamples, fallbackOWDSamples, avgKernelOWD, avgUserOWD, avgGap);
+*
+*  With -p or -F, the settings the kernel granted: SO_BUSY_POLL usecs (-1 if
+*  refused), whether memory is locked, the SCHED_FIFO priority of the
+*  workers (-1 if refused, 0 if not asked for), how many workers are pinned
+*  and how often a spinning receive found nothing:
+*
+*  printf("UDPEchoV2:Server:BusyPoll:  %d %d %d %d %d %llu\n",
+*        busyPoll, busyPollUsecs, memoryLocked, fifoPriority, pinnedWorkers, emptyPolls);
+*
+*  With -D, -q or -Q, the buffer sizes asked for (0 for the default) and
+*  granted (the kernel doubles the request), the datagrams the worker sockets dropped, the
+*  change of the host's UDP RcvbufErrors, InErrors and SndbufErrors over
+*  the run, and totalLost split into those dropped by the sockets and the
+*  rest, lost in transit, each also as a share of numberOfTrials.  The
+*  drops can be more than totalLost: those after a client's last datagram
+*  received are not behind its largest sequence number.
+*
+*  printf("UDPEchoV2:Server:Drops:  %d %d %d %d %llu %llu %llu %llu %6.0f %2.4f %2.4f\n",
+*        rcvbufRequested, rcvbufGranted, sndbufRequested, sndbufGranted,
+*        socketDrops, rcvbufErrors, inErrors, sndbufErrors, transitLost,
+*        socketDropRate, transitLossRate);
+*
+*  Then the number of clients, and one line per client still active:
+*
+*  printf("UDPEchoV2:Server:Flows:  %d %d %llu %llu\n",
+*        activeFlows, maxActiveFlows, expiredFlows, overflowCount);
+*  printf("UDPEchoV2:Server:Flow:  %d <address-port> %llu %llu %llu %llu %llu %4.9f %4.9f %4.9f %llu %6.6f %4.9f\n",
+*        workerID, receivedCount, largestSeqRecv, lost, reordered, duplicates,
+*        avgOWD, minOWD, maxOWD, totalBytesRecieved, duration, jitter);
+*
+*  The receive loop used and the system calls it made per datagram received
+*  (recvfrom/sendto, recvmmsg/sendmmsg or io_uring_enter):
+*
+*  printf("UDPEchoV2:Server:Syscalls:  %s %llu %llu %4.3f\n",
+*        loopName, syscallCount, receivedCount, syscallsPerPacket);
+*
+*  With -g, how many receives were coalesced and the datagrams they held:
+*
+*  printf("UDPEchoV2:Server:GRO:  %llu %llu %4.3f\n",
+*        groReceiveCount, groSegmentCount, avgSegmentsPerReceive);
+*
+*  With -Z, the echoes sent zero copy, how many of them the kernel really sent
+*  in place or copied after all, those that went out as normal sends, and
+*  whether the pools are mlock()ed:
+*
+*  printf("UDPEchoV2:Server:ZeroCopy:  %llu %llu %llu %llu %d\n",
+*        sends, zeroCopyCompleted, copiedCompleted, fallbackSends, pinned);
+*
+*  With -L, the number of records logged and lost to full log rings:
+*
+*  printf("UDPEchoV2:Server:Log:  %llu %llu\n", recordsWritten, recordsDropped);
+*
+*  With -i, every interval and once more at exit, before the summary, the
+*  change over all workers since the last one.  sent counts the echoes,
+*  loss comes from how far each client's sequence numbers advanced and
+*  the latency is the OWD:
+*
+*  printf("UDPEchoV2:Server:Interval:  %12.6f %8.3f %6.3f %llu %llu %12.1f %12.1f %10.3f %10.3f %2.4f %llu %llu %4.9f %4.9f %4.9f %4.9f\n",
+*        wallTime, elapsed, intervalSecs, sent, received, sentPps, receivedPps,
+*        sentMbps, receivedMbps, lossRate, reordered, OWDSamples, p50, p90, p99, max);
+*
+*
 * A1: 3/12/2025:  Prepping to add support for opMode 1    CBR behavior....NO ECHO!
 *                 Fixed iteration count off by 1,  cleaned up output a bit
-*                 
+*
 *
 * Last updated: 3/12/2025
 *
@@ -35,9 +208,116 @@
 #include "UDPEcho.h"
 #include "AddressUtility.h"
 #include "utils.h"
+#include "timeBase.h"
+#include "sockTimestamp.h"
+#include "latencyHistogram.h"
+#include "packetLog.h"
+#include "seqTracker.h"
+#include "flowTable.h"
+#include "uringRing.h"
+#include "udpSegment.h"
+#include "zeroCopy.h"
+#include "intervalReport.h"
+#include "statsShm.h"
+#include "signalControl.h"
+#include "lowLatency.h"
+#include "sockDrops.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <linux/filter.h>
+#include <stddef.h>
+
+#define SERVER_USAGE "[-b <batchSize>] [-w <workers>] [-c <firstCpu>] [-T] [-H <histogram file>] [-L <log file>] [-I <idle secs>] [-U] [-P] [-g] [-Z] [-C] [-i <secs>] [-M] [-p <usecs>] [-F <priority>] [-q <bytes>] [-Q <bytes>] [-D] <Server Port/Service>"
+
+//io_uring user_data: operation in the high word, buffer ID in the low one
+#define URING_OP_RECV 1
+#define URING_OP_SEND 2
+//bounds a wait while stats are unpublished, see workerPublishPending()
+#define URING_OP_TIMEOUT 3
+#define URING_USER_DATA(op, bufferID) (((uint64_t)(op) << 32) | (bufferID))
+
+//Stats kept by each worker.  Aligned to a cache line so that
+//workers running on different cores never write to the same line.
+typedef struct {
+  uint64_t largestSeqRecv;
+  uint64_t receivedCount;
+  uint32_t RxErrorCount;
+  uint32_t TxErrorCount;
+  uint32_t numberOutOfOrder;
+  uint16_t opMode;
+  double OWDSum;
+  uint32_t numberOWDSamples;
+  //most recent OWD sample
+  double OWDSample;
+  //smoothed avg
+  double smoothedOWD;
+  //recvmmsg() calls that returned data and the datagrams they returned
+  uint64_t batchCallCount;
+  uint64_t batchMsgCount;
+  //system calls made by the receive loop
+  uint64_t syscallCount;
+  //busy poll receives that found nothing, also in syscallCount
+  uint64_t emptyPollCount;
+  //largest SO_RXQ_OVFL drop count of the worker's socket
+  uint32_t socketDrops;
+  //UDP_GRO receives holding more than one datagram, and those datagrams
+  uint64_t groReceiveCount;
+  uint64_t groSegmentCount;
+  size_t totalBytesRecieved;
+  double timeFirstPacket;
+  double timeLastPacket;
+  //datagrams echoed (in opMode 1 because the client asked for it) and their bytes
+  uint32_t echoedCount;
+  uint64_t echoedBytes;
+  //how far the clients' largest sequence numbers advanced, what should have arrived
+  uint64_t expectedCount;
+  //OWD samples taken from kernel RX timestamps, the OWD the server's own
+  //clock read would have given for them, and the sum of the differences
+  uint32_t kernelOWDSamples;
+  double kernelOWDSum;
+  double userOWDSum;
+  double kernelGapSum;
+  latencyHistogram OWDHistogram;
+} __attribute__((aligned(CACHE_LINE_SIZE))) serverStats;
+
+typedef struct {
+  uint32_t workerID;
+  int sock;
+  int cpu;               //-1 when the worker is not pinned
+  pthread_t thread;
+  int signalSlot;        //see signalControlAddThread()
+  lowLatencySettings tuning;
+  //SO_RCVBUF and SO_SNDBUF as the socket reports them
+  int rcvbufGranted;
+  int sndbufGranted;
+  serverStats stats;
+  //stats as the worker last published them for serverIntervalSnapshot()
+  intervalPublished published;
+  //SO_RCVTIMEO is set so a quiet worker wakes up to publish
+  bool recvTimeout;
+  flowTable flows;
+  zeroCopyPool txPool;
+} serverWorker;
 
 void CatchAlarm(int ignored);
 void CNTCCode();
+void mergeWorkerStats(serverStats *totals);
+int openServerSocket(struct addrinfo *servAddr, bool reusePort);
+void attachReuseportSteering(int sock, uint32_t numberWorkers);
+void *workerMain(void *arg);
+bool processRxMessage(serverWorker *worker, char *buffer, ssize_t numBytesRcvd,
+                      struct sockaddr_storage *clntAddr, int64_t kernelRxTime);
+void runClassicLoop(serverWorker *worker);
+void runBatchedLoop(serverWorker *worker);
+void runUringLoop(serverWorker *worker);
+ssize_t rxSegmentSize(serverStats *stats, ssize_t numBytesRcvd, int groSize);
+void sendEchoBatch(serverStats *stats, int sock, struct mmsghdr *txMsgs, struct iovec *txIovs, uint32_t numTx);
+void stampEchoTime(char *buffer, ssize_t len);
+void serverIntervalSnapshot(intervalCounters *counters);
+void workerPublishCounters(serverWorker *worker, bool force);
+bool workerPublishPending(serverWorker *worker);
+void workerRecvTimeout(serverWorker *worker, bool on);
 
 int sock = -1;                         /* Socket descriptor */
 int bStop = 1;;
@@ -45,49 +325,177 @@ FILE *newFile = NULL;
 double startTime = 0.0;
 double endTime = 0.0;
 double  wallTime = 0.0;
-uint32_t largestSeqRecv = 0;
-uint32_t receivedCount = 0;
-uint32_t RxErrorCount = 0;
-uint32_t TxErrorCount = 0;
-uint32_t  numberOutOfOrder=0;
-uint16_t opMode = 0;
 
+double alpha = 0.10;
+
+//Datagrams pulled per recvmmsg() call, 1 selects the classic loop
+uint32_t batchSize = 1;
+
+//io_uring event loop, optionally with a submission queue polling thread
+bool useUring = false;
+bool uringSqPoll = false;
+
+//UDP_GRO receives, which need room for a whole coalesced burst
+bool udpGRO = false;
+size_t rxBufferSize = MAX_DATA_BUFFER;
+
+//MSG_ZEROCOPY echoes, classic loop only
+bool zeroCopy = false;
+
+//time with the TSC rather than CLOCK_MONOTONIC_RAW
+bool useTSC = false;
+
+//One worker per SO_REUSEPORT socket, each with its own stats block
+uint32_t numberWorkers = 1;
+int firstCpu = -1;
+serverWorker *workers = NULL;
+
+//Busy poll mode and SCHED_FIFO, what each worker got is in its tuning
+lowLatencySettings lowLatency;
+
+//Socket buffer sizes, 0 leaves the system default
+int rcvbufBytes = 0;
+int sndbufBytes = 0;
+//Count socket drops and the host's UDP errors, from where the run started
+bool dropAccounting = false;
+udpSnmpCounters snmpStart;
 
-double OWDSum = 0.0;
-uint32_t numberOWDSamples=0;
+//Use SO_TIMESTAMPING RX timestamps for the OWD samples
+bool kernelTimestamps = false;
+
+//where to dump the OWD histogram, NULL for no dump
+char *histogramFile = NULL;
+
+//Binary per packet log, one ring per worker
+char *logFile = NULL;
+packetLog rxLog;
+
+//Seconds a client may be silent before its session is expired
+double flowIdleTimeout = FLOW_IDLE_DEFAULT_SECS;
+
+//Seconds between Interval lines, 0 prints the per iteration output instead
+double reportInterval = 0.0;
+intervalReporter reporter;
+
+//Live counters in /dev/shm for udpecho-stat
+bool publishStats = false;
+statsShm liveStats;
 
 //uncomment to see debug output
 //#define TRACE 1
 
-size_t totalBytesRecieved = 0;
-double timeFirstPacket = 0; // Used for a slightly more accurate calculation of the throughput
-
 int main(int argc, char *argv[]) 
 {
+  int opt;
+  uint32_t i;
+  long numberCpus = sysconf(_SC_NPROCESSORS_ONLN);
 
-  char *buffer  = NULL;
-  messageHeaderDefault msgHeader;
-  messageHeaderDefault *msgHeaderPtr=&msgHeader;
-  uint32_t *myBufferIntPtr  = NULL;
-  uint32_t msgMinSize = (uint32_t) MESSAGEMIN;
-
-
+  lowLatencyInit(&lowLatency);
+  while ((opt = getopt(argc, argv, "b:w:c:TH:L:I:UPgZCi:Mp:F:q:Q:D")) != -1) {
+    switch (opt) {
+      case 'b':
+        batchSize = atoi(optarg);
+        break;
+      case 'w':
+        numberWorkers = atoi(optarg);
+        break;
+      case 'c':
+        firstCpu = atoi(optarg);
+        break;
+      case 'T':
+        kernelTimestamps = true;
+        break;
+      case 'H':
+        histogramFile = optarg;
+        break;
+      case 'L':
+        logFile = optarg;
+        break;
+      case 'I':
+        flowIdleTimeout = atof(optarg);
+        break;
+      case 'U':
+        useUring = true;
+        break;
+      case 'P':
+        useUring = true;
+        uringSqPoll = true;
+        break;
+      case 'g':
+        udpGRO = true;
+        rxBufferSize = GRO_BUFFER_SIZE;
+        break;
+      case 'Z':
+        zeroCopy = true;
+        break;
+      case 'C':
+        useTSC = true;
+        break;
+      case 'i':
+        reportInterval = atof(optarg);
+        break;
+      case 'M':
+        publishStats = true;
+        break;
+      case 'p':
+        lowLatency.busyPoll = true;
+        lowLatency.busyPollRequested = atoi(optarg);
+        break;
+      case 'F':
+        lowLatency.fifoRequested = atoi(optarg);
+        break;
+      case 'q':
+        rcvbufBytes = atoi(optarg);
+        dropAccounting = true;
+        break;
+      case 'Q':
+        sndbufBytes = atoi(optarg);
+        dropAccounting = true;
+        break;
+      case 'D':
+        dropAccounting = true;
+        break;
+      default:
+        DieWithUserMessage("Parameter(s)", SERVER_USAGE);
+    }
+  }
 
-//double OWDSum = 0.0;
-//uint32_t numberOWDSamples=0;
-  //most recent OWD sample
-  double OWDSample = 0.0;
-  //smoothed avg
-  double smoothedOWD = 0.0;
-  double alpha = 0.10;
-  double sendTime = 0.0;
+  if (argc - optind != 1) // Test for correct number of arguments
+    DieWithUserMessage("Parameter(s)", SERVER_USAGE);
 
-  //
+  if (timeBaseInit(useTSC) != SUCCESS)
+    printf("server: the TSC is not invariant, timing with CLOCK_MONOTONIC_RAW \n");
+  else if (useTSC)
+    printf("server: timing with the TSC at %.0f Hz \n", timeSource.tscHz);
 
-  if (argc != 2) // Test for correct number of arguments
-    DieWithUserMessage("Parameter(s)", "<Server Port/Service>");
+  if (batchSize < 1)
+    batchSize = 1;
+  if (batchSize > MAX_BATCH_SIZE) {
+    printf("server: batchSize %d too large, using %d \n", batchSize, MAX_BATCH_SIZE);
+    batchSize = MAX_BATCH_SIZE;
+  }
+  if (useUring && (batchSize > 1)) {
+    printf("server: the io_uring loop does not batch, ignoring batchSize %d \n", batchSize);
+    batchSize = 1;
+  }
+  if (zeroCopy && (useUring || (batchSize > 1))) {
+    printf("server: zero copy echoes are only done by the classic loop, ignoring -Z \n");
+    zeroCopy = false;
+  }
+  if (numberWorkers < 1)
+    numberWorkers = 1;
+  if (numberWorkers > MAX_WORKERS) {
+    printf("server: workers %d too large, using %d \n", numberWorkers, MAX_WORKERS);
+    numberWorkers = MAX_WORKERS;
+  }
+  if (numberCpus < 1)
+    numberCpus = 1;
+  if (lowLatency.busyPoll && useUring) {
+    printf("server: busy poll mode is not for the io_uring loop, ignoring -p \n");
+    lowLatency.busyPoll = false;
+  }
 
-  char *service = argv[1]; // First arg:  local port/service
+  char *service = argv[optind]; // local port/service
 
   // Construct the server address structure
   struct addrinfo addrCriteria;                   // Criteria for address
@@ -109,15 +517,99 @@ int main(int argc, char *argv[])
     fputc('\n', stdout);
   }
 
-  //Init memory for first send
-  buffer = malloc((size_t)MAX_DATA_BUFFER);
-  if (buffer == NULL) {
-    printf("server: HARD ERROR malloc of  %d bytes failed \n", MAX_DATA_BUFFER);
+  if (posix_memalign((void **)&workers, CACHE_LINE_SIZE, numberWorkers * sizeof(serverWorker)) != 0) {
+    printf("server: HARD ERROR malloc of %d workers failed \n", numberWorkers);
     exit(1);
   }
-  memset(buffer, 0, MAX_DATA_BUFFER);
+  memset(workers, 0, numberWorkers * sizeof(serverWorker));
+
+  // Create one socket per worker, all bound to the same address
+  for (i = 0; i < numberWorkers; i++) {
+    workers[i].workerID = i;
+    workers[i].sock = openServerSocket(servAddr, (numberWorkers > 1));
+    workers[i].cpu = -1;
+    if (flowTableInit(&workers[i].flows, flowIdleTimeout) != SUCCESS) {
+      printf("server: HARD ERROR malloc of the flow table failed \n");
+      exit(1);
+    }
+    if (zeroCopy) {
+      if (zeroCopyInit(&workers[i].txPool, workers[i].sock, ZERO_COPY_POOL_BUFFERS, rxBufferSize) != SUCCESS)
+        DieWithSystemMessage("zero copy setup (SO_ZEROCOPY) failed");
+      if (!workers[i].txPool.pinned)
+        printf("server: could not mlock the zero copy buffers (RLIMIT_MEMLOCK), using them unpinned \n");
+    }
+    if (firstCpu >= 0)
+      workers[i].cpu = (firstCpu + i) % numberCpus;
+    workers[i].tuning = lowLatency;
+    if (lowLatencySocket(&workers[i].tuning, workers[i].sock, true) != NOERROR)
+      perror("server: setsockopt(SO_BUSY_POLL) failed ");
+    if (dropAccounting) {
+      if (sockSetBuffer(workers[i].sock, true, rcvbufBytes, &workers[i].rcvbufGranted) != NOERROR)
+        perror("server: setsockopt(SO_RCVBUF) failed ");
+      if (sockSetBuffer(workers[i].sock, false, sndbufBytes, &workers[i].sndbufGranted) != NOERROR)
+        perror("server: setsockopt(SO_SNDBUF) failed ");
+    }
+  }
+  if ((rcvbufBytes > 0) && (workers[0].rcvbufGranted < 2 * rcvbufBytes))
+    printf("server: SO_RCVBUF is %d, net.core.rmem_max caps it without CAP_NET_ADMIN \n", workers[0].rcvbufGranted);
+  if ((sndbufBytes > 0) && (workers[0].sndbufGranted < 2 * sndbufBytes))
+    printf("server: SO_SNDBUF is %d, net.core.wmem_max caps it without CAP_NET_ADMIN \n", workers[0].sndbufGranted);
+  if (dropAccounting && (udpSnmpRead(&snmpStart) != NOERROR))
+    printf("server: could not read /proc/net/snmp, the host's UDP errors are not reported \n");
+  if (lowLatencyLockMemory(&lowLatency) != NOERROR)
+    perror("server: mlockall() failed, memory is not locked ");
+  if (numberWorkers > 1)
+    attachReuseportSteering(workers[0].sock, numberWorkers);
+  sock = workers[0].sock;
+
+  // Free address list allocated by getaddrinfo()
+  freeaddrinfo(servAddr);
+
+  //Before any thread is started, they all have to block the signals it takes over
+  if (signalControlStart("Server", serverIntervalSnapshot) != NOERROR)
+    DieWithSystemMessage("failed to set up the signal handling");
+
+  if ((logFile != NULL) && (packetLogOpen(&rxLog, logFile, numberWorkers) != NOERROR))
+    DieWithSystemMessage("failed to open the packet log");
+
+  wallTime = getCurTimeD();
+  startTime = wallTime;
+  if ((reportInterval > 0.0) &&
+      (intervalReportStart(&reporter, "Server", reportInterval, serverIntervalSnapshot) != NOERROR))
+    DieWithSystemMessage("failed to start the interval reporter");
+  if (publishStats) {
+    if (statsShmOpen(&liveStats, "server", serverIntervalSnapshot) != NOERROR)
+      DieWithSystemMessage("failed to create the statistics segment");
+    printf("server: publishing live statistics to %s%s \n", STATS_SHM_DIR, liveStats.name);
+  }
+  for (i = 1; i < numberWorkers; i++) {
+    if (pthread_create(&workers[i].thread, NULL, workerMain, &workers[i]) != 0)
+      DieWithSystemMessage("pthread_create() failed");
+  }
+  //The main thread is worker 0
+  workerMain(&workers[0]);
+  for (i = 1; i < numberWorkers; i++)
+    pthread_join(workers[i].thread, NULL);
+  CNTCCode();
+}
 
-  signal (SIGINT, CNTCCode);
+/*************************************************************
+*
+* Function: int openServerSocket(struct addrinfo *servAddr, bool reusePort)
+*
+* Summary: Creates a UDP socket and binds it to the server address.
+*
+* Inputs:
+*   struct addrinfo *servAddr : the local address to bind
+*   bool reusePort : set SO_REUSEPORT so several sockets can share the port
+*
+* outputs:
+*   returns the bound socket, dies on failure
+*
+***************************************************************/
+int openServerSocket(struct addrinfo *servAddr, bool reusePort)
+{
+  int optval = 1;
 
   // Create socket for incoming connections
   int sock = socket(servAddr->ai_family, servAddr->ai_socktype,
@@ -125,117 +617,869 @@ int main(int argc, char *argv[])
   if (sock < 0)
     DieWithSystemMessage("socket() failed");
 
+  if (reusePort) {
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0)
+      DieWithSystemMessage("setsockopt(SO_REUSEPORT) failed");
+  }
+
+  if (kernelTimestamps) {
+    if (enableSocketTimestamps(sock, false) != NOERROR)
+      DieWithSystemMessage("setsockopt(SO_TIMESTAMPING) failed");
+  }
+
+  if (udpGRO) {
+    if (enableUDPGRO(sock) != NOERROR)
+      DieWithSystemMessage("setsockopt(UDP_GRO) failed");
+  }
+
+  if (dropAccounting) {
+    if (enableRxqOverflow(sock) != NOERROR)
+      DieWithSystemMessage("setsockopt(SO_RXQ_OVFL) failed");
+  }
+
   // Bind to the local address
   if (bind(sock, servAddr->ai_addr, servAddr->ai_addrlen) < 0)
     DieWithSystemMessage("bind() failed");
 
-  // Free address list allocated by getaddrinfo()
-  freeaddrinfo(servAddr);
+  return sock;
+}
 
-  wallTime = getCurTimeD();
-  startTime = wallTime;
-  for (;;) 
-  { // Run forever
+/*************************************************************
+*
+* Function: void attachReuseportSteering(int sock, uint32_t numberWorkers)
+*
+* Summary: Attaches a classic BPF program to the reuseport group that
+*          picks the worker socket from the client's source address
+*          and port, so every datagram of a flow lands on the same worker.
+*
+* Inputs:
+*   int sock : any socket of the group, the program applies to all of them
+*   uint32_t numberWorkers : number of sockets in the group
+*
+* outputs:
+*   none.  If the kernel refuses the program the kernel's own reuseport
+*   hash is used, which also keeps a flow on one socket.
+*
+* notes:
+*   The program returns an index into the group, in bind() order.
+*   It reads the IP and UDP headers through SKF_NET_OFF since the
+*   packet data starts at the UDP payload.  skb->hash is not used as
+*   it is often 0 for loopback traffic.  Only the low word of an IPv6
+*   source address is hashed and extension headers are not walked.
+*
+***************************************************************/
+void attachReuseportSteering(int sock, uint32_t numberWorkers)
+{
+  struct sock_filter code[] = {
+    //IP version
+    { BPF_LD  | BPF_B | BPF_ABS, 0, 0, SKF_NET_OFF },
+    { BPF_ALU | BPF_RSH | BPF_K, 0, 0, 4 },
+    { BPF_JMP | BPF_JEQ | BPF_K, 8, 0, 6 },
+    //IPv4: source address ^ source port
+    { BPF_LD  | BPF_W | BPF_ABS, 0, 0, SKF_NET_OFF + 12 },
+    { BPF_ST, 0, 0, 0 },
+    { BPF_LDX | BPF_B | BPF_MSH, 0, 0, SKF_NET_OFF },
+    { BPF_LD  | BPF_H | BPF_IND, 0, 0, SKF_NET_OFF },
+    { BPF_LDX | BPF_MEM, 0, 0, 0 },
+    { BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0 },
+    { BPF_ALU | BPF_MOD | BPF_K, 0, 0, numberWorkers },
+    { BPF_RET | BPF_A, 0, 0, 0 },
+    //IPv6: low word of source address ^ source port
+    { BPF_LD  | BPF_W | BPF_ABS, 0, 0, SKF_NET_OFF + 20 },
+    { BPF_ST, 0, 0, 0 },
+    { BPF_LD  | BPF_H | BPF_ABS, 0, 0, SKF_NET_OFF + 40 },
+    { BPF_LDX | BPF_MEM, 0, 0, 0 },
+    { BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0 },
+    { BPF_ALU | BPF_MOD | BPF_K, 0, 0, numberWorkers },
+    { BPF_RET | BPF_A, 0, 0, 0 },
+  };
+  struct sock_fprog prog = {
+    .len = sizeof(code) / sizeof(code[0]),
+    .filter = code,
+  };
+
+  if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0)
+    perror("server: setsockopt(SO_ATTACH_REUSEPORT_CBPF) failed, using kernel hash ");
+}
+
+/*************************************************************
+*
+* Function: void *workerMain(void *arg)
+*
+* Summary: Thread entry for one worker.  Pins the thread if asked
+*          to and runs the receive loop on the worker's socket.
+*
+* Inputs:
+*   void *arg : the serverWorker
+*
+* outputs:  returns once a SIGINT or SIGTERM stopped the loop
+*
+***************************************************************/
+void *workerMain(void *arg)
+{
+  serverWorker *worker = (serverWorker *)arg;
+
+  worker->signalSlot = signalControlAddThread(pthread_self());
+  if (lowLatencyThread(&worker->tuning, worker->cpu) != NOERROR) {
+    if ((worker->cpu >= 0) && (!worker->tuning.pinned))
+      printf("server: worker %d failed to pin to cpu %d \n", worker->workerID, worker->cpu);
+    if (worker->tuning.fifoApplied < 0)
+      printf("server: worker %d could not get SCHED_FIFO priority %d \n", worker->workerID, worker->tuning.fifoRequested);
+  }
+
+  if (useUring)
+    runUringLoop(worker);
+  else if (batchSize > 1)
+    runBatchedLoop(worker);
+  else 
+    runClassicLoop(worker);
+  workerPublishCounters(worker, true);
+  signalControlThreadDone(worker->signalSlot);
+  return NULL;
+}
+
+/*************************************************************
+*
+* Function: bool processRxMessage(serverWorker *worker, char *buffer,
+*                  ssize_t numBytesRcvd, struct sockaddr_storage *clntAddr,
+*                  int64_t kernelRxTime)
+*
+* Summary: Validates one received datagram, unpacks its header and
+*          updates the OWD and sequence stats.  Used by both the
+*          classic and the batched receive loops.
+*
+* Inputs:
+*   serverWorker *worker : the worker that received the datagram
+*   char *buffer : the received datagram
+*   ssize_t numBytesRcvd : its length, or the error return of the receive
+*   struct sockaddr_storage *clntAddr : the sender
+*   int64_t kernelRxTime : kernel RX timestamp in ns, 0 if there is none
+*
+* outputs:
+*   returns true if the datagram is valid and should be echoed
+*
+***************************************************************/
+bool processRxMessage(serverWorker *worker, char *buffer, ssize_t numBytesRcvd,
+                      struct sockaddr_storage *clntAddr, int64_t kernelRxTime)
+{
+  serverStats *stats = &worker->stats;
+  int64_t rxWallTime = 0;
+  double wallTime = 0.0;
+  messageHeaderDefault msgHeader;
+  messageHeaderDefault *msgHeaderPtr=&msgHeader;
+  uint32_t msgMinSize = (uint32_t) MESSAGEMIN;
+  int64_t sendTime = 0;
+  flowSession *flow = NULL;
+  uint64_t largestSeqRecv = 0;
+  double smoothedOWD = 0.0;
+
+  if (numBytesRcvd < 0){
+    stats->RxErrorCount++;
+    perror("server: Error on recvfrom ");
+    return false;
+  } else if (numBytesRcvd < msgMinSize) {
+    stats->RxErrorCount++;
+    printf("server: Error on recvfrom, received (%d) less than MIN (%d) \n ", (int32_t)numBytesRcvd,msgMinSize);
+    return false;
+  }
+
+  stats->totalBytesRecieved += numBytesRcvd;
+  rxWallTime = timeWallNs();
+  wallTime = nsToSecs(rxWallTime);
+  if (stats->receivedCount == 0) {
+    stats->timeFirstPacket = wallTime;
+  }
+  stats->receivedCount++;
+  stats->timeLastPacket = wallTime;
+  //unpack to fill in the rx header info
+  unpackMessageHeader(buffer, msgHeaderPtr);
+  if ((msgHeaderPtr->flags & MSG_FLAG_TIMESTAMPS) && (numBytesRcvd >= MESSAGE_EXT_HEADER_SIZE))
+    packServerTimestamp(buffer, SERVER_RX_TIMESTAMP, (kernelRxTime > 0) ? kernelRxTime : rxWallTime);
+
+  flowTableExpire(&worker->flows, wallTime);
+  flow = flowTableLookup(&worker->flows, clntAddr, msgHeaderPtr->sequenceNum, wallTime);
+
+
+  //Current wallclock time - packet send time, subtracted in ns so
+  //epoch sized seconds do not eat the precision
+  sendTime = (int64_t)msgHeaderPtr->timeSentSeconds * NS_PER_SEC + msgHeaderPtr->timeSentNanoSeconds;
+  stats->OWDSample = nsToSecs(rxWallTime - sendTime);
+  if (kernelRxTime > 0) {
+    //The kernel saw it first, the difference is the server's own overhead
+    stats->userOWDSum += stats->OWDSample;
+    stats->kernelGapSum += nsToSecs(rxWallTime - kernelRxTime);
+    stats->OWDSample = nsToSecs(kernelRxTime - sendTime);
+    stats->kernelOWDSum += stats->OWDSample;
+    stats->kernelOWDSamples++;
+  }
+  stats->OWDSum += stats->OWDSample;
+  stats->numberOWDSamples++;
+  histogramRecord(&stats->OWDHistogram, stats->OWDSample);
+  stats->smoothedOWD = (1-alpha)*stats->smoothedOWD + alpha*stats->OWDSample;
+  stats->opMode = msgHeaderPtr->opMode;
+
+  if (msgHeaderPtr->sequenceNum > stats->largestSeqRecv)
+      stats->largestSeqRecv = msgHeaderPtr->sequenceNum;
+  largestSeqRecv = stats->largestSeqRecv;
+  smoothedOWD = stats->smoothedOWD;
+
+  //The same per client, which is what the per iteration output shows
+  if (flow != NULL) {
+    flow->receivedCount++;
+    flow->totalBytesRecieved += numBytesRcvd;
+    flow->timeLastPacket = wallTime;
+    if ((flow->numberOWDSamples == 0) || (stats->OWDSample < flow->minOWD))
+      flow->minOWD = stats->OWDSample;
+    if ((flow->numberOWDSamples == 0) || (stats->OWDSample > flow->maxOWD))
+      flow->maxOWD = stats->OWDSample;
+    if (flow->numberOWDSamples > 0)
+      flow->jitter += (fabs(stats->OWDSample - flow->lastOWD) - flow->jitter) / 16.0;
+    flow->lastOWD = stats->OWDSample;
+    flow->OWDSum += stats->OWDSample;
+    flow->numberOWDSamples++;
+    flow->smoothedOWD = (1-alpha)*flow->smoothedOWD + alpha*stats->OWDSample;
+    if (msgHeaderPtr->sequenceNum > flow->largestSeqRecv) {
+      stats->expectedCount += msgHeaderPtr->sequenceNum - flow->largestSeqRecv;
+      flow->largestSeqRecv = msgHeaderPtr->sequenceNum;
+    }
+    switch (seqTrackerUpdate(&flow->sequence, msgHeaderPtr->sequenceNum)) {
+      case SEQ_REORDERED:
+      case SEQ_LATE:
+        stats->numberOutOfOrder++;
+        break;
+      default:
+        break;
+    }
+    largestSeqRecv = flow->largestSeqRecv;
+    smoothedOWD = flow->smoothedOWD;
+  }
+  switch (stats->opMode) {
+    case PING_MODE:
+      break;
+    case LIMITED_RTT:
+      if (!(msgHeaderPtr->flags & MSG_FLAG_ECHO_REQUEST))
+        return false;
+      break;
+    default:
+      return false;
+  }
+  stats->echoedCount++;
+  stats->echoedBytes += numBytesRcvd;
+
+  if (logFile != NULL) {
+    packetLogRecord record;
+    memset(&record, 0, sizeof(record));
+    record.recordType = PACKET_LOG_SERVER_OWD;
+    record.sequenceNum = msgHeaderPtr->sequenceNum;
+    record.numBytes = (uint32_t) numBytesRcvd;
+    record.largestSeqRecv = largestSeqRecv;
+    record.timeSentSeconds = msgHeaderPtr->timeSentSeconds;
+    record.timeSentNanoSeconds = msgHeaderPtr->timeSentNanoSeconds;
+    record.wallTime = wallTime;
+    record.sample = stats->OWDSample;
+    record.smoothed = smoothedOWD;
+    packetLogAppend(&rxLog, worker->workerID, &record);
+  } else if (reportInterval <= 0.0) {
+    printf("%f %d %llu %llu %d.%d %3.9f %3.9f\n", wallTime, (int32_t) numBytesRcvd,
+           (unsigned long long)largestSeqRecv,
+           (unsigned long long)msgHeaderPtr->sequenceNum,
+           msgHeaderPtr->timeSentSeconds,
+           msgHeaderPtr->timeSentNanoSeconds, stats->OWDSample, smoothedOWD);
+  }
+
+#ifdef TRACE
+  printf("server: Rx %d bytes from ", (int32_t) numBytesRcvd);
+  fputs(" client ", stdout);
+  PrintSocketAddress((struct sockaddr *) clntAddr, stdout);
+  fputc('\n', stdout);
+#endif
+  return true;
+}
+
+/*************************************************************
+*
+* Function: ssize_t rxSegmentSize(serverStats *stats, ssize_t numBytesRcvd,
+*                                 int groSize)
+*
+* Summary: Size of the datagrams in one receive: the UDP_GRO segment
+*          size if the kernel coalesced several, else the whole receive
+*          (or the error it returned).  Counts the coalesced receives.
+*
+* Inputs:
+*   ssize_t numBytesRcvd : what the receive returned
+*   int groSize : the UDP_GRO control message value, 0 if there was none
+*
+* outputs:
+*   returns the segment size, the last datagram may be shorter
+*
+***************************************************************/
+ssize_t rxSegmentSize(serverStats *stats, ssize_t numBytesRcvd, int groSize)
+{
+  if ((groSize <= 0) || (numBytesRcvd <= groSize))
+    return numBytesRcvd;
+  stats->groReceiveCount++;
+  stats->groSegmentCount += (numBytesRcvd + groSize - 1) / groSize;
+  return groSize;
+}
+
+/*************************************************************
+*
+* Function: void runClassicLoop(serverWorker *worker)
+*
+* Summary: Receive loop making one recvfrom() and, in opMode 0,
+*          one sendto() per datagram.
+*
+*          With -Z each receive goes into a buffer from the worker's
+*          zero copy pool and the echoes are sent from it in place.
+*
+* Inputs:
+*   serverWorker *worker : the worker, owning a bound server socket
+*
+* outputs:  returns once a stop was requested (see signalControl.h)
+*
+***************************************************************/
+void runClassicLoop(serverWorker *worker)
+{
+  char *buffer  = NULL;
+  int sock = worker->sock;
+
+  //Init memory for first send
+  buffer = malloc(rxBufferSize);
+  if (buffer == NULL) {
+    printf("server: HARD ERROR malloc of  %d bytes failed \n", (int32_t)rxBufferSize);
+    exit(1);
+  }
+  memset(buffer, 0, rxBufferSize);
+
+  while (!signalStopRequested())
+  { // Run until SIGINT
     struct sockaddr_storage clntAddr; // Client address
     // Set Length of client address structure (in-out parameter)
     socklen_t clntAddrLen = sizeof(clntAddr);
 
+    workerPublishCounters(worker, false);
+    workerRecvTimeout(worker, workerPublishPending(worker));
     // Block until receive message from a client
     // Size of received message
-    ssize_t numBytesRcvd = recvfrom(sock, buffer, MAX_DATA_BUFFER, 0,
-        (struct sockaddr *) &clntAddr, &clntAddrLen);
-    totalBytesRecieved += numBytesRcvd;
-    if (numBytesRcvd < 0){
-      RxErrorCount++;
-      perror("server: Error on recvfrom ");
+    int64_t kernelRxTime = 0;
+    int groSize = 0;
+    uint32_t dropCount = 0;
+    if (zeroCopy)
+      buffer = zeroCopyGetBuffer(&worker->txPool);
+    ssize_t numBytesRcvd = recvSegments(sock, buffer, rxBufferSize,
+        (struct sockaddr *) &clntAddr, &clntAddrLen, &kernelRxTime, &groSize, &dropCount);
+    worker->stats.syscallCount++;
+    if (dropCount > worker->stats.socketDrops)
+      worker->stats.socketDrops = dropCount;
+    if ((numBytesRcvd < 0) && ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+      //woken up to stop or to publish, or a busy poll that found nothing
+      if ((errno != EINTR) && worker->tuning.busyPoll)
+        worker->stats.emptyPollCount++;
+      if (zeroCopy)
+        zeroCopyPut(&worker->txPool, buffer);
       continue;
-    } else if (numBytesRcvd < msgMinSize) {
-      RxErrorCount++;
-      printf("server: Error on recvfrom, received (%d) less than MIN (%d) \n ", (int32_t)numBytesRcvd,msgMinSize);
+    }
+    ssize_t segmentSize = rxSegmentSize(&worker->stats, numBytesRcvd, groSize);
+    ssize_t offset = 0;
+
+    //Once per datagram of a coalesced receive
+    do {
+      char *segment = buffer + offset;
+      ssize_t segmentBytes = (numBytesRcvd - offset < segmentSize) ? numBytesRcvd - offset : segmentSize;
+      offset += segmentSize;
+      if (!processRxMessage(worker, segment, segmentBytes, &clntAddr, kernelRxTime))
+        continue;
+
+      // Send received datagram back to the client
+      ssize_t numBytesSent;
+      stampEchoTime(segment, segmentBytes);
+      if (zeroCopy)
+        numBytesSent = zeroCopySendto(&worker->txPool, segment, segmentBytes,
+          (struct sockaddr *) &clntAddr, sizeof(clntAddr));
+      else
+        numBytesSent = sendto(sock, segment, segmentBytes, 0,
+          (struct sockaddr *) &clntAddr, sizeof(clntAddr));
+      worker->stats.syscallCount++;
+      if (numBytesSent < 0) {
+        worker->stats.TxErrorCount++;
+        perror("server: Error on sendto ");
+        continue;
+      }
+      else if (numBytesSent != segmentBytes) {
+        worker->stats.TxErrorCount++;
+        printf("server: Error on sendto, only sent %d rather than %d ",(int32_t)numBytesSent,(int32_t)segmentBytes);
+        continue;
+      }
+    } while (offset < numBytesRcvd);
+    if (zeroCopy)
+      zeroCopyPut(&worker->txPool, buffer);
+  }
+}
+
+/*************************************************************
+*
+* Function: void runBatchedLoop(serverWorker *worker)
+*
+* Summary: Receive loop that pulls up to batchSize datagrams per
+*          recvmmsg() call into preallocated buffers and address
+*          slots, updates the stats for the whole batch and echoes
+*          the opMode 0 datagrams back with one sendmmsg() call.
+*
+* Inputs:
+*   serverWorker *worker : the worker, owning a bound server socket
+*
+* outputs:  returns once a stop was requested (see signalControl.h)
+*
+* notes:
+*   MSG_WAITFORONE blocks only until the first datagram arrives.  A
+*   batch is whatever is already queued at that point, so a lightly
+*   loaded server does not hold echoes back waiting for a batch to fill.
+*
+***************************************************************/
+void runBatchedLoop(serverWorker *worker)
+{
+  serverStats *stats = &worker->stats;
+  int sock = worker->sock;
+  char *buffers = NULL;
+  struct sockaddr_storage *clntAddrs = NULL;
+  struct mmsghdr *rxMsgs = NULL;
+  struct mmsghdr *txMsgs = NULL;
+  struct iovec *rxIovs = NULL;
+  struct iovec *txIovs = NULL;
+  char *controls = NULL;
+  uint32_t i;
+
+  buffers = malloc((size_t)batchSize * rxBufferSize);
+  controls = calloc(batchSize, TIMESTAMP_CONTROL_LEN);
+  clntAddrs = calloc(batchSize, sizeof(struct sockaddr_storage));
+  rxMsgs = calloc(batchSize, sizeof(struct mmsghdr));
+  txMsgs = calloc(batchSize, sizeof(struct mmsghdr));
+  rxIovs = calloc(batchSize, sizeof(struct iovec));
+  txIovs = calloc(batchSize, sizeof(struct iovec));
+  if ((buffers == NULL) || (clntAddrs == NULL) || (rxMsgs == NULL) ||
+      (txMsgs == NULL) || (rxIovs == NULL) || (txIovs == NULL) || (controls == NULL)) {
+    printf("server: HARD ERROR malloc of %d batch buffers failed \n", batchSize);
+    exit(1);
+  }
+  memset(buffers, 0, (size_t)batchSize * rxBufferSize);
+
+  for (i = 0; i < batchSize; i++) {
+    rxIovs[i].iov_base = buffers + (size_t)i * rxBufferSize;
+    rxIovs[i].iov_len = rxBufferSize;
+    rxMsgs[i].msg_hdr.msg_iov = &rxIovs[i];
+    rxMsgs[i].msg_hdr.msg_iovlen = 1;
+    rxMsgs[i].msg_hdr.msg_name = &clntAddrs[i];
+    txMsgs[i].msg_hdr.msg_iov = &txIovs[i];
+    txMsgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  while (!signalStopRequested())
+  { // Run until SIGINT
+    uint32_t numTx = 0;
+
+    workerPublishCounters(worker, false);
+    workerRecvTimeout(worker, workerPublishPending(worker));
+    // Set Length of each client address and control slot (in-out parameters)
+    for (i = 0; i < batchSize; i++) {
+      rxMsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+      if (kernelTimestamps || udpGRO || dropAccounting) {
+        rxMsgs[i].msg_hdr.msg_control = controls + (size_t)i * TIMESTAMP_CONTROL_LEN;
+        rxMsgs[i].msg_hdr.msg_controllen = TIMESTAMP_CONTROL_LEN;
+      }
+    }
+
+    int numRcvd = recvmmsg(sock, rxMsgs, batchSize, MSG_WAITFORONE, NULL);
+    stats->syscallCount++;
+    if (numRcvd < 0) {
+      if (errno == EINTR)
+        continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        //a busy poll that found nothing, or woken up to publish
+        if (worker->tuning.busyPoll)
+          stats->emptyPollCount++;
+        continue;
+      }
+      stats->RxErrorCount++;
+      perror("server: Error on recvmmsg ");
       continue;
-    } else 
-    { 
-      if (receivedCount == 0) {
-        timeFirstPacket = getCurTimeD();
+    }
+    stats->batchCallCount++;
+    stats->batchMsgCount += numRcvd;
+
+    for (i = 0; i < (uint32_t)numRcvd; i++) {
+      int64_t kernelRxTime = 0;
+      int groSize = 0;
+      ssize_t numBytesRcvd = rxMsgs[i].msg_len;
+      ssize_t offset = 0;
+      if (kernelTimestamps)
+        kernelRxTime = getControlTimestamp(&rxMsgs[i].msg_hdr);
+      if (udpGRO)
+        groSize = getControlSegmentSize(&rxMsgs[i].msg_hdr);
+      if (dropAccounting) {
+        uint32_t dropCount = getControlDropCount(&rxMsgs[i].msg_hdr);
+        if (dropCount > stats->socketDrops)
+          stats->socketDrops = dropCount;
       }
-      receivedCount++;
-      wallTime = getCurTimeD();
-      myBufferIntPtr  = (uint32_t *)buffer;
-      //unpack to fill in the rx header info
-      msgHeaderPtr->sequenceNum = ntohl(*myBufferIntPtr++);
-      msgHeaderPtr->timeSentSeconds = ntohl(*myBufferIntPtr++);
-      msgHeaderPtr->timeSentNanoSeconds = ntohl(*myBufferIntPtr++);
-      msgHeaderPtr->opMode = ntohl(*myBufferIntPtr++);
-
-
-      //Current wallclock time - packet send time
-      sendTime =  ( (double)msgHeaderPtr->timeSentSeconds +  (((double)msgHeaderPtr->timeSentNanoSeconds)/1000000000.0) );
-      OWDSample = wallTime - sendTime;
-      OWDSum += OWDSample;
-      numberOWDSamples++;
-      smoothedOWD = (1-alpha)*smoothedOWD + alpha*OWDSample;
-      opMode = msgHeaderPtr->opMode;
-
-      if (msgHeaderPtr->sequenceNum > largestSeqRecv)
-          largestSeqRecv = msgHeaderPtr->sequenceNum;
-      if (opMode == 0) {
-        printf("%f %d %d %d %d.%d %3.9f %3.9f\n", wallTime, (int32_t) numBytesRcvd,
-               largestSeqRecv,
-               msgHeaderPtr->sequenceNum,
-               msgHeaderPtr->timeSentSeconds,
-               msgHeaderPtr->timeSentNanoSeconds, OWDSample, smoothedOWD);
-          
-  #ifdef TRACE 
-        printf("server: Rx %d bytes from ", (int32_t) numBytesRcvd);
-        fputs(" client ", stdout);
-        PrintSocketAddress((struct sockaddr *) &clntAddr, stdout);
-        fputc('\n', stdout);
-  #endif
-
-        // Send received datagram back to the client
-        ssize_t numBytesSent = sendto(sock, buffer, numBytesRcvd, 0,
-          (struct sockaddr *) &clntAddr, sizeof(clntAddr));
-        if (numBytesSent < 0) {
-          TxErrorCount++;
-          perror("server: Error on sendto ");
+      ssize_t segmentSize = rxSegmentSize(stats, numBytesRcvd, groSize);
+
+      //Once per datagram of a coalesced receive
+      do {
+        char *segment = (char *)rxIovs[i].iov_base + offset;
+        ssize_t segmentBytes = (numBytesRcvd - offset < segmentSize) ? numBytesRcvd - offset : segmentSize;
+        offset += segmentSize;
+        if (!processRxMessage(worker, segment, segmentBytes, &clntAddrs[i], kernelRxTime))
           continue;
+        //GRO can hand over more echoes than a batch holds
+        if (numTx == batchSize) {
+          sendEchoBatch(stats, sock, txMsgs, txIovs, numTx);
+          numTx = 0;
+        }
+        txIovs[numTx].iov_base = segment;
+        txIovs[numTx].iov_len = segmentBytes;
+        txMsgs[numTx].msg_hdr.msg_name = &clntAddrs[i];
+        txMsgs[numTx].msg_hdr.msg_namelen = rxMsgs[i].msg_hdr.msg_namelen;
+        numTx++;
+      } while (offset < numBytesRcvd);
+    }
+    sendEchoBatch(stats, sock, txMsgs, txIovs, numTx);
+  }
+}
+
+/*************************************************************
+*
+* Function: void sendEchoBatch(serverStats *stats, int sock,
+*               struct mmsghdr *txMsgs, struct iovec *txIovs, uint32_t numTx)
+*
+* Summary: Echoes the numTx datagrams set up in txMsgs.  sendmmsg()
+*          may stop short so it loops until all are out.
+*
+***************************************************************/
+void sendEchoBatch(serverStats *stats, int sock, struct mmsghdr *txMsgs, struct iovec *txIovs, uint32_t numTx)
+{
+  uint32_t numSent = 0;
+  uint32_t i;
+
+  for (i = 0; i < numTx; i++)
+    stampEchoTime(txIovs[i].iov_base, txIovs[i].iov_len);
+  while (numSent < numTx) {
+    int rc = sendmmsg(sock, &txMsgs[numSent], numTx - numSent, 0);
+    stats->syscallCount++;
+    if (rc < 0) {
+      //the first remaining datagram failed, count it and move past it
+      stats->TxErrorCount++;
+      perror("server: Error on sendmmsg ");
+      numSent++;
+      continue;
+    }
+    for (i = numSent; i < numSent + (uint32_t)rc; i++) {
+      if (txMsgs[i].msg_len != txIovs[i].iov_len) {
+        stats->TxErrorCount++;
+        printf("server: Error on sendmmsg, only sent %d rather than %d ",
+               (int32_t)txMsgs[i].msg_len, (int32_t)txIovs[i].iov_len);
+      }
+    }
+    numSent += rc;
+  }
+}
+
+/*************************************************************
+*
+* Function: void stampEchoTime(char *buffer, ssize_t len)
+*
+* Summary: Writes the echo time into an echo flagged MSG_FLAG_TIMESTAMPS,
+*          as the last thing before it is handed to the kernel
+*
+***************************************************************/
+void stampEchoTime(char *buffer, ssize_t len)
+{
+  messageHeaderDefault header;
+
+  if (len < MESSAGE_EXT_HEADER_SIZE)
+    return;
+  unpackMessageHeader(buffer, &header);
+  if (header.flags & MSG_FLAG_TIMESTAMPS)
+    packServerTimestamp(buffer, SERVER_TX_TIMESTAMP, timeWallNs());
+}
+
+/*************************************************************
+*
+* Function: void runUringLoop(serverWorker *worker)
+*
+* Summary: io_uring event loop.  One multishot recvmsg keeps receiving
+*          into buffers the kernel takes from a provided buffer ring,
+*          each completion is handled by processRxMessage() like in the
+*          other loops, and the echoes go out as sendmsg SQEs straight
+*          from the receive buffer.  A buffer goes back to the ring once
+*          its echo has been sent.
+*
+* Inputs:
+*   serverWorker *worker : the worker, owning a bound server socket
+*
+* outputs:  returns once a stop was requested (see signalControl.h)
+*
+* notes:
+*   Each receive buffer holds the io_uring_recvmsg_out header, the
+*   client address, room for the timestamp control message and the
+*   datagram.  With every buffer waiting on a send the multishot recv
+*   ends with ENOBUFS, it is rearmed as soon as one is returned.
+*   With -g a buffer may hold several datagrams, it goes back once all
+*   of their echoes are out.  Those echoes are linked so they leave in
+*   order; a failed send cancels the rest of its link, each is counted
+*   as a TxError.  Echoes of different buffers, and so of different
+*   clients, are never linked, one client's failure does not cancel
+*   another's echo.
+*
+***************************************************************/
+void runUringLoop(serverWorker *worker)
+{
+  serverStats *stats = &worker->stats;
+  int sock = worker->sock;
+  uringRing ring;
+  uringBufRing bufRing;
+  struct msghdr recvTemplate;
+  struct msghdr *txMsgs = NULL;
+  struct iovec *txIovs = NULL;
+  struct io_uring_sqe *sqe = NULL;
+  struct io_uring_sqe *prevSend = NULL;
+  struct io_uring_cqe *cqe = NULL;
+  uint32_t nameLen = sizeof(struct sockaddr_storage);
+  uint32_t controlLen = (kernelTimestamps || udpGRO || dropAccounting) ? TIMESTAMP_CONTROL_LEN : 0;
+  //send slots per buffer, one per datagram a GRO receive may hold
+  uint32_t slotsPerBuffer = udpGRO ? UDP_MAX_GSO_SEGMENTS : 1;
+  uint16_t *sendsPending = NULL;
+  uint32_t buffersHeld = 0;
+  bool recvArmed = false;
+  bool timeoutArmed = false;
+  struct __kernel_timespec publishWait;
+
+  //Room for a send per slot plus the recv and the publish timeout, so
+  //getting an SQE never fails
+  if (uringInit(&ring, (slotsPerBuffer + 1) * URING_BUFFER_COUNT, uringSqPoll) != SUCCESS)
+    DieWithSystemMessage("io_uring_setup() failed");
+  if (uringBufRingInit(&ring, &bufRing, 0, URING_BUFFER_COUNT,
+                       sizeof(struct io_uring_recvmsg_out) + nameLen + controlLen + rxBufferSize) != SUCCESS)
+    DieWithSystemMessage("io_uring provided buffer ring setup failed");
+  txMsgs = calloc((size_t)URING_BUFFER_COUNT * slotsPerBuffer, sizeof(struct msghdr));
+  txIovs = calloc((size_t)URING_BUFFER_COUNT * slotsPerBuffer, sizeof(struct iovec));
+  sendsPending = calloc(URING_BUFFER_COUNT, sizeof(uint16_t));
+  if ((txMsgs == NULL) || (txIovs == NULL) || (sendsPending == NULL)) {
+    printf("server: HARD ERROR malloc of %d io_uring send slots failed \n", URING_BUFFER_COUNT);
+    exit(1);
+  }
+
+  //The kernel only looks at the name and control lengths
+  memset(&recvTemplate, 0, sizeof(recvTemplate));
+  recvTemplate.msg_namelen = nameLen;
+  recvTemplate.msg_controllen = controlLen;
+  publishWait.tv_sec = 0;
+  publishWait.tv_nsec = INTERVAL_PUBLISH_NS;
+
+  while (!signalStopRequested())
+  { // Run until SIGINT
+    workerPublishCounters(worker, false);
+    //Stats still unpublished, do not block past the next publish
+    if ((!timeoutArmed) && workerPublishPending(worker)) {
+      sqe = uringGetSqe(&ring);
+      sqe->opcode = IORING_OP_TIMEOUT;
+      sqe->addr = (uint64_t)(uintptr_t)&publishWait;
+      sqe->len = 1;
+      sqe->user_data = URING_USER_DATA(URING_OP_TIMEOUT, 0);
+      timeoutArmed = true;
+    }
+    if ((!recvArmed) && (buffersHeld < URING_BUFFER_COUNT)) {
+      sqe = uringGetSqe(&ring);
+      sqe->opcode = IORING_OP_RECVMSG;
+      sqe->fd = sock;
+      sqe->addr = (uint64_t)(uintptr_t)&recvTemplate;
+      sqe->len = 1;
+      sqe->ioprio = IORING_RECV_MULTISHOT;
+      sqe->flags = IOSQE_BUFFER_SELECT;
+      sqe->buf_group = bufRing.groupID;
+      sqe->user_data = URING_USER_DATA(URING_OP_RECV, 0);
+      recvArmed = true;
+    }
+
+    //Only block when there is nothing to reap
+    if (uringSubmit(&ring, (uringPeekCqe(&ring) == NULL) ? 1 : 0) < 0) {
+      if (errno != EINTR) {
+        stats->RxErrorCount++;
+        perror("server: Error on io_uring_enter ");
+      }
+    }
+    stats->syscallCount = ring.enterCount;
+
+    while ((cqe = uringPeekCqe(&ring)) != NULL) {
+      uint32_t op = (uint32_t)(cqe->user_data >> 32);
+      uint32_t slot = (uint32_t)(cqe->user_data & 0xffffffff);
+      uint16_t bufferID = (uint16_t)(slot / slotsPerBuffer);
+      int32_t res = cqe->res;
+      uint32_t cqeFlags = cqe->flags;
+      uringCqeSeen(&ring);
+
+      if (op == URING_OP_TIMEOUT) {
+        timeoutArmed = false;
+        continue;
+      }
+      if (op == URING_OP_SEND) {
+        if (res < 0) {
+          stats->TxErrorCount++;
+          if (res != -ECANCELED)
+            printf("server: Error on io_uring sendmsg: %s \n", strerror(-res));
+        } else if ((size_t)res != txIovs[slot].iov_len) {
+          stats->TxErrorCount++;
+          printf("server: Error on io_uring sendmsg, only sent %d rather than %d ",
+                 res, (int32_t)txIovs[slot].iov_len);
+        }
+        if (--sendsPending[bufferID] == 0) {
+          uringBufRingAdd(&bufRing, bufferID);
+          buffersHeld--;
+        }
+        continue;
+      }
+
+      if (!(cqeFlags & IORING_CQE_F_MORE))
+        recvArmed = false;
+      if (res < 0) {
+        if (res != -ENOBUFS) {
+          stats->RxErrorCount++;
+          printf("server: Error on io_uring recvmsg: %s \n", strerror(-res));
+        }
+        continue;
+      }
+      if (!(cqeFlags & IORING_CQE_F_BUFFER))
+        continue;
+      bufferID = (uint16_t)(cqeFlags >> IORING_CQE_BUFFER_SHIFT);
+      buffersHeld++;
+
+      char *buffer = uringBufRingBuffer(&bufRing, bufferID);
+      struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)buffer;
+      char *name = buffer + sizeof(struct io_uring_recvmsg_out);
+      char *control = name + nameLen;
+      char *payload = control + controlLen;
+      //Like recvfrom(), a datagram larger than the buffer is cut short
+      ssize_t numBytesRcvd = (out->payloadlen > rxBufferSize) ? (ssize_t)rxBufferSize : out->payloadlen;
+      int64_t kernelRxTime = 0;
+      int groSize = 0;
+      if (controlLen > 0) {
+        struct msghdr controlMsg;
+        memset(&controlMsg, 0, sizeof(controlMsg));
+        controlMsg.msg_control = control;
+        controlMsg.msg_controllen = out->controllen;
+        if (kernelTimestamps)
+          kernelRxTime = getControlTimestamp(&controlMsg);
+        if (udpGRO)
+          groSize = getControlSegmentSize(&controlMsg);
+        if (dropAccounting) {
+          uint32_t dropCount = getControlDropCount(&controlMsg);
+          if (dropCount > stats->socketDrops)
+            stats->socketDrops = dropCount;
         }
-        else if (numBytesSent != numBytesRcvd) {
-          TxErrorCount++;
-          printf("server: Error on sendto, only sent %d rather than %d ",(int32_t)numBytesSent,(int32_t)numBytesRcvd);
+      }
+      ssize_t segmentSize = rxSegmentSize(stats, numBytesRcvd, groSize);
+      ssize_t offset = 0;
+      uint32_t segmentIndex = 0;
+
+      //Once per datagram of a coalesced receive, only these are linked
+      prevSend = NULL;
+      do {
+        char *segment = payload + offset;
+        ssize_t segmentBytes = (numBytesRcvd - offset < segmentSize) ? numBytesRcvd - offset : segmentSize;
+        offset += segmentSize;
+        if (!processRxMessage(worker, segment, segmentBytes, (struct sockaddr_storage *)name, kernelRxTime))
+          continue;
+        if (segmentIndex == slotsPerBuffer) {
+          stats->TxErrorCount++;
+          printf("server: more than %d datagrams in one receive, not echoed \n", slotsPerBuffer);
           continue;
         }
+
+        // Echo straight out of the receive buffer
+        slot = bufferID * slotsPerBuffer + segmentIndex++;
+        stampEchoTime(segment, segmentBytes);
+        txIovs[slot].iov_base = segment;
+        txIovs[slot].iov_len = segmentBytes;
+        txMsgs[slot].msg_name = name;
+        txMsgs[slot].msg_namelen = out->namelen;
+        txMsgs[slot].msg_iov = &txIovs[slot];
+        txMsgs[slot].msg_iovlen = 1;
+        sqe = uringGetSqe(&ring);
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = sock;
+        sqe->addr = (uint64_t)(uintptr_t)&txMsgs[slot];
+        sqe->len = 1;
+        sqe->user_data = URING_USER_DATA(URING_OP_SEND, slot);
+        if (prevSend != NULL)
+          prevSend->flags |= IOSQE_IO_LINK;
+        prevSend = sqe;
+      } while (offset < numBytesRcvd);
+
+      sendsPending[bufferID] = segmentIndex;
+      if (segmentIndex == 0) {
+        uringBufRingAdd(&bufRing, bufferID);
+        buffersHeld--;
       }
     }
+    uringBufRingPublish(&bufRing);
   }
 }
 
+/*************************************************************
+*
+* Function: void CNTCCode()
+*
+* Summary: Prints the end of run summary and exits.  Runs on the main
+*          thread once every worker has returned from its loop.
+*
+***************************************************************/
 void CNTCCode() 
 {
   double  duration = 0.0;
   double avgLossRate  = 0.0;
   double totalLost = 0;
-  uint32_t numberOfTrials;
+  uint64_t numberOfTrials;
   double avgOWD = 0.0; 
+  serverStats totals;
+  seqTracker sequence;
+  uint64_t largestSeqSum = 0;
+  uint32_t activeFlows = 0;
+  uint32_t maxActiveFlows = 0;
+  uint64_t expiredFlows = 0;
+  uint64_t overflowCount = 0;
+  uint32_t flowLines = 0;
+  uint32_t i;
+  uint32_t j;
+
+  signalControlStop();
+  intervalReportStop(&reporter);
+  statsShmClose(&liveStats);
+  mergeWorkerStats(&totals);
+  packetLogClose(&rxLog);
+
+  seqTrackerInit(&sequence, 1);
+  for (i = 0; i < numberWorkers; i++) {
+    flowTableTotals(&workers[i].flows, &sequence, &largestSeqSum);
+    activeFlows += workers[i].flows.activeFlows;
+    maxActiveFlows += workers[i].flows.maxActiveFlows;
+    expiredFlows += workers[i].flows.expiredFlows;
+    overflowCount += workers[i].flows.overflowCount;
+  }
 
   //estimate number of trials (only sender knows this for sure)
- //based on largest seq number seen
-  numberOfTrials = largestSeqRecv;
+ //based on the largest seq number seen from each client
+  numberOfTrials = largestSeqSum;
 
   wallTime = getCurTimeD();
   endTime = wallTime;
   duration = endTime - startTime;
 
-  if (numberOWDSamples > 0)
+  if (totals.numberOWDSamples > 0)
   {
-    avgOWD = OWDSum / numberOWDSamples;
+    avgOWD = totals.OWDSum / totals.numberOWDSamples;
   } else {
   }
 
-  if (numberOfTrials >= receivedCount)
-    totalLost = numberOfTrials - receivedCount;
-  else 
-    totalLost = 0;
+  //Duplicates no longer hide losses
+  totalLost = seqTrackerLost(&sequence);
 
   if (numberOfTrials >  0) {
     avgLossRate = totalLost / (double)numberOfTrials;
@@ -243,17 +1487,191 @@ void CNTCCode()
 
   //A1
   double avgObservedThroughput = 0.0;
-  if (opMode == 0) {
-    printf("UDPEchoV2:Server:Summary:  %12.6f %6.6f %4.9f %2.4f %d %d %d %6.0f %d %d %d\n",
-        wallTime, duration, avgOWD, avgLossRate, numberOfTrials, receivedCount, largestSeqRecv, totalLost,
-        RxErrorCount, TxErrorCount, numberOutOfOrder);
-  }
-  else if (opMode == 1) {
-    avgObservedThroughput = totalBytesRecieved / duration;
-    printf("UDPEchoV2:Server:Summary:  %12.6f %6.6f %4.9f %4.9f %2.4f %d %d %d %6.0f %d %d %d\n",
-      wallTime, duration, avgOWD, avgObservedThroughput, avgLossRate, numberOfTrials, receivedCount, largestSeqRecv, totalLost,
-      RxErrorCount, TxErrorCount, numberOutOfOrder);
+  double streamRate = 0.0;
+  if (totals.opMode == PING_MODE) {
+    printf("UDPEchoV2:Server:Summary:  %12.6f %6.6f %4.9f %2.4f %llu %llu %llu %6.0f %d %d %d\n",
+        wallTime, duration, avgOWD, avgLossRate, (unsigned long long)numberOfTrials, (unsigned long long)totals.receivedCount,
+        (unsigned long long)totals.largestSeqRecv, totalLost,
+        totals.RxErrorCount, totals.TxErrorCount, totals.numberOutOfOrder);
+  }
+  else {
+    avgObservedThroughput = totals.totalBytesRecieved / duration;
+    printf("UDPEchoV2:Server:Summary:  %12.6f %6.6f %4.9f %4.9f %2.4f %llu %llu %llu %6.0f %d %d %d\n",
+      wallTime, duration, avgOWD, avgObservedThroughput, avgLossRate, (unsigned long long)numberOfTrials,
+      (unsigned long long)totals.receivedCount, (unsigned long long)totals.largestSeqRecv, totalLost,
+      totals.RxErrorCount, totals.TxErrorCount, totals.numberOutOfOrder);
+    }
+  if (totals.timeLastPacket > totals.timeFirstPacket)
+    streamRate = 8.0 * totals.totalBytesRecieved / (totals.timeLastPacket - totals.timeFirstPacket);
+  if (totals.opMode == LIMITED_RTT) {
+    printf("UDPEchoV2:Server:LimitedRTT:  %llu %d %14.1f\n",
+        (unsigned long long)totals.receivedCount, totals.echoedCount, streamRate);
+  }
+  if (totals.opMode == ONE_WAY_MODE) {
+    double jitterSum = 0.0;
+    uint32_t jitterFlows = 0;
+    for (i = 0; i < numberWorkers; i++) {
+      flowTable *flows = &workers[i].flows;
+      for (j = 0; j < flows->sessionsUsed; j++) {
+        if (flows->sessions[j].inUse && (flows->sessions[j].numberOWDSamples > 1)) {
+          jitterSum += flows->sessions[j].jitter;
+          jitterFlows++;
+        }
+      }
+    }
+    printf("UDPEchoV2:Server:OneWay:  %llu %llu %2.4f %llu %llu %14.1f %4.9f %4.9f %4.9f %4.9f\n",
+        (unsigned long long)totals.receivedCount, (unsigned long long)totalLost, avgLossRate,
+        (unsigned long long)sequence.reorderedCount, (unsigned long long)sequence.duplicateCount,
+        streamRate, avgOWD, histogramMin(&totals.OWDHistogram), histogramMax(&totals.OWDHistogram),
+        (jitterFlows > 0) ? jitterSum / jitterFlows : 0.0);
+  }
+  if (totals.receivedCount > 0) {
+    double avgReorderDistance = 0.0;
+    if (sequence.reorderedCount > 0)
+      avgReorderDistance = (double)sequence.reorderDistanceSum / (double)sequence.reorderedCount;
+    printf("UDPEchoV2:Server:Sequence:  %llu %llu %llu %llu %llu %llu %4.3f\n",
+        (unsigned long long)sequence.inOrderCount, (unsigned long long)sequence.reorderedCount,
+        (unsigned long long)sequence.duplicateCount, (unsigned long long)seqTrackerLost(&sequence),
+        (unsigned long long)sequence.lateCount, (unsigned long long)sequence.maxReorderDistance,
+        avgReorderDistance);
+    printf("UDPEchoV2:Server:Latency:  %d %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f %4.9f\n",
+        totals.numberOWDSamples, histogramMin(&totals.OWDHistogram),
+        histogramPercentile(&totals.OWDHistogram, 50.0), histogramPercentile(&totals.OWDHistogram, 90.0),
+        histogramPercentile(&totals.OWDHistogram, 99.0), histogramPercentile(&totals.OWDHistogram, 99.9),
+        histogramPercentile(&totals.OWDHistogram, 99.99), histogramMax(&totals.OWDHistogram),
+        histogramMean(&totals.OWDHistogram), histogramStdDev(&totals.OWDHistogram));
+    if ((histogramFile != NULL) && (histogramDump(&totals.OWDHistogram, histogramFile, "ServerOWD") != NOERROR))
+      perror("server: failed to write the OWD histogram ");
+  }
+  if (batchSize > 1) {
+    double avgBatchFill = 0.0;
+    if (totals.batchCallCount > 0)
+      avgBatchFill = (double)totals.batchMsgCount / (double)totals.batchCallCount;
+    printf("UDPEchoV2:Server:Batch:  %d %llu %llu %4.3f %3.1f\n",
+        batchSize, (unsigned long long)totals.batchCallCount, (unsigned long long)totals.batchMsgCount,
+        avgBatchFill, 100.0 * avgBatchFill / (double)batchSize);
+  }
+  if (kernelTimestamps) {
+    double avgKernelOWD = 0.0;
+    double avgUserOWD = 0.0;
+    double avgGap = 0.0;
+    if (totals.kernelOWDSamples > 0) {
+      avgKernelOWD = totals.kernelOWDSum / totals.kernelOWDSamples;
+      avgUserOWD = totals.userOWDSum / totals.kernelOWDSamples;
+      avgGap = totals.kernelGapSum / totals.kernelOWDSamples;
+    }
+    printf("UDPEchoV2:Server:Timestamps:  %d %d %4.9f %4.9f %4.9f\n",
+        totals.kernelOWDSamples, totals.numberOWDSamples - totals.kernelOWDSamples,
+        avgKernelOWD, avgUserOWD, avgGap);
+  }
+  if (lowLatency.busyPoll || (lowLatency.fifoRequested > 0)) {
+    int fifoPriority = lowLatency.fifoRequested;
+    int pinnedWorkers = 0;
+    for (i = 0; i < numberWorkers; i++) {
+      if (workers[i].tuning.fifoApplied < fifoPriority)
+        fifoPriority = workers[i].tuning.fifoApplied;
+      if (workers[i].tuning.pinned)
+        pinnedWorkers++;
+    }
+    printf("UDPEchoV2:Server:BusyPoll:  %d %d %d %d %d %llu\n",
+        lowLatency.busyPoll, lowLatency.busyPoll ? workers[0].tuning.busyPollApplied : 0,
+        lowLatency.memoryLocked, fifoPriority, pinnedWorkers,
+        (unsigned long long)totals.emptyPollCount);
+  }
+  if (dropAccounting) {
+    udpSnmpCounters snmpEnd;
+    udpSnmpCounters snmpDelta;
+    uint64_t socketDrops = 0;
+    double transitLost = 0.0;
+    //The last receive only knows the drops before it, the socket knows them all
+    for (i = 0; i < numberWorkers; i++) {
+      int64_t drops = sockDropCount(workers[i].sock);
+      socketDrops += (drops > (int64_t)workers[i].stats.socketDrops) ? (uint64_t)drops : workers[i].stats.socketDrops;
+    }
+    memset(&snmpDelta, 0, sizeof(snmpDelta));
+    if (udpSnmpRead(&snmpEnd) == NOERROR)
+      udpSnmpDelta(&snmpStart, &snmpEnd, &snmpDelta);
+    if (totalLost > (double)socketDrops)
+      transitLost = totalLost - (double)socketDrops;
+    printf("UDPEchoV2:Server:Drops:  %d %d %d %d %llu %llu %llu %llu %6.0f %2.4f %2.4f\n",
+        rcvbufBytes, workers[0].rcvbufGranted, sndbufBytes, workers[0].sndbufGranted,
+        (unsigned long long)socketDrops, (unsigned long long)snmpDelta.rcvbufErrors,
+        (unsigned long long)snmpDelta.inErrors, (unsigned long long)snmpDelta.sndbufErrors, transitLost,
+        (numberOfTrials > 0) ? (double)socketDrops / numberOfTrials : 0.0,
+        (numberOfTrials > 0) ? transitLost / numberOfTrials : 0.0);
+  }
+  printf("UDPEchoV2:Server:Flows:  %d %d %llu %llu\n",
+      activeFlows, maxActiveFlows, (unsigned long long)expiredFlows, (unsigned long long)overflowCount);
+  for (i = 0; i < numberWorkers; i++) {
+    flowTable *flows = &workers[i].flows;
+    for (j = 0; j < flows->sessionsUsed; j++) {
+      flowSession *flow = &flows->sessions[j];
+      if (!flow->inUse)
+        continue;
+      if (flowLines++ == FLOW_SUMMARY_MAX_LINES) {
+        printf("UDPEchoV2:Server:Flow:  only the first %d flows are listed\n", FLOW_SUMMARY_MAX_LINES);
+        break;
+      }
+      printf("UDPEchoV2:Server:Flow:  %d ", workers[i].workerID);
+      PrintSocketAddress(&flow->clientAddr.sa, stdout);
+      printf(" %llu %llu %llu %llu %llu %4.9f %4.9f %4.9f %llu %6.6f %4.9f\n",
+          (unsigned long long)flow->receivedCount, (unsigned long long)flow->largestSeqRecv,
+          (unsigned long long)seqTrackerLost(&flow->sequence),
+          (unsigned long long)flow->sequence.reorderedCount,
+          (unsigned long long)flow->sequence.duplicateCount,
+          (flow->numberOWDSamples > 0) ? flow->OWDSum / flow->numberOWDSamples : 0.0,
+          flow->minOWD, flow->maxOWD, (unsigned long long)flow->totalBytesRecieved,
+          flow->timeLastPacket - flow->timeFirstPacket, flow->jitter);
+    }
+  }
+  {
+    const char *loopName = "classic";
+    if (useUring)
+      loopName = uringSqPoll ? "io_uring-sqpoll" : "io_uring";
+    else if (batchSize > 1)
+      loopName = "batched";
+    printf("UDPEchoV2:Server:Syscalls:  %s %llu %llu %4.3f\n",
+        loopName, (unsigned long long)totals.syscallCount, (unsigned long long)totals.receivedCount,
+        (totals.receivedCount > 0) ? (double)totals.syscallCount / totals.receivedCount : 0.0);
+  }
+  if (udpGRO) {
+    printf("UDPEchoV2:Server:GRO:  %llu %llu %4.3f\n",
+        (unsigned long long)totals.groReceiveCount, (unsigned long long)totals.groSegmentCount,
+        (totals.groReceiveCount > 0) ? (double)totals.groSegmentCount / totals.groReceiveCount : 0.0);
+  }
+  if (zeroCopy) {
+    unsigned long long zcSends = 0, zcCompleted = 0, zcCopied = 0, zcFallback = 0;
+    int zcPinned = 1;
+    for (i = 0; i < numberWorkers; i++) {
+      zeroCopyPool *pool = &workers[i].txPool;
+      zeroCopyReap(pool, 0);
+      zcSends += pool->sendCount;
+      zcCompleted += pool->zeroCopyCount;
+      zcCopied += pool->copiedCount;
+      zcFallback += pool->fallbackCount;
+      if (!pool->pinned)
+        zcPinned = 0;
+    }
+    printf("UDPEchoV2:Server:ZeroCopy:  %llu %llu %llu %llu %d\n",
+        zcSends, zcCompleted, zcCopied, zcFallback, zcPinned);
+  }
+  if (logFile != NULL) {
+    printf("UDPEchoV2:Server:Log:  %llu %llu\n",
+        (unsigned long long)rxLog.recordsWritten, (unsigned long long)packetLogDropped(&rxLog));
+  }
+  if (numberWorkers > 1) {
+    for (i = 0; i < numberWorkers; i++) {
+      serverStats *stats = &workers[i].stats;
+      double workerOWD = 0.0;
+      if (stats->numberOWDSamples > 0)
+        workerOWD = stats->OWDSum / stats->numberOWDSamples;
+      printf("UDPEchoV2:Server:Worker:  %d %d %llu %llu %4.9f %llu %d %d\n",
+          workers[i].workerID, workers[i].cpu, (unsigned long long)stats->receivedCount,
+          (unsigned long long)stats->largestSeqRecv,
+          workerOWD, (unsigned long long)stats->totalBytesRecieved,
+          stats->RxErrorCount, stats->TxErrorCount);
     }
+  }
   /*
   if (opMode == 1) {
     print avgOWD and then immediately avgObservedThroughput;
@@ -265,5 +1683,171 @@ void CNTCCode()
         exit(0);
 }
 
+/*************************************************************
+*
+* Function: void mergeWorkerStats(serverStats *totals)
+*
+* Summary: Folds the stats of every worker into one block for the
+*          summary.  Counts and sums add up, the largest sequence
+*          number is the max over the workers.
+*
+* Inputs:
+*   serverStats *totals : caller's block to fill in
+*
+* outputs:
+*   updates totals
+*
+***************************************************************/
+void mergeWorkerStats(serverStats *totals)
+{
+  uint32_t i;
+
+  memset(totals, 0, sizeof(serverStats));
+  for (i = 0; i < numberWorkers; i++) {
+    serverStats *stats = &workers[i].stats;
+    if (stats->largestSeqRecv > totals->largestSeqRecv)
+      totals->largestSeqRecv = stats->largestSeqRecv;
+    totals->receivedCount += stats->receivedCount;
+    totals->RxErrorCount += stats->RxErrorCount;
+    totals->TxErrorCount += stats->TxErrorCount;
+    totals->numberOutOfOrder += stats->numberOutOfOrder;
+    if (stats->receivedCount > 0)
+      totals->opMode = stats->opMode;
+    totals->OWDSum += stats->OWDSum;
+    totals->numberOWDSamples += stats->numberOWDSamples;
+    totals->batchCallCount += stats->batchCallCount;
+    totals->batchMsgCount += stats->batchMsgCount;
+    totals->syscallCount += stats->syscallCount;
+    totals->emptyPollCount += stats->emptyPollCount;
+    totals->socketDrops += stats->socketDrops;
+    //error queue reads and retries of the zero copy echoes
+    totals->syscallCount += workers[i].txPool.syscallCount;
+    totals->groReceiveCount += stats->groReceiveCount;
+    totals->groSegmentCount += stats->groSegmentCount;
+    totals->totalBytesRecieved += stats->totalBytesRecieved;
+    totals->echoedCount += stats->echoedCount;
+    totals->echoedBytes += stats->echoedBytes;
+    totals->expectedCount += stats->expectedCount;
+    if (stats->timeLastPacket > totals->timeLastPacket)
+      totals->timeLastPacket = stats->timeLastPacket;
+    totals->kernelOWDSamples += stats->kernelOWDSamples;
+    totals->kernelOWDSum += stats->kernelOWDSum;
+    totals->userOWDSum += stats->userOWDSum;
+    totals->kernelGapSum += stats->kernelGapSum;
+    histogramMerge(&totals->OWDHistogram, &stats->OWDHistogram);
+    if ((stats->receivedCount > 0) &&
+        ((totals->timeFirstPacket == 0.0) || (stats->timeFirstPacket < totals->timeFirstPacket)))
+      totals->timeFirstPacket = stats->timeFirstPacket;
+  }
+}
+
+/*************************************************************
+*
+* Function: void workerPublishCounters(serverWorker *worker, bool force)
+*
+* Summary: Copies a worker's stats into its published block.  Called by
+*          the worker itself at the top of its receive loop, so the
+*          stats are never read while they change.
+*
+* Inputs:
+*   serverWorker *worker : the calling worker
+*   bool force : publish now rather than once INTERVAL_PUBLISH_NS passed
+*
+***************************************************************/
+void workerPublishCounters(serverWorker *worker, bool force)
+{
+  serverStats *stats = &worker->stats;
+  intervalCounters *counters;
+  int64_t now = timeNowNs();
 
+  if ((!force) && (!intervalPublishDue(&worker->published, now)))
+    return;
+  counters = intervalPublishBegin(&worker->published);
+  memset(counters, 0, offsetof(intervalCounters, latency));
+  counters->sentCount = stats->echoedCount;
+  counters->sentBytes = stats->echoedBytes;
+  counters->receivedCount = stats->receivedCount;
+  counters->receivedBytes = stats->totalBytesRecieved;
+  counters->expectedCount = stats->expectedCount;
+  counters->arrivedCount = stats->receivedCount;
+  counters->reorderedCount = stats->numberOutOfOrder;
+  counters->RxErrorCount = stats->RxErrorCount;
+  counters->TxErrorCount = stats->TxErrorCount;
+  memcpy(&counters->latency, &stats->OWDHistogram, sizeof(latencyHistogram));
+  intervalPublishEnd(&worker->published, now);
+}
 
+/*************************************************************
+*
+* Function: bool workerPublishPending(serverWorker *worker)
+*
+* Summary: Whether the worker counted anything it has not published
+*          yet.  While it has, its receive loop must not block for
+*          longer than INTERVAL_PUBLISH_NS, or a worker that goes quiet
+*          after a burst would leave the burst's tail unpublished.
+*
+***************************************************************/
+bool workerPublishPending(serverWorker *worker)
+{
+  serverStats *stats = &worker->stats;
+  intervalCounters *counters = &worker->published.counters;
+
+  return ((stats->receivedCount != counters->receivedCount) ||
+          (stats->echoedCount != counters->sentCount) ||
+          (stats->RxErrorCount != counters->RxErrorCount) ||
+          (stats->TxErrorCount != counters->TxErrorCount));
+}
+
+/*************************************************************
+*
+* Function: void workerRecvTimeout(serverWorker *worker, bool on)
+*
+* Summary: Sets SO_RCVTIMEO on the worker's socket to
+*          INTERVAL_PUBLISH_NS, or clears it, if that is a change.  A
+*          receive that times out returns EAGAIN and the loop goes
+*          round to publish.  Busy poll sockets never block, they are
+*          left alone.
+*
+***************************************************************/
+void workerRecvTimeout(serverWorker *worker, bool on)
+{
+  struct timeval timeout;
+
+  if (worker->tuning.busyPoll || (on == worker->recvTimeout))
+    return;
+  timeout.tv_sec = 0;
+  timeout.tv_usec = on ? INTERVAL_PUBLISH_NS / 1000 : 0;
+  worker->stats.syscallCount++;
+  if (setsockopt(worker->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0)
+    worker->recvTimeout = on;
+}
+
+/*************************************************************
+*
+* Function: void serverIntervalSnapshot(intervalCounters *counters)
+*
+* Summary: The interval reporter's and the statistics segment's view
+*          of the workers' stats, summed over what each worker last
+*          published.
+*
+***************************************************************/
+void serverIntervalSnapshot(intervalCounters *counters)
+{
+  intervalCounters published;
+  uint32_t i;
+
+  memset(counters, 0, sizeof(intervalCounters));
+  for (i = 0; i < numberWorkers; i++) {
+    intervalPublishRead(&workers[i].published, &published);
+    counters->sentCount += published.sentCount;
+    counters->sentBytes += published.sentBytes;
+    counters->receivedCount += published.receivedCount;
+    counters->receivedBytes += published.receivedBytes;
+    counters->expectedCount += published.expectedCount;
+    counters->arrivedCount += published.arrivedCount;
+    counters->reorderedCount += published.reorderedCount;
+    counters->RxErrorCount += published.RxErrorCount;
+    counters->TxErrorCount += published.TxErrorCount;
+    histogramMerge(&counters->latency, &published.latency);
+  }
+}
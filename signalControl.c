@@ -0,0 +1,238 @@
+/*********************************************************
+* Module Name:  Signal control
+*
+* File Name:    signalControl.c
+*
+* Summary:
+*   Control thread reading SIGINT, SIGTERM and SIGUSR1 from a signalfd,
+*   so stopping and snapshots run in normal context.  See signalControl.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+#include "signalControl.h"
+
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+
+typedef struct {
+  pthread_t thread;
+  bool done;
+} signalThread;
+
+static void *signalControlMain(void *arg);
+static void signalWakeHandler(int ignored);
+static void signalWakeThreads();
+
+static int signalFd = -1;
+//written by signalControlStop() to end the control thread's poll
+static int finishFd = -1;
+static const char *snapshotTag = NULL;
+static intervalSnapshot snapshotCounters = NULL;
+static int64_t startNs = 0;
+static pthread_t controlThread;
+static bool controlRunning = false;
+static atomic_bool stopRequested;
+
+//Threads to wake at a stop, the mutex keeps a finished one from being signalled
+static pthread_mutex_t threadLock = PTHREAD_MUTEX_INITIALIZER;
+static signalThread threads[SIGNAL_MAX_THREADS];
+static int numberThreads = 0;
+
+/*************************************************************
+*
+* Function: int signalControlStart(const char *tag, intervalSnapshot snapshot)
+*
+* Summary: Blocks SIGINT, SIGTERM and SIGUSR1 in the calling thread,
+*          opens the signalfd for them and starts the control thread.
+*          Call it before any other thread is started.
+*
+* Inputs:
+*   const char *tag : program part of the Snapshot line, e.g. "Server"
+*   intervalSnapshot snapshot : fills in the program's cumulative
+*                               counters, called from the control thread
+*
+* outputs:
+*   returns NOERROR or ERROR (errno set) if anything could not be set up
+*
+***************************************************************/
+int signalControlStart(const char *tag, intervalSnapshot snapshot)
+{
+  struct sigaction handler;
+  sigset_t controlSignals;
+  sigset_t allSignals;
+  sigset_t oldSignals;
+
+  snapshotTag = tag;
+  snapshotCounters = snapshot;
+  startNs = timeNowNs();
+  atomic_store(&stopRequested, false);
+
+  sigemptyset(&controlSignals);
+  sigaddset(&controlSignals, SIGINT);
+  sigaddset(&controlSignals, SIGTERM);
+  sigaddset(&controlSignals, SIGUSR1);
+  if (pthread_sigmask(SIG_BLOCK, &controlSignals, NULL) != 0)
+    return ERROR;
+  signalFd = signalfd(-1, &controlSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (signalFd < 0)
+    return ERROR;
+  finishFd = eventfd(0, EFD_CLOEXEC);
+  if (finishFd < 0)
+    return ERROR;
+
+  //No SA_RESTART, the wake up has to cut a blocking call short
+  memset(&handler, 0, sizeof(handler));
+  handler.sa_handler = signalWakeHandler;
+  sigemptyset(&handler.sa_mask);
+  handler.sa_flags = 0;
+  if (sigaction(SIGNAL_WAKE, &handler, NULL) < 0)
+    return ERROR;
+
+  //the thread inherits the mask, so no signal is ever delivered to it
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &oldSignals);
+  errno = pthread_create(&controlThread, NULL, signalControlMain, NULL);
+  pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+  if (errno != 0)
+    return ERROR;
+  controlRunning = true;
+  return NOERROR;
+}
+
+/*************************************************************
+*
+* Function: int signalControlAddThread(pthread_t thread)
+*
+* Summary: Registers a thread running a packet loop, so a stop can
+*          interrupt it
+*
+* outputs:
+*   returns the thread's slot for signalControlThreadDone(), or ERROR
+*   if SIGNAL_MAX_THREADS are registered already
+*
+***************************************************************/
+int signalControlAddThread(pthread_t thread)
+{
+  int slot = ERROR;
+
+  pthread_mutex_lock(&threadLock);
+  if (numberThreads < SIGNAL_MAX_THREADS) {
+    slot = numberThreads++;
+    threads[slot].thread = thread;
+    threads[slot].done = false;
+  }
+  pthread_mutex_unlock(&threadLock);
+  return slot;
+}
+
+/*************************************************************
+*
+* Function: void signalControlThreadDone(int slot)
+*
+* Summary: Called by a registered thread once its loop has returned,
+*          it is no longer woken and may be joined
+*
+***************************************************************/
+void signalControlThreadDone(int slot)
+{
+  if ((slot < 0) || (slot >= SIGNAL_MAX_THREADS))
+    return;
+  pthread_mutex_lock(&threadLock);
+  threads[slot].done = true;
+  pthread_mutex_unlock(&threadLock);
+}
+
+/*************************************************************
+*
+* Function: bool signalStopRequested()
+*
+* Summary: Whether a SIGINT or SIGTERM asked the program to stop.
+*          Cheap enough to poll once per pass of a packet loop.
+*
+***************************************************************/
+bool signalStopRequested()
+{
+  return atomic_load_explicit(&stopRequested, memory_order_relaxed);
+}
+
+/*************************************************************
+*
+* Function: void signalControlStop()
+*
+* Summary: Ends the control thread.  Called on the way to the summary,
+*          a SIGUSR1 from then on is ignored and a SIGINT no longer
+*          needed.  Safe to call more than once.
+*
+***************************************************************/
+void signalControlStop()
+{
+  uint64_t one = 1;
+
+  if (!controlRunning)
+    return;
+  if (write(finishFd, &one, sizeof(one)) != sizeof(one))
+    perror("signalControlStop: write(eventfd) failed ");
+  pthread_join(controlThread, NULL);
+  controlRunning = false;
+}
+
+//Only there to make a blocking call return EINTR
+static void signalWakeHandler(int ignored)
+{
+}
+
+static void signalWakeThreads()
+{
+  int i;
+
+  pthread_mutex_lock(&threadLock);
+  for (i = 0; i < numberThreads; i++) {
+    if (!threads[i].done)
+      pthread_kill(threads[i].thread, SIGNAL_WAKE);
+  }
+  pthread_mutex_unlock(&threadLock);
+}
+
+static void *signalControlMain(void *arg)
+{
+  struct signalfd_siginfo info;
+  struct pollfd pollFds[2];
+  intervalCounters *counters = NULL;
+  int timeout;
+
+  pollFds[0].fd = signalFd;
+  pollFds[0].events = POLLIN;
+  pollFds[1].fd = finishFd;
+  pollFds[1].events = POLLIN;
+  for (;;) {
+    timeout = atomic_load(&stopRequested) ? (int)(SIGNAL_WAKE_RETRY_NS / 1000000) : -1;
+    if (poll(pollFds, 2, timeout) == 0) {
+      signalWakeThreads();
+      continue;
+    }
+    if (pollFds[1].revents & POLLIN)
+      break;
+    while (read(signalFd, &info, sizeof(info)) == sizeof(info)) {
+      if (info.ssi_signo == SIGUSR1) {
+        if (counters == NULL)
+          counters = calloc(1, sizeof(intervalCounters));
+        if (counters == NULL)
+          continue;
+        snapshotCounters(counters);
+        intervalReportSnapshot(snapshotTag, counters, nsToSecs(timeNowNs() - startNs));
+        continue;
+      }
+      if (atomic_load(&stopRequested)) {
+        //A second one, the loops are stuck somewhere
+        fprintf(stderr, "second stop signal, exiting without a summary \n");
+        _exit(1);
+      }
+      atomic_store(&stopRequested, true);
+      signalWakeThreads();
+    }
+  }
+  free(counters);
+  return NULL;
+}
@@ -0,0 +1,59 @@
+/************************************************************************
+* File:  signalControl.h
+*
+* Purpose:
+*   SIGINT, SIGTERM and SIGUSR1 for the client and server without
+*   running any of the program's code in a signal handler.  The summary
+*   is printed from normal context once the packet loops have returned,
+*   and a SIGUSR1 prints a snapshot of the counters while the run goes on.
+*
+* Notes:
+*   signalControlStart() blocks the three signals, before the program
+*   starts any other thread so every thread inherits the mask, and reads
+*   them from a signalfd on a control thread of its own:
+*     SIGUSR1          : prints a Snapshot line (below) and carries on
+*     SIGINT, SIGTERM  : sets the stop flag the loops poll through
+*                        signalStopRequested(); a second one exits at once
+*
+*   A loop blocked in a system call would only see the flag once a
+*   datagram arrives, so while stopping the control thread sends
+*   SIGNAL_WAKE to every registered thread that has not finished, every
+*   SIGNAL_WAKE_RETRY_NS until they have.  Its handler is empty and
+*   installed without SA_RESTART, the call returns EINTR and the loop
+*   finds the flag set.  Repeating it covers a thread that was just about
+*   to block when the first one arrived.
+*
+*   The snapshot comes from the same intervalSnapshot callback the
+*   interval reporter uses (see intervalReport.h), which reads the copies
+*   the packet threads publish under a seqlock rather than the live
+*   counters.  Each thread's copy is consistent, but it can be up to
+*   INTERVAL_PUBLISH_NS old and the threads' copies are not all of the
+*   same instant:
+*     printf("UDPEchoV2:<tag>:Snapshot:  %12.6f %8.3f %llu %llu %llu %llu %llu %llu %2.4f %llu %llu %llu %llu %llu %4.9f %4.9f %4.9f %4.9f\n",
+*           wallTime, elapsed, sent, received, sentBytes, receivedBytes,
+*           expected, arrived, lossRate, reordered, RxErrors, TxErrors,
+*           timeouts, latencySamples, p50, p90, p99, max);
+*
+************************************************************************/
+#ifndef	__signalControl_h
+#define	__signalControl_h
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "intervalReport.h"
+
+//Interrupts the blocking calls of the threads still running at a stop
+#define SIGNAL_WAKE SIGUSR2
+//How often the wake up is repeated until they have all finished
+#define SIGNAL_WAKE_RETRY_NS 10000000LL
+//Threads that can be registered: the workers and a main thread
+#define SIGNAL_MAX_THREADS (MAX_WORKERS + 1)
+
+int signalControlStart(const char *tag, intervalSnapshot snapshot);
+int signalControlAddThread(pthread_t thread);
+void signalControlThreadDone(int slot);
+bool signalStopRequested();
+void signalControlStop();
+
+#endif
+
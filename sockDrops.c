@@ -0,0 +1,215 @@
+/*********************************************************
+* Module Name:  Socket drop accounting
+*
+* File Name:    sockDrops.c
+*
+* Summary:
+*   Socket buffer sizes, socket drop counts and the host's UDP
+*   counters.  See sockDrops.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "sockDrops.h"
+
+#include <linux/sock_diag.h>
+
+#define SNMP_FILE "/proc/net/snmp"
+#define SNMP6_FILE "/proc/net/snmp6"
+#define SNMP_LINE_LEN 1024
+
+static void udpSnmpField(udpSnmpCounters *counters, const char *name, uint64_t value);
+
+/*************************************************************
+*
+* Function: int sockSetBuffer(int sock, bool receive, int bytes, int *granted)
+*
+* Summary: Sizes the socket's receive or send buffer, forcing it past
+*          the sysctl limit if the process may
+*
+* Inputs:
+*   int sock : the socket
+*   bool receive : true for SO_RCVBUF, false for SO_SNDBUF
+*   int bytes : the size asked for, 0 only reads the size back
+*   int *granted : filled in with the size the socket reports afterwards
+*
+* outputs:
+*   returns NOERROR, or ERROR (errno set) if neither option was accepted
+*
+***************************************************************/
+int sockSetBuffer(int sock, bool receive, int bytes, int *granted)
+{
+  int forceName = receive ? SO_RCVBUFFORCE : SO_SNDBUFFORCE;
+  int optName = receive ? SO_RCVBUF : SO_SNDBUF;
+  socklen_t len = sizeof(*granted);
+  int rc = NOERROR;
+
+  if ((bytes > 0) &&
+      (setsockopt(sock, SOL_SOCKET, forceName, &bytes, sizeof(bytes)) < 0) &&
+      (setsockopt(sock, SOL_SOCKET, optName, &bytes, sizeof(bytes)) < 0))
+    rc = ERROR;
+  if (getsockopt(sock, SOL_SOCKET, optName, granted, &len) < 0)
+    *granted = -1;
+  return rc;
+}
+
+/*************************************************************
+*
+* Function: int enableRxqOverflow(int sock)
+*
+* Summary: Has every receive on the socket report the socket's drop
+*          count (SO_RXQ_OVFL)
+*
+* outputs:
+*   returns NOERROR or ERROR (errno set by setsockopt)
+*
+***************************************************************/
+int enableRxqOverflow(int sock)
+{
+  int optval = 1;
+
+  if (setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &optval, sizeof(optval)) < 0)
+    return ERROR;
+  return NOERROR;
+}
+
+/*************************************************************
+*
+* Function: uint32_t getControlDropCount(struct msghdr *msg)
+*
+* Summary: Pulls the SO_RXQ_OVFL drop count out of the control
+*          messages of a received msghdr.
+*
+* outputs:
+*   returns the datagrams the socket had dropped when this one was
+*   queued, 0 if the control message is not there
+*
+***************************************************************/
+uint32_t getControlDropCount(struct msghdr *msg)
+{
+  struct cmsghdr *cmsg;
+  uint32_t dropCount = 0;
+
+  for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SO_RXQ_OVFL)) {
+      memcpy(&dropCount, CMSG_DATA(cmsg), sizeof(dropCount));
+      return dropCount;
+    }
+  }
+  return 0;
+}
+
+/*************************************************************
+*
+* Function: int64_t sockDropCount(int sock)
+*
+* Summary: The datagrams the socket has dropped so far, from
+*          SK_MEMINFO_DROPS
+*
+* outputs:
+*   returns the count, or -1 if SO_MEMINFO failed
+*
+***************************************************************/
+int64_t sockDropCount(int sock)
+{
+  uint32_t memInfo[SK_MEMINFO_VARS];
+  socklen_t len = sizeof(memInfo);
+
+  memset(memInfo, 0, sizeof(memInfo));
+  if (getsockopt(sock, SOL_SOCKET, SO_MEMINFO, memInfo, &len) < 0)
+    return -1;
+  if (len <= SK_MEMINFO_DROPS * sizeof(uint32_t))
+    return -1;
+  return memInfo[SK_MEMINFO_DROPS];
+}
+
+/*************************************************************
+*
+* Function: int udpSnmpRead(udpSnmpCounters *counters)
+*
+* Summary: Reads the host's UDP counters from /proc/net/snmp and,
+*          if IPv6 is there, /proc/net/snmp6
+*
+* Inputs:
+*   udpSnmpCounters *counters : caller's counters to fill in
+*
+* outputs:
+*   returns NOERROR, or ERROR if /proc/net/snmp could not be read, in
+*   which case the counters are 0
+*
+* notes:
+*   /proc/net/snmp has a line of names and then one of values per
+*   protocol, /proc/net/snmp6 one name value pair per line.
+*
+***************************************************************/
+int udpSnmpRead(udpSnmpCounters *counters)
+{
+  char names[SNMP_LINE_LEN];
+  char values[SNMP_LINE_LEN];
+  char *nameSave = NULL;
+  char *valueSave = NULL;
+  char *name;
+  char *value;
+  unsigned long long count;
+  bool found = false;
+  FILE *fp;
+
+  memset(counters, 0, sizeof(udpSnmpCounters));
+  fp = fopen(SNMP_FILE, "r");
+  if (fp == NULL)
+    return ERROR;
+  while (fgets(names, sizeof(names), fp) != NULL) {
+    if (strncmp(names, "Udp: ", 5) != 0)
+      continue;
+    if (fgets(values, sizeof(values), fp) == NULL)
+      break;
+    name = strtok_r(names + 5, " \n", &nameSave);
+    value = strtok_r(values + 5, " \n", &valueSave);
+    while ((name != NULL) && (value != NULL)) {
+      udpSnmpField(counters, name, strtoull(value, NULL, 10));
+      name = strtok_r(NULL, " \n", &nameSave);
+      value = strtok_r(NULL, " \n", &valueSave);
+    }
+    found = true;
+    break;
+  }
+  fclose(fp);
+
+  fp = fopen(SNMP6_FILE, "r");
+  if (fp != NULL) {
+    while (fgets(names, sizeof(names), fp) != NULL) {
+      if ((strncmp(names, "Udp6", 4) == 0) &&
+          (sscanf(names, "Udp6%255s %llu", values, &count) == 2))
+        udpSnmpField(counters, values, count);
+    }
+    fclose(fp);
+  }
+  return found ? NOERROR : ERROR;
+}
+
+/*************************************************************
+*
+* Function: void udpSnmpDelta(udpSnmpCounters *before,
+*                   udpSnmpCounters *after, udpSnmpCounters *delta)
+*
+* Summary: delta = after - before
+*
+***************************************************************/
+void udpSnmpDelta(udpSnmpCounters *before, udpSnmpCounters *after, udpSnmpCounters *delta)
+{
+  delta->inDatagrams = after->inDatagrams - before->inDatagrams;
+  delta->inErrors = after->inErrors - before->inErrors;
+  delta->rcvbufErrors = after->rcvbufErrors - before->rcvbufErrors;
+  delta->sndbufErrors = after->sndbufErrors - before->sndbufErrors;
+}
+
+static void udpSnmpField(udpSnmpCounters *counters, const char *name, uint64_t value)
+{
+  if (strcmp(name, "InDatagrams") == 0)
+    counters->inDatagrams += value;
+  else if (strcmp(name, "InErrors") == 0)
+    counters->inErrors += value;
+  else if (strcmp(name, "RcvbufErrors") == 0)
+    counters->rcvbufErrors += value;
+  else if (strcmp(name, "SndbufErrors") == 0)
+    counters->sndbufErrors += value;
+}
@@ -0,0 +1,51 @@
+/************************************************************************
+* File:  sockDrops.h
+*
+* Purpose:
+*   Socket buffer sizing and the counters that tell a datagram dropped
+*   by the receiving host from one lost on the way.  When a sender
+*   outruns the receiver the kernel drops datagrams at the full socket
+*   queue, and to the sequence numbers that looks like network loss.
+*
+* Notes:
+*   sockSetBuffer() tries SO_RCVBUFFORCE/SO_SNDBUFFORCE first, which
+*   needs CAP_NET_ADMIN but is not capped by net.core.rmem_max/wmem_max,
+*   then the plain option.  The size granted is read back from the
+*   socket; the kernel doubles what it is asked for, to leave room for
+*   its own bookkeeping, so a granted size is about twice the request.
+*
+*   With SO_RXQ_OVFL each receive carries the socket's drop count, as
+*   it was when the datagram was queued, in a control message.  The
+*   control message is left out while the count is 0.  Drops after the
+*   last datagram received only show in SK_MEMINFO_DROPS, read with
+*   SO_MEMINFO once the run is over.
+*
+*   /proc/net/snmp and /proc/net/snmp6 hold the host's UDP counters.
+*   They count every UDP socket on the host, so their change over a run
+*   is only all ours on an otherwise quiet host:
+*     RcvbufErrors : datagrams dropped at a full receive buffer
+*     InErrors     : datagrams dropped on receive for any reason,
+*                    RcvbufErrors included
+*     SndbufErrors : sends that failed for want of send buffer
+*
+************************************************************************/
+#ifndef	__sockDrops_h
+#define	__sockDrops_h
+
+//The host's UDP counters, IPv4 and IPv6 summed
+typedef struct {
+  uint64_t inDatagrams;
+  uint64_t inErrors;
+  uint64_t rcvbufErrors;
+  uint64_t sndbufErrors;
+} udpSnmpCounters;
+
+int sockSetBuffer(int sock, bool receive, int bytes, int *granted);
+int enableRxqOverflow(int sock);
+uint32_t getControlDropCount(struct msghdr *msg);
+int64_t sockDropCount(int sock);
+int udpSnmpRead(udpSnmpCounters *counters);
+void udpSnmpDelta(udpSnmpCounters *before, udpSnmpCounters *after, udpSnmpCounters *delta);
+
+#endif
+
@@ -0,0 +1,169 @@
+/*********************************************************
+* Module Name:  Kernel socket timestamps
+*
+* File Name:    sockTimestamp.c
+*
+* Summary:
+*   Enables and reads SO_TIMESTAMPING software timestamps so that
+*   RTT and OWD samples can be taken where the kernel saw the packet
+*   rather than where the tool got around to looking at the clock.
+*   See sockTimestamp.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+#include "sockTimestamp.h"
+
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+/*************************************************************
+*
+* Function: int enableSocketTimestamps(int sock, bool txTimestamps)
+*
+* Summary: Turns on software RX (and optionally TX) timestamping.
+*
+* Inputs:
+*   int sock : the socket
+*   bool txTimestamps : also queue a TX timestamp for every send
+*
+* outputs:
+*   returns NOERROR or ERROR (errno set by setsockopt)
+*
+* notes:
+*   TX timestamps carry an ID (OPT_ID) that counts the sends on the
+*   socket from 0, so the caller can tie each one to its datagram.
+*   OPT_TSONLY keeps the payload out of the error queue.
+*
+***************************************************************/
+int enableSocketTimestamps(int sock, bool txTimestamps)
+{
+  int flags = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE;
+
+  if (txTimestamps)
+    flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+             SOF_TIMESTAMPING_OPT_TSONLY;
+
+  if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0)
+    return ERROR;
+  return NOERROR;
+}
+
+/*************************************************************
+*
+* Function: int64_t getControlTimestamp(struct msghdr *msg)
+*
+* Summary: Pulls the software timestamp out of the control messages
+*          of a received msghdr.
+*
+* outputs:
+*   returns the timestamp in nanoseconds or 0 if there is none
+*
+***************************************************************/
+int64_t getControlTimestamp(struct msghdr *msg)
+{
+  struct cmsghdr *cmsg;
+
+  for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SO_TIMESTAMPING)) {
+      //ts[0] is the software timestamp, ts[2] the hardware one
+      struct timespec *ts = (struct timespec *)CMSG_DATA(cmsg);
+      return timespecToNs(&ts[0]);
+    }
+  }
+  return 0;
+}
+
+/*************************************************************
+*
+* Function: ssize_t recvWithTimestamp(int sock, void *buffer, size_t len,
+*               int flags, struct sockaddr *from, socklen_t *fromLen,
+*               int64_t *kernelRxTime)
+*
+* Summary: recvfrom() that also returns the kernel RX timestamp.
+*
+* Inputs:
+*   same as recvfrom() plus
+*   int64_t *kernelRxTime : filled in with the kernel timestamp in ns, 0 if none
+*
+* outputs:
+*   returns the bytes received or -1 with errno set
+*
+***************************************************************/
+ssize_t recvWithTimestamp(int sock, void *buffer, size_t len, int flags,
+                          struct sockaddr *from, socklen_t *fromLen, int64_t *kernelRxTime)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  char control[TIMESTAMP_CONTROL_LEN];
+  ssize_t rc;
+
+  iov.iov_base = buffer;
+  iov.iov_len = len;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = from;
+  msg.msg_namelen = (fromLen != NULL) ? *fromLen : 0;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  *kernelRxTime = 0;
+  rc = recvmsg(sock, &msg, flags);
+  if (rc < 0)
+    return rc;
+  if (fromLen != NULL)
+    *fromLen = msg.msg_namelen;
+  *kernelRxTime = getControlTimestamp(&msg);
+  return rc;
+}
+
+/*************************************************************
+*
+* Function: int readTxTimestamp(int sock, uint32_t *tsKey, int64_t *kernelTxTime)
+*
+* Summary: Reads one TX timestamp from the socket error queue
+*          without blocking.
+*
+* Inputs:
+*   int sock : a socket with TX timestamps enabled
+*   uint32_t *tsKey : filled in with the send's ID (0 for the first send)
+*   int64_t *kernelTxTime : filled in with the kernel TX timestamp in ns
+*
+* outputs:
+*   returns 1 if a timestamp was read, 0 if the queue is empty,
+*   ERROR on any other failure
+*
+***************************************************************/
+int readTxTimestamp(int sock, uint32_t *tsKey, int64_t *kernelTxTime)
+{
+  struct msghdr msg;
+  char control[TIMESTAMP_CONTROL_LEN];
+  struct cmsghdr *cmsg;
+  bool haveKey = false;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      return 0;
+    return ERROR;
+  }
+
+  *kernelTxTime = getControlTimestamp(&msg);
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (((cmsg->cmsg_level == SOL_IP) && (cmsg->cmsg_type == IP_RECVERR)) ||
+        ((cmsg->cmsg_level == SOL_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR))) {
+      struct sock_extended_err *serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+      if (serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+        *tsKey = serr->ee_data;
+        haveKey = true;
+      }
+    }
+  }
+  if ((!haveKey) || (*kernelTxTime == 0))
+    return ERROR;
+  return 1;
+}
@@ -0,0 +1,28 @@
+/************************************************************************
+* File:  sockTimestamp.h
+*
+* Purpose:
+*   Kernel software timestamps (SO_TIMESTAMPING) for received and sent
+*   datagrams.  RX timestamps arrive as recvmsg() control messages, TX
+*   timestamps are read back from the socket error queue.
+*
+* Notes:
+*   Kernel timestamps are CLOCK_REALTIME, returned here as int64_t
+*   nanoseconds like timeWallNs().  0 means no timestamp was delivered.
+*
+************************************************************************/
+#ifndef	__sockTimestamp_h
+#define	__sockTimestamp_h
+
+//Room for the SCM_TIMESTAMPING control message
+#define TIMESTAMP_CONTROL_LEN 256
+
+int enableSocketTimestamps(int sock, bool txTimestamps);
+int64_t getControlTimestamp(struct msghdr *msg);
+ssize_t recvWithTimestamp(int sock, void *buffer, size_t len, int flags,
+                          struct sockaddr *from, socklen_t *fromLen, int64_t *kernelRxTime);
+int readTxTimestamp(int sock, uint32_t *tsKey, int64_t *kernelTxTime);
+
+#endif
+
+
@@ -0,0 +1,236 @@
+/*********************************************************
+* Module Name:  Shared memory statistics
+*
+* File Name:    statsShm.c
+*
+* Summary:
+*   Publishes a program's counters into a /dev/shm segment under a
+*   seqlock, and reads them back for udpecho-stat.  See statsShm.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+#include "statsShm.h"
+
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sched.h>
+
+static void *statsShmPublisher(void *arg);
+static void statsShmPublish(statsShm *s);
+
+/*************************************************************
+*
+* Function: int statsShmOpen(statsShm *s, const char *role,
+*                            intervalSnapshot snapshot)
+*
+* Summary: Creates /dev/shm/udpecho-<role>-<pid>, publishes the first
+*          snapshot and starts the publisher thread
+*
+* Inputs:
+*   statsShm *s : caller's publisher
+*   const char *role : "client" or "server"
+*   intervalSnapshot snapshot : fills in the program's cumulative
+*                               counters, called from the publisher thread
+*
+* outputs:
+*   returns NOERROR or ERROR (errno set) if anything could not be set up
+*
+***************************************************************/
+int statsShmOpen(statsShm *s, const char *role, intervalSnapshot snapshot)
+{
+  statsShmSegment *segment;
+  sigset_t allSignals;
+  sigset_t oldSignals;
+  int fd;
+
+  memset(s, 0, sizeof(statsShm));
+  s->snapshot = snapshot;
+  snprintf(s->name, sizeof(s->name), "/%s%s-%d", STATS_SHM_PREFIX, role, (int)getpid());
+  fd = shm_open(s->name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return ERROR;
+  if (ftruncate(fd, sizeof(statsShmSegment)) < 0) {
+    close(fd);
+    shm_unlink(s->name);
+    return ERROR;
+  }
+  segment = mmap(NULL, sizeof(statsShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (segment == MAP_FAILED) {
+    shm_unlink(s->name);
+    return ERROR;
+  }
+  s->segment = segment;
+
+  segment->magic = STATS_SHM_MAGIC;
+  segment->version = STATS_SHM_VERSION;
+  segment->headerSize = (uint16_t)offsetof(statsShmSegment, counters);
+  segment->countersSize = sizeof(intervalCounters);
+  segment->pid = (int32_t)getpid();
+  snprintf(segment->role, sizeof(segment->role), "%s", role);
+  segment->startWallNs = timeWallNs();
+  segment->publishNs = STATS_SHM_PUBLISH_NS;
+  statsShmPublish(s);
+  atomic_store(&segment->state, STATS_SHM_RUNNING);
+
+  atomic_store(&s->stop, false);
+  //the thread inherits the mask, so no signal is ever delivered to it
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &oldSignals);
+  errno = pthread_create(&s->thread, NULL, statsShmPublisher, s);
+  pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+  if (errno != 0)
+    return ERROR;
+  s->running = true;
+  return NOERROR;
+}
+
+/*************************************************************
+*
+* Function: void statsShmClose(statsShm *s)
+*
+* Summary: Stops the publisher, publishes the final counters, marks
+*          the segment exited and unlinks it
+*
+***************************************************************/
+void statsShmClose(statsShm *s)
+{
+  if (s->segment == NULL)
+    return;
+  if (s->running) {
+    atomic_store(&s->stop, true);
+    pthread_join(s->thread, NULL);
+    s->running = false;
+  }
+  statsShmPublish(s);
+  atomic_store(&s->segment->state, STATS_SHM_EXITED);
+  munmap(s->segment, sizeof(statsShmSegment));
+  shm_unlink(s->name);
+  s->segment = NULL;
+}
+
+/*************************************************************
+*
+* Function: static void statsShmPublish(statsShm *s)
+*
+* Summary: Seqlock write side.  The odd sequence number has to be
+*          visible before any counter changes and the counters before
+*          the even one, the fences keep both the compiler and the CPU
+*          to that order.
+*
+***************************************************************/
+static void statsShmPublish(statsShm *s)
+{
+  statsShmSegment *segment = s->segment;
+  uint32_t sequence = atomic_load_explicit(&segment->sequence, memory_order_relaxed);
+
+  atomic_store_explicit(&segment->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  s->snapshot(&segment->counters);
+  segment->publishWallNs = timeWallNs();
+  segment->publishCount++;
+  atomic_store_explicit(&segment->sequence, sequence + 2, memory_order_release);
+}
+
+static void *statsShmPublisher(void *arg)
+{
+  statsShm *s = (statsShm *)arg;
+  struct timespec nap;
+
+  nap.tv_sec = 0;
+  nap.tv_nsec = STATS_SHM_PUBLISH_NS;
+  while (!atomic_load(&s->stop)) {
+    nanosleep(&nap, NULL);
+    statsShmPublish(s);
+  }
+  return NULL;
+}
+
+/*************************************************************
+*
+* Function: statsShmSegment *statsShmAttach(const char *name)
+*
+* Summary: Maps a segment read only
+*
+* Inputs:
+*   const char *name : the shm_open() name, e.g. "/udpecho-server-1234"
+*
+* outputs:
+*   returns the segment, or NULL with errno set (EPROTO if it is not a
+*   segment of this version)
+*
+***************************************************************/
+statsShmSegment *statsShmAttach(const char *name)
+{
+  statsShmSegment *segment;
+  struct stat st;
+  int fd;
+
+  fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return NULL;
+  if ((fstat(fd, &st) < 0) || (st.st_size < (off_t)sizeof(statsShmSegment))) {
+    close(fd);
+    errno = EPROTO;
+    return NULL;
+  }
+  segment = mmap(NULL, sizeof(statsShmSegment), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (segment == MAP_FAILED)
+    return NULL;
+  if ((segment->magic != STATS_SHM_MAGIC) || (segment->version != STATS_SHM_VERSION) ||
+      (segment->countersSize != sizeof(intervalCounters))) {
+    munmap(segment, sizeof(statsShmSegment));
+    errno = EPROTO;
+    return NULL;
+  }
+  return segment;
+}
+
+void statsShmDetach(statsShmSegment *segment)
+{
+  if (segment != NULL)
+    munmap(segment, sizeof(statsShmSegment));
+}
+
+/*************************************************************
+*
+* Function: int statsShmRead(statsShmSegment *segment,
+*               intervalCounters *counters, int64_t *publishWallNs)
+*
+* Summary: Seqlock read side, copies a consistent snapshot
+*
+* Inputs:
+*   statsShmSegment *segment : from statsShmAttach()
+*   intervalCounters *counters : caller's copy
+*   int64_t *publishWallNs : set to when the copy was published
+*
+* outputs:
+*   returns SUCCESS, or ERROR if the writer kept changing it for
+*   STATS_SHM_READ_RETRIES attempts
+*
+***************************************************************/
+int statsShmRead(statsShmSegment *segment, intervalCounters *counters, int64_t *publishWallNs)
+{
+  uint32_t before;
+  uint32_t after;
+  int retries;
+
+  for (retries = 0; retries < STATS_SHM_READ_RETRIES; retries++) {
+    before = atomic_load_explicit(&segment->sequence, memory_order_acquire);
+    if (before & 1) {
+      //mid publish, let the writer finish
+      sched_yield();
+      continue;
+    }
+    memcpy(counters, &segment->counters, sizeof(intervalCounters));
+    *publishWallNs = segment->publishWallNs;
+    atomic_thread_fence(memory_order_acquire);
+    after = atomic_load_explicit(&segment->sequence, memory_order_relaxed);
+    if (before == after)
+      return SUCCESS;
+  }
+  return ERROR;
+}
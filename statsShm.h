@@ -0,0 +1,84 @@
+/************************************************************************
+* File:  statsShm.h
+*
+* Purpose:
+*   Live statistics of a running client or server in a POSIX shared
+*   memory segment, /dev/shm/udpecho-<role>-<pid>, so a monitor such as
+*   udpecho-stat can watch a test at full packet rate without a system
+*   call or a signal to the process being watched.
+*
+* Notes:
+*   A publisher thread takes the program's intervalCounters snapshot
+*   (see intervalReport.h) every STATS_SHM_PUBLISH_NS and writes it into
+*   the segment under a seqlock: the sequence number is odd while the
+*   counters are being rewritten.  The publisher is the only writer and
+*   never waits for a reader; a reader copies the counters and retries
+*   if the sequence number was odd or changed under it.  The snapshot
+*   itself comes from the copies the packet loops publish (see
+*   intervalPublished in intervalReport.h), never their live counters.
+*
+*   The segment is unlinked when the program exits, a reader that still
+*   has it mapped sees state STATS_SHM_EXITED and the final counters.
+*
+*   Layout and counters are in host byte order, the reader has to run
+*   on the same machine anyway.
+*
+************************************************************************/
+#ifndef	__statsShm_h
+#define	__statsShm_h
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "intervalReport.h"
+
+#define STATS_SHM_MAGIC 0x55455353     //"UESS"
+#define STATS_SHM_VERSION 1
+#define STATS_SHM_PREFIX "udpecho-"
+#define STATS_SHM_DIR "/dev/shm"
+#define STATS_SHM_NAME_SIZE 64
+//How often the counters are republished
+#define STATS_SHM_PUBLISH_NS 10000000LL
+//How often a reader retries before it gives up on a snapshot
+#define STATS_SHM_READ_RETRIES 1000
+
+//Segment states
+#define STATS_SHM_RUNNING 1
+#define STATS_SHM_EXITED 2
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t countersSize;
+  int32_t pid;
+  char role[16];
+  int64_t startWallNs;
+  int64_t publishNs;
+  _Atomic uint32_t state;
+  //even while the counters are stable, odd while they are written
+  _Atomic uint32_t sequence __attribute__((aligned(CACHE_LINE_SIZE)));
+  int64_t publishWallNs;
+  uint64_t publishCount;
+  intervalCounters counters __attribute__((aligned(CACHE_LINE_SIZE)));
+} statsShmSegment;
+
+//Publishing side
+typedef struct {
+  char name[STATS_SHM_NAME_SIZE];
+  statsShmSegment *segment;
+  intervalSnapshot snapshot;
+  pthread_t thread;
+  atomic_bool stop;
+  bool running;
+} statsShm;
+
+int statsShmOpen(statsShm *s, const char *role, intervalSnapshot snapshot);
+void statsShmClose(statsShm *s);
+
+//Reading side
+statsShmSegment *statsShmAttach(const char *name);
+void statsShmDetach(statsShmSegment *segment);
+int statsShmRead(statsShmSegment *segment, intervalCounters *counters, int64_t *publishWallNs);
+
+#endif
+
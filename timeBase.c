@@ -0,0 +1,183 @@
+/*********************************************************
+* Module Name:  Time base
+*
+* File Name:    timeBase.c
+*
+* Summary:
+*   Integer nanosecond monotonic and wall clocks, the monotonic one
+*   optionally read from a calibrated TSC.  See timeBase.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "timeBase.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TIME_HAVE_TSC 1
+#endif
+
+timeBase timeSource;
+
+static int64_t clockNs(clockid_t clockID);
+#ifdef TIME_HAVE_TSC
+static int timeCalibrateTSC(timeBase *t);
+#endif
+
+static int64_t clockNs(clockid_t clockID)
+{
+  struct timespec ts;
+
+  if (clock_gettime(clockID, &ts) != 0) {
+    perror("timeBase:  HARD error on clock_gettime\n");
+    return 0;
+  }
+  return timespecToNs(&ts);
+}
+
+int64_t timespecToNs(const struct timespec *ts)
+{
+  return (int64_t)ts->tv_sec * NS_PER_SEC + ts->tv_nsec;
+}
+
+double nsToSecs(int64_t ns)
+{
+  return (double)ns / (double)NS_PER_SEC;
+}
+
+/*************************************************************
+*
+* Function: bool timeTSCInvariant()
+*
+* Summary: Asks CPUID whether the TSC ticks at a constant rate in
+*          every P and C state (leaf 0x80000007, EDX bit 8).
+*
+* outputs:
+*   returns true if the TSC can stand in for a monotonic clock
+*
+***************************************************************/
+bool timeTSCInvariant()
+{
+#ifdef TIME_HAVE_TSC
+  unsigned int eax, ebx, ecx, edx;
+
+  if (__get_cpuid_max(0x80000000, NULL) < 0x80000007)
+    return false;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+    return false;
+  return (edx & (1u << 8)) != 0;
+#else
+  return false;
+#endif
+}
+
+#ifdef TIME_HAVE_TSC
+/*************************************************************
+*
+* Function: static int timeCalibrateTSC(timeBase *t)
+*
+* Summary: Counts TSC ticks over TIME_TSC_CALIBRATE_NS of
+*          CLOCK_MONOTONIC_RAW and sets up the multiplier.
+*
+* notes:
+*   Each end pairs a clock read with the TSC reads just before and
+*   after it and keeps the tightest pair of a few tries, so being
+*   descheduled in the middle of one does not skew the rate.
+*
+***************************************************************/
+static int timeCalibrateTSC(timeBase *t)
+{
+  uint64_t tsc[2] = {0, 0};
+  int64_t ns[2] = {0, 0};
+  struct timespec pause;
+  int end, i;
+
+  for (end = 0; end < 2; end++) {
+    uint64_t bestSpread = UINT64_MAX;
+    if (end == 1) {
+      pause.tv_sec = TIME_TSC_CALIBRATE_NS / NS_PER_SEC;
+      pause.tv_nsec = TIME_TSC_CALIBRATE_NS % NS_PER_SEC;
+      while (nanosleep(&pause, &pause) != 0)
+        ;
+    }
+    for (i = 0; i < 5; i++) {
+      uint64_t before = __rdtsc();
+      int64_t now = clockNs(CLOCK_MONOTONIC_RAW);
+      uint64_t after = __rdtsc();
+      if (after - before < bestSpread) {
+        bestSpread = after - before;
+        tsc[end] = before + (after - before) / 2;
+        ns[end] = now;
+      }
+    }
+  }
+  if ((tsc[1] <= tsc[0]) || (ns[1] <= ns[0]))
+    return ERROR;
+
+  t->tscMult = (uint64_t)(((unsigned __int128)(ns[1] - ns[0]) << TIME_TSC_SHIFT) / (tsc[1] - tsc[0]));
+  t->tscHz = (double)(tsc[1] - tsc[0]) * (double)NS_PER_SEC / (double)(ns[1] - ns[0]);
+  t->tscBase = tsc[1];
+  t->nsBase = ns[1];
+  return SUCCESS;
+}
+#endif
+
+/*************************************************************
+*
+* Function: int timeBaseInit(bool useTSC)
+*
+* Summary: Picks the clock behind timeNowNs()
+*
+* Inputs:
+*   bool useTSC : read the TSC rather than CLOCK_MONOTONIC_RAW
+*
+* outputs:
+*   returns SUCCESS, or ERROR if the TSC was asked for but is not
+*   invariant or could not be calibrated.  CLOCK_MONOTONIC_RAW is then
+*   used.
+*
+***************************************************************/
+int timeBaseInit(bool useTSC)
+{
+  memset(&timeSource, 0, sizeof(timeSource));
+  if (!useTSC)
+    return SUCCESS;
+#ifdef TIME_HAVE_TSC
+  if (!timeTSCInvariant() || (timeCalibrateTSC(&timeSource) != SUCCESS))
+    return ERROR;
+  timeSource.useTSC = true;
+  return SUCCESS;
+#else
+  return ERROR;
+#endif
+}
+
+/*************************************************************
+*
+* Function: int64_t timeNowNs()
+*
+* Summary: Monotonic time in nanoseconds, for intervals only
+*
+***************************************************************/
+int64_t timeNowNs()
+{
+#ifdef TIME_HAVE_TSC
+  if (timeSource.useTSC) {
+    //signed, another core's TSC may be a few ticks behind the base
+    int64_t ticks = (int64_t)(__rdtsc() - timeSource.tscBase);
+    return timeSource.nsBase + (int64_t)(((__int128)ticks * (__int128)timeSource.tscMult) >> TIME_TSC_SHIFT);
+  }
+#endif
+  return clockNs(CLOCK_MONOTONIC_RAW);
+}
+
+//CLOCK_REALTIME in nanoseconds
+int64_t timeWallNs()
+{
+  return clockNs(CLOCK_REALTIME);
+}
+
+const char *timeBaseName()
+{
+  return timeSource.useTSC ? "tsc" : "monotonic_raw";
+}
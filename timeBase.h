@@ -0,0 +1,57 @@
+/************************************************************************
+* File:  timeBase.h
+*
+* Purpose:
+*   Integer nanosecond clocks for the client and server hot paths.
+*   timeNowNs() is a monotonic clock for intervals (RTTs, pacing,
+*   timeouts), timeWallNs() is CLOCK_REALTIME for what goes on the wire
+*   and is compared across hosts.  Times only become double seconds,
+*   through nsToSecs(), once they are reported.
+*
+* Notes:
+*   By default timeNowNs() reads CLOCK_MONOTONIC_RAW.  timeBaseInit(true)
+*   switches it to the TSC if the CPU says the TSC is invariant (constant
+*   rate, keeps counting in deep C states), scaled to nanoseconds with a
+*   fixed point multiplier calibrated against CLOCK_MONOTONIC_RAW.  Both
+*   then count from the same origin, so readings taken before and after
+*   the switch may not be mixed.
+*
+*   Wall time always comes from CLOCK_REALTIME, which NTP steers; a TSC
+*   based wall clock would drift away from the peer's clock by ppm.
+*
+*   Call timeBaseInit() once before any thread reads the clocks.
+*
+************************************************************************/
+#ifndef	__timeBase_h
+#define	__timeBase_h
+
+#define NS_PER_SEC 1000000000LL
+
+//How long the TSC is counted against CLOCK_MONOTONIC_RAW at startup
+#define TIME_TSC_CALIBRATE_NS 20000000LL
+//Fixed point fraction bits of the ticks to ns multiplier
+#define TIME_TSC_SHIFT 32
+
+typedef struct {
+  bool useTSC;
+  //TSC reading and CLOCK_MONOTONIC_RAW ns at the end of calibration
+  uint64_t tscBase;
+  int64_t nsBase;
+  //ns per tick << TIME_TSC_SHIFT
+  uint64_t tscMult;
+  double tscHz;
+} timeBase;
+
+extern timeBase timeSource;
+
+int timeBaseInit(bool useTSC);
+bool timeTSCInvariant();
+int64_t timeNowNs();
+int64_t timeWallNs();
+int64_t timespecToNs(const struct timespec *ts);
+double nsToSecs(int64_t ns);
+const char *timeBaseName();
+
+#endif
+
+
@@ -0,0 +1,149 @@
+/*********************************************************
+* Module Name:  UDP segmentation offload
+*
+* File Name:    udpSegment.c
+*
+* Summary:
+*   UDP_SEGMENT sends and UDP_GRO receives.  See udpSegment.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "sockTimestamp.h"
+#include "sockDrops.h"
+#include "udpSegment.h"
+
+#include <netinet/udp.h>
+
+/*************************************************************
+*
+* Function: int enableUDPGRO(int sock)
+*
+* Summary: Lets the socket receive coalesced (GRO) datagrams
+*
+* outputs:
+*   returns NOERROR or ERROR (errno set by setsockopt)
+*
+***************************************************************/
+int enableUDPGRO(int sock)
+{
+  int optval = 1;
+
+  if (setsockopt(sock, SOL_UDP, UDP_GRO, &optval, sizeof(optval)) < 0)
+    return ERROR;
+  return NOERROR;
+}
+
+/*************************************************************
+*
+* Function: int getControlSegmentSize(struct msghdr *msg)
+*
+* Summary: Pulls the UDP_GRO segment size out of the control
+*          messages of a received msghdr.
+*
+* outputs:
+*   returns the size of each coalesced datagram, or 0 if the receive
+*   was a single datagram
+*
+***************************************************************/
+int getControlSegmentSize(struct msghdr *msg)
+{
+  struct cmsghdr *cmsg;
+  int segmentSize = 0;
+
+  for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_UDP) && (cmsg->cmsg_type == UDP_GRO)) {
+      memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(segmentSize));
+      return segmentSize;
+    }
+  }
+  return 0;
+}
+
+/*************************************************************
+*
+* Function: ssize_t sendSegments(int sock, void *buffer, size_t len,
+*               uint16_t segmentSize, struct sockaddr *to, socklen_t toLen,
+*               int flags)
+*
+* Summary: Sends len bytes as datagrams of segmentSize bytes with one
+*          sendmsg() carrying a UDP_SEGMENT control message.  flags go
+*          to sendmsg(), e.g. MSG_ZEROCOPY.
+*
+* outputs:
+*   returns the bytes sent or -1 with errno set
+*
+***************************************************************/
+ssize_t sendSegments(int sock, void *buffer, size_t len, uint16_t segmentSize,
+                     struct sockaddr *to, socklen_t toLen, int flags)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE(sizeof(uint16_t))];
+    struct cmsghdr align;
+  } control;
+
+  iov.iov_base = buffer;
+  iov.iov_len = len;
+  memset(&msg, 0, sizeof(msg));
+  memset(&control, 0, sizeof(control));
+  msg.msg_name = to;
+  msg.msg_namelen = toLen;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+  memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(uint16_t));
+
+  return sendmsg(sock, &msg, flags);
+}
+
+/*************************************************************
+*
+* Function: ssize_t recvSegments(int sock, void *buffer, size_t len,
+*               struct sockaddr *from, socklen_t *fromLen,
+*               int64_t *kernelRxTime, int *segmentSize, uint32_t *dropCount)
+*
+* Summary: recvWithTimestamp() that also returns the UDP_GRO segment
+*          size, 0 when a single datagram was received, and the
+*          SO_RXQ_OVFL drop count, 0 when there is none.
+*
+***************************************************************/
+ssize_t recvSegments(int sock, void *buffer, size_t len, struct sockaddr *from,
+                     socklen_t *fromLen, int64_t *kernelRxTime, int *segmentSize,
+                     uint32_t *dropCount)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  char control[TIMESTAMP_CONTROL_LEN];
+  ssize_t rc;
+
+  iov.iov_base = buffer;
+  iov.iov_len = len;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = from;
+  msg.msg_namelen = (fromLen != NULL) ? *fromLen : 0;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  *kernelRxTime = 0;
+  *segmentSize = 0;
+  *dropCount = 0;
+  rc = recvmsg(sock, &msg, 0);
+  if (rc < 0)
+    return rc;
+  if (fromLen != NULL)
+    *fromLen = msg.msg_namelen;
+  *kernelRxTime = getControlTimestamp(&msg);
+  *segmentSize = getControlSegmentSize(&msg);
+  *dropCount = getControlDropCount(&msg);
+  return rc;
+}
@@ -0,0 +1,38 @@
+/************************************************************************
+* File:  udpSegment.h
+*
+* Purpose:
+*   UDP generic segmentation offload (UDP_SEGMENT) for sending a burst
+*   of equal sized datagrams with one sendmsg(), and UDP_GRO for
+*   receiving several datagrams of a flow coalesced into one buffer.
+*
+* Notes:
+*   A GSO send is one buffer of back to back datagrams of segmentSize
+*   bytes, the last one may be shorter.  The kernel (or the NIC) cuts
+*   it into real datagrams, so on the wire nothing changes.  Each
+*   datagram, headers included, still has to fit the path MTU.
+*
+*   A GRO receive is the reverse: recvmsg() returns several datagrams
+*   back to back and a UDP_GRO control message with their size.  The
+*   receive buffer must be GRO_BUFFER_SIZE bytes to hold the largest.
+*
+************************************************************************/
+#ifndef	__udpSegment_h
+#define	__udpSegment_h
+
+//Most datagrams the kernel accepts in one UDP_SEGMENT send
+#define UDP_MAX_GSO_SEGMENTS 64
+//Largest GSO send or GRO receive
+#define GRO_BUFFER_SIZE 65536
+
+int enableUDPGRO(int sock);
+int getControlSegmentSize(struct msghdr *msg);
+ssize_t sendSegments(int sock, void *buffer, size_t len, uint16_t segmentSize,
+                     struct sockaddr *to, socklen_t toLen, int flags);
+ssize_t recvSegments(int sock, void *buffer, size_t len, struct sockaddr *from,
+                     socklen_t *fromLen, int64_t *kernelRxTime, int *segmentSize,
+                     uint32_t *dropCount);
+
+#endif
+
+
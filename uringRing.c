@@ -0,0 +1,265 @@
+/*********************************************************
+* Module Name:  io_uring ring
+*
+* File Name:    uringRing.c
+*
+* Summary:
+*   Sets up an io_uring instance and a provided buffer ring with the
+*   raw system calls and maps their shared rings.  See uringRing.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "uringRing.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/*************************************************************
+*
+* Function: int uringInit(uringRing *r, unsigned entries, bool sqPoll)
+*
+* Summary: Creates the io_uring instance and maps its rings
+*
+* Inputs:
+*   uringRing *r : caller's ring
+*   unsigned entries : SQ size, the kernel rounds it up to a power of
+*                      two and makes the CQ twice as large
+*   bool sqPoll : have a kernel thread poll the SQ (IORING_SETUP_SQPOLL)
+*
+* outputs:
+*   returns SUCCESS or ERROR with errno set
+*
+***************************************************************/
+int uringInit(uringRing *r, unsigned entries, bool sqPoll)
+{
+  struct io_uring_params params;
+  unsigned i;
+  char *sq;
+  char *cq;
+
+  memset(r, 0, sizeof(uringRing));
+  memset(&params, 0, sizeof(params));
+  if (sqPoll) {
+    params.flags |= IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = URING_SQ_THREAD_IDLE_MS;
+  }
+  r->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (r->fd < 0)
+    return ERROR;
+  r->sqPoll = sqPoll;
+
+  r->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  r->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  //Newer kernels map both rings with one mmap()
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (r->cqRingSize > r->sqRingSize)
+      r->sqRingSize = r->cqRingSize;
+    r->cqRingSize = r->sqRingSize;
+  }
+  r->sqRing = mmap(NULL, r->sqRingSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+  if (r->sqRing == MAP_FAILED)
+    return ERROR;
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    r->cqRing = r->sqRing;
+  } else {
+    r->cqRing = mmap(NULL, r->cqRingSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    if (r->cqRing == MAP_FAILED)
+      return ERROR;
+  }
+  r->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED)
+    return ERROR;
+
+  sq = (char *)r->sqRing;
+  r->sqHead = (unsigned *)(sq + params.sq_off.head);
+  r->sqTail = (unsigned *)(sq + params.sq_off.tail);
+  r->sqFlags = (unsigned *)(sq + params.sq_off.flags);
+  r->sqArray = (unsigned *)(sq + params.sq_off.array);
+  r->sqMask = *(unsigned *)(sq + params.sq_off.ring_mask);
+  r->sqEntries = params.sq_entries;
+  r->sqLocalTail = *r->sqTail;
+  //SQE i always sits in array slot i
+  for (i = 0; i < r->sqEntries; i++)
+    r->sqArray[i] = i;
+
+  cq = (char *)r->cqRing;
+  r->cqHead = (unsigned *)(cq + params.cq_off.head);
+  r->cqTail = (unsigned *)(cq + params.cq_off.tail);
+  r->cqMask = *(unsigned *)(cq + params.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  return SUCCESS;
+}
+
+void uringClose(uringRing *r)
+{
+  if (r->sqes != NULL)
+    munmap(r->sqes, r->sqesSize);
+  if ((r->cqRing != NULL) && (r->cqRing != r->sqRing))
+    munmap(r->cqRing, r->cqRingSize);
+  if (r->sqRing != NULL)
+    munmap(r->sqRing, r->sqRingSize);
+  if (r->fd >= 0)
+    close(r->fd);
+  memset(r, 0, sizeof(uringRing));
+  r->fd = -1;
+}
+
+/*************************************************************
+*
+* Function: struct io_uring_sqe *uringGetSqe(uringRing *r)
+*
+* Summary: Hands out the next free SQE, zeroed.  It goes to the
+*          kernel with the next uringSubmit().
+*
+* outputs:
+*   returns the SQE or NULL if the SQ is full
+*
+***************************************************************/
+struct io_uring_sqe *uringGetSqe(uringRing *r)
+{
+  unsigned head = __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE);
+  struct io_uring_sqe *sqe;
+
+  if (r->sqLocalTail - head >= r->sqEntries)
+    return NULL;
+  sqe = &r->sqes[r->sqLocalTail & r->sqMask];
+  r->sqLocalTail++;
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  return sqe;
+}
+
+/*************************************************************
+*
+* Function: int uringSubmit(uringRing *r, unsigned waitCount)
+*
+* Summary: Publishes the SQEs handed out since the last call and,
+*          if waitCount > 0, waits until that many CQEs are ready.
+*
+* outputs:
+*   returns the io_uring_enter() result, 0 if no call was needed,
+*   or -1 with errno set
+*
+* notes:
+*   Without sqPoll submitting takes one io_uring_enter() which also
+*   does the waiting.  What it submits is counted from the kernel's
+*   head, not from the tail published last time, so SQEs a failed or
+*   partial io_uring_enter() left on the ring go with the next call.
+*   With sqPoll the kernel thread takes the SQEs off the ring by
+*   itself, the call is only made to wake it up or to wait.
+*
+***************************************************************/
+int uringSubmit(uringRing *r, unsigned waitCount)
+{
+  unsigned toSubmit = r->sqLocalTail - __atomic_load_n(r->sqHead, __ATOMIC_ACQUIRE);
+  unsigned flags = 0;
+  int rc;
+
+  __atomic_store_n(r->sqTail, r->sqLocalTail, __ATOMIC_RELEASE);
+  if (r->sqPoll) {
+    //the tail store has to be visible before the thread's flag is read
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(r->sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+      flags |= IORING_ENTER_SQ_WAKEUP;
+    else if (waitCount == 0)
+      return 0;
+  } else if ((toSubmit == 0) && (waitCount == 0)) {
+    return 0;
+  }
+  if (waitCount > 0)
+    flags |= IORING_ENTER_GETEVENTS;
+
+  r->enterCount++;
+  rc = (int)syscall(__NR_io_uring_enter, r->fd, toSubmit, waitCount, flags, NULL, 0);
+  return rc;
+}
+
+//Returns the oldest unseen CQE or NULL if there is none
+struct io_uring_cqe *uringPeekCqe(uringRing *r)
+{
+  unsigned head = *r->cqHead;
+
+  if (head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE))
+    return NULL;
+  return &r->cqes[head & r->cqMask];
+}
+
+//Gives the CQE uringPeekCqe() returned back to the kernel
+void uringCqeSeen(uringRing *r)
+{
+  __atomic_store_n(r->cqHead, *r->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+/*************************************************************
+*
+* Function: int uringBufRingInit(uringRing *r, uringBufRing *b,
+*               uint16_t groupID, uint16_t count, uint32_t bufferSize)
+*
+* Summary: Allocates count buffers, registers a provided buffer ring
+*          for them as buffer group groupID and gives them all to
+*          the kernel.
+*
+* Inputs:
+*   uint16_t count : number of buffers, a power of two
+*   uint32_t bufferSize : bytes per buffer, rounded up to a cache line
+*
+* outputs:
+*   returns SUCCESS or ERROR with errno set
+*
+***************************************************************/
+int uringBufRingInit(uringRing *r, uringBufRing *b, uint16_t groupID, uint16_t count, uint32_t bufferSize)
+{
+  struct io_uring_buf_reg reg;
+  uint16_t i;
+
+  memset(b, 0, sizeof(uringBufRing));
+  b->count = count;
+  b->groupID = groupID;
+  b->bufferSize = (bufferSize + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+
+  b->ringSize = (size_t)count * sizeof(struct io_uring_buf);
+  b->ring = mmap(NULL, b->ringSize, PROT_READ | PROT_WRITE,
+                 MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (b->ring == MAP_FAILED) {
+    b->ring = NULL;
+    return ERROR;
+  }
+  if (posix_memalign((void **)&b->buffers, CACHE_LINE_SIZE, (size_t)count * b->bufferSize) != 0)
+    return ERROR;
+
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)b->ring;
+  reg.ring_entries = count;
+  reg.bgid = groupID;
+  if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    return ERROR;
+
+  for (i = 0; i < count; i++)
+    uringBufRingAdd(b, i);
+  uringBufRingPublish(b);
+  return SUCCESS;
+}
+
+char *uringBufRingBuffer(uringBufRing *b, uint16_t bufferID)
+{
+  return b->buffers + (size_t)bufferID * b->bufferSize;
+}
+
+//Queues a buffer to go back to the kernel with the next publish
+void uringBufRingAdd(uringBufRing *b, uint16_t bufferID)
+{
+  struct io_uring_buf *buf = &b->ring->bufs[b->localTail & (b->count - 1)];
+
+  buf->addr = (uint64_t)(uintptr_t)uringBufRingBuffer(b, bufferID);
+  buf->len = b->bufferSize;
+  buf->bid = bufferID;
+  b->localTail++;
+}
+
+void uringBufRingPublish(uringBufRing *b)
+{
+  __atomic_store_n(&b->ring->tail, b->localTail, __ATOMIC_RELEASE);
+}
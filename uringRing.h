@@ -0,0 +1,83 @@
+/************************************************************************
+* File:  uringRing.h
+*
+* Purpose:
+*   Minimal io_uring access through the raw io_uring_setup/enter/register
+*   system calls, no liburing needed.  Covers what the server's io_uring
+*   loop uses: getting and submitting SQEs, reaping CQEs, and a provided
+*   buffer ring the kernel picks receive buffers from.
+*
+* Notes:
+*   The SQ and CQ rings are shared with the kernel.  Their head and tail
+*   indexes are read with acquire and published with release ordering,
+*   everything else in a ring is only touched by this side.
+*
+*   With sqPoll a kernel thread picks SQEs up as soon as the tail is
+*   published, so submitting only costs a system call when that thread
+*   has gone to sleep.  enterCount counts every io_uring_enter() made.
+*
+*   A ring belongs to one thread.
+*
+************************************************************************/
+#ifndef	__uringRing_h
+#define	__uringRing_h
+
+#include <linux/io_uring.h>
+
+//How long an idle SQ poll thread spins before it sleeps
+#define URING_SQ_THREAD_IDLE_MS 100
+
+typedef struct {
+  int fd;
+  bool sqPoll;
+  //SQ ring
+  unsigned *sqHead;
+  unsigned *sqTail;
+  unsigned *sqFlags;
+  unsigned *sqArray;
+  unsigned sqMask;
+  unsigned sqEntries;
+  struct io_uring_sqe *sqes;
+  //SQEs handed out by uringGetSqe() and not yet published
+  unsigned sqLocalTail;
+  //CQ ring
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned cqMask;
+  struct io_uring_cqe *cqes;
+  //mappings, for uringClose()
+  void *sqRing;
+  size_t sqRingSize;
+  void *cqRing;
+  size_t cqRingSize;
+  size_t sqesSize;
+  uint64_t enterCount;
+} uringRing;
+
+//Provided buffer ring, count must be a power of two
+typedef struct {
+  struct io_uring_buf_ring *ring;
+  size_t ringSize;
+  char *buffers;
+  uint32_t bufferSize;
+  uint16_t count;
+  uint16_t groupID;
+  //buffers added locally, published by uringBufRingPublish()
+  uint16_t localTail;
+} uringBufRing;
+
+int uringInit(uringRing *r, unsigned entries, bool sqPoll);
+void uringClose(uringRing *r);
+struct io_uring_sqe *uringGetSqe(uringRing *r);
+int uringSubmit(uringRing *r, unsigned waitCount);
+struct io_uring_cqe *uringPeekCqe(uringRing *r);
+void uringCqeSeen(uringRing *r);
+
+int uringBufRingInit(uringRing *r, uringBufRing *b, uint16_t groupID, uint16_t count, uint32_t bufferSize);
+char *uringBufRingBuffer(uringBufRing *b, uint16_t bufferID);
+void uringBufRingAdd(uringBufRing *b, uint16_t bufferID);
+void uringBufRingPublish(uringBufRing *b);
+
+#endif
+
+
@@ -74,6 +74,125 @@ void sockBlockingOn(int sock) { setUnblockOption(sock, 0); }
 void sockBlockingOff(int sock) { setUnblockOption(sock, 1); }
 
 
+/*************************************************************
+*
+* Function: double parseRate(const char *rateString)
+* 
+* Summary: Parses a rate such as 250k, 1.5M or 10G
+*
+* Inputs:
+*   const char *rateString : number with an optional k, M or G suffix
+*
+* outputs:  
+*   returns the rate scaled by 10^3, 10^6 or 10^9, or 0.0 if it does not parse
+*
+***************************************************************/
+double parseRate(const char *rateString)
+{
+  char *end = NULL;
+  double rate = strtod(rateString, &end);
+
+  if (end == rateString)
+    return 0.0;
+  switch (*end) {
+    case 'k': case 'K':
+      rate *= 1000.0;
+      break;
+    case 'm': case 'M':
+      rate *= 1000000.0;
+      break;
+    case 'g': case 'G':
+      rate *= 1000000000.0;
+      break;
+    default:
+      break;
+  }
+  return rate;
+}
+
+/*************************************************************
+*
+* Function: void packMessageHeader(char *buffer, messageHeaderDefault *header)
+*
+* Summary: Writes the header into the first MESSAGE_HEADER_SIZE bytes
+*          of a network buffer, one uint32_t at a time in network order
+*
+***************************************************************/
+void packMessageHeader(char *buffer, messageHeaderDefault *header)
+{
+  uint32_t *intPtr = (uint32_t *) buffer;
+
+  *intPtr++ = htonl((uint32_t)header->sequenceNum);
+  *intPtr++ = htonl(header->timeSentSeconds);
+  *intPtr++ = htonl(header->timeSentNanoSeconds);
+  *intPtr++ = htonl((uint32_t)header->opMode | ((uint32_t)header->flags << 16));
+  *intPtr++ = htonl((uint32_t)(header->sequenceNum >> 32));
+}
+
+/*************************************************************
+*
+* Function: void unpackMessageHeader(char *buffer, messageHeaderDefault *header)
+*
+* Summary: Reads the header out of a received network buffer of at
+*          least MESSAGE_HEADER_SIZE bytes
+*
+***************************************************************/
+void unpackMessageHeader(char *buffer, messageHeaderDefault *header)
+{
+  uint32_t *intPtr = (uint32_t *) buffer;
+  uint32_t word;
+
+  header->sequenceNum = ntohl(*intPtr++);
+  header->timeSentSeconds = ntohl(*intPtr++);
+  header->timeSentNanoSeconds = ntohl(*intPtr++);
+  word = ntohl(*intPtr++);
+  header->opMode = (uint16_t)(word & 0xffff);
+  header->flags = (uint16_t)(word >> 16);
+  header->sequenceNum |= ((uint64_t)ntohl(*intPtr++)) << 32;
+}
+
+/*************************************************************
+*
+* Function: void packServerTimestamp(char *buffer, int index, int64_t ns)
+*
+* Summary: Writes one of the server's timestamps behind the header of
+*          a MSG_FLAG_TIMESTAMPS datagram, index 0 for the receive time
+*          and 1 for the echo time.  The buffer must hold at least
+*          MESSAGE_EXT_HEADER_SIZE bytes.
+*
+***************************************************************/
+void packServerTimestamp(char *buffer, int index, int64_t ns)
+{
+  uint32_t *intPtr = (uint32_t *) (buffer + MESSAGE_HEADER_SIZE) + 2 * index;
+
+  *intPtr++ = htonl((uint32_t)((uint64_t)ns >> 32));
+  *intPtr++ = htonl((uint32_t)ns);
+}
+
+/*************************************************************
+*
+* Function: void unpackServerTimestamps(char *buffer, int64_t *serverRxTime,
+*                                       int64_t *serverTxTime)
+*
+* Summary: Reads the server's receive and echo times out of an echo of
+*          at least MESSAGE_EXT_HEADER_SIZE bytes, 0 where the server
+*          left them unset
+*
+***************************************************************/
+void unpackServerTimestamps(char *buffer, int64_t *serverRxTime, int64_t *serverTxTime)
+{
+  uint32_t *intPtr = (uint32_t *) (buffer + MESSAGE_HEADER_SIZE);
+  uint64_t word;
+
+  word = (uint64_t)ntohl(*intPtr++) << 32;
+  word |= ntohl(*intPtr++);
+  *serverRxTime = (int64_t)word;
+  word = (uint64_t)ntohl(*intPtr++) << 32;
+  word |= ntohl(*intPtr++);
+  *serverTxTime = (int64_t)word;
+}
+
+
 const int bsti = 1;  // Byte swap test integer
 bool is_bigendian()
 {
@@ -40,6 +40,13 @@ void setUnblockOption(int sock, char unblock);
 void sockBlockingOn(int sock);
 void sockBlockingOff(int sock);
 
+double parseRate(const char *rateString);
+
+void packMessageHeader(char *buffer, messageHeaderDefault *header);
+void unpackMessageHeader(char *buffer, messageHeaderDefault *header);
+void packServerTimestamp(char *buffer, int index, int64_t ns);
+void unpackServerTimestamps(char *buffer, int64_t *serverRxTime, int64_t *serverTxTime);
+
 #endif
 
 
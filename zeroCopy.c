@@ -0,0 +1,233 @@
+/*********************************************************
+* Module Name:  Zero copy send pool
+*
+* File Name:    zeroCopy.c
+*
+* Summary:
+*   MSG_ZEROCOPY buffer pool and completion reaping.  See zeroCopy.h
+*
+*********************************************************/
+#include "UDPEcho.h"
+#include "zeroCopy.h"
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <linux/errqueue.h>
+
+static uint32_t zeroCopySlot(zeroCopyPool *z, char *buffer);
+static void zeroCopyRelease(zeroCopyPool *z, uint32_t slot);
+
+/*************************************************************
+*
+* Function: int zeroCopyInit(zeroCopyPool *z, int sock, uint32_t count,
+*                            size_t bufferSize)
+*
+* Summary: Enables SO_ZEROCOPY on the socket and allocates and pins
+*          count buffers of bufferSize bytes.
+*
+* outputs:
+*   returns SUCCESS or ERROR with errno set.  If the buffers cannot be
+*   locked (RLIMIT_MEMLOCK) the pool still works, z->pinned is false.
+*
+***************************************************************/
+int zeroCopyInit(zeroCopyPool *z, int sock, uint32_t count, size_t bufferSize)
+{
+  int optval = 1;
+  uint32_t i;
+  long pageSize = sysconf(_SC_PAGESIZE);
+
+  memset(z, 0, sizeof(zeroCopyPool));
+  z->sock = sock;
+  z->count = count;
+  //page aligned buffers so a send pins as few pages as possible
+  z->bufferSize = (bufferSize + pageSize - 1) & ~((size_t)pageSize - 1);
+
+  if (setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) < 0)
+    return ERROR;
+  if (posix_memalign((void **)&z->buffers, pageSize, (size_t)count * z->bufferSize) != 0)
+    return ERROR;
+  memset(z->buffers, 0, (size_t)count * z->bufferSize);
+  z->pinned = (mlock(z->buffers, (size_t)count * z->bufferSize) == 0);
+
+  z->freeList = calloc(count, sizeof(uint32_t));
+  z->pending = calloc(count, sizeof(uint32_t));
+  z->owned = calloc(count, sizeof(bool));
+  z->inFlight = calloc(count, sizeof(uint32_t));
+  if ((z->freeList == NULL) || (z->pending == NULL) || (z->owned == NULL) || (z->inFlight == NULL))
+    return ERROR;
+  for (i = 0; i < count; i++)
+    z->freeList[i] = count - 1 - i;
+  z->freeCount = count;
+  return SUCCESS;
+}
+
+static uint32_t zeroCopySlot(zeroCopyPool *z, char *buffer)
+{
+  return (uint32_t)((size_t)(buffer - z->buffers) / z->bufferSize);
+}
+
+//Back to the free list once the owner is done and every send completed
+static void zeroCopyRelease(zeroCopyPool *z, uint32_t slot)
+{
+  if ((z->pending[slot] == 0) && (!z->owned[slot]))
+    z->freeList[z->freeCount++] = slot;
+}
+
+/*************************************************************
+*
+* Function: char *zeroCopyGetBuffer(zeroCopyPool *z)
+*
+* Summary: Hands out a free buffer, waiting for completions if every
+*          buffer is still in flight.
+*
+* outputs:
+*   returns the buffer, owned by the caller until zeroCopyPut()
+*
+***************************************************************/
+char *zeroCopyGetBuffer(zeroCopyPool *z)
+{
+  uint32_t slot;
+
+  if (z->freeCount < ZERO_COPY_REAP_THRESHOLD)
+    zeroCopyReap(z, 0);
+  while (z->freeCount == 0)
+    zeroCopyReap(z, ZERO_COPY_WAIT_MS);
+
+  slot = z->freeList[--z->freeCount];
+  z->owned[slot] = true;
+  return z->buffers + (size_t)slot * z->bufferSize;
+}
+
+//The owner is done with a buffer from zeroCopyGetBuffer()
+void zeroCopyPut(zeroCopyPool *z, char *buffer)
+{
+  uint32_t slot = zeroCopySlot(z, buffer);
+
+  z->owned[slot] = false;
+  zeroCopyRelease(z, slot);
+}
+
+/*************************************************************
+*
+* Function: void zeroCopySent(zeroCopyPool *z, char *buffer)
+*
+* Summary: Records a successful MSG_ZEROCOPY send out of buffer (or
+*          anywhere inside it), which holds the buffer until the
+*          send's completion is reaped.
+*
+***************************************************************/
+void zeroCopySent(zeroCopyPool *z, char *buffer)
+{
+  uint32_t slot = zeroCopySlot(z, buffer);
+
+  z->inFlight[z->nextID % z->count] = slot;
+  z->nextID++;
+  z->pending[slot]++;
+  z->sendCount++;
+}
+
+/*************************************************************
+*
+* Function: ssize_t zeroCopySendto(zeroCopyPool *z, char *buffer,
+*               size_t len, struct sockaddr *to, socklen_t toLen)
+*
+* Summary: sendto() with MSG_ZEROCOPY out of a pool buffer.
+*
+* outputs:
+*   returns what sendto() returned
+*
+* notes:
+*   Each zero copy send in flight holds socket option memory.  When it
+*   runs out (ENOBUFS) the completions are reaped and the send retried
+*   once, after that it goes out as a normal copying send.
+*
+***************************************************************/
+ssize_t zeroCopySendto(zeroCopyPool *z, char *buffer, size_t len, struct sockaddr *to, socklen_t toLen)
+{
+  ssize_t rc;
+
+  //a buffer can have several sends in flight, but there are only count ID slots
+  while (z->sendCount - (z->zeroCopyCount + z->copiedCount) >= z->count)
+    zeroCopyReap(z, ZERO_COPY_WAIT_MS);
+
+  rc = sendto(z->sock, buffer, len, MSG_ZEROCOPY, to, toLen);
+  if ((rc < 0) && (errno == ENOBUFS)) {
+    zeroCopyReap(z, ZERO_COPY_WAIT_MS);
+    z->syscallCount++;
+    rc = sendto(z->sock, buffer, len, MSG_ZEROCOPY, to, toLen);
+    if ((rc < 0) && (errno == ENOBUFS)) {
+      z->fallbackCount++;
+      z->syscallCount++;
+      return sendto(z->sock, buffer, len, 0, to, toLen);
+    }
+  }
+  if (rc >= 0)
+    zeroCopySent(z, buffer);
+  return rc;
+}
+
+/*************************************************************
+*
+* Function: uint32_t zeroCopyReap(zeroCopyPool *z, int timeoutMs)
+*
+* Summary: Reads the completion notifications queued on the socket's
+*          error queue and releases the buffers of the completed sends.
+*
+* Inputs:
+*   int timeoutMs : how long to wait if nothing has completed yet,
+*                   0 to only read what is queued
+*
+* outputs:
+*   returns the number of sends completed
+*
+***************************************************************/
+uint32_t zeroCopyReap(zeroCopyPool *z, int timeoutMs)
+{
+  struct msghdr msg;
+  char control[128];
+  struct cmsghdr *cmsg;
+  struct pollfd pollSock;
+  uint32_t completed = 0;
+  uint32_t id;
+
+  for (;;) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    z->syscallCount++;
+    if (recvmsg(z->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if ((completed > 0) || (timeoutMs <= 0) ||
+          ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+        return completed;
+      //A non empty error queue shows up as POLLERR
+      pollSock.fd = z->sock;
+      pollSock.events = 0;
+      z->syscallCount++;
+      if (poll(&pollSock, 1, timeoutMs) <= 0)
+        return completed;
+      timeoutMs = 0;
+      continue;
+    }
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      struct sock_extended_err *serr;
+      if (!(((cmsg->cmsg_level == SOL_IP) && (cmsg->cmsg_type == IP_RECVERR)) ||
+            ((cmsg->cmsg_level == SOL_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR))))
+        continue;
+      serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+      if ((serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) || (serr->ee_errno != 0))
+        continue;
+      //sends ee_info through ee_data have completed
+      for (id = serr->ee_info; id != serr->ee_data + 1; id++) {
+        uint32_t slot = z->inFlight[id % z->count];
+        if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+          z->copiedCount++;
+        else
+          z->zeroCopyCount++;
+        z->pending[slot]--;
+        zeroCopyRelease(z, slot);
+        completed++;
+      }
+    }
+  }
+}
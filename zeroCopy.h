@@ -0,0 +1,72 @@
+/************************************************************************
+* File:  zeroCopy.h
+*
+* Purpose:
+*   MSG_ZEROCOPY sends from a pool of preallocated, mlock()ed buffers.
+*   The kernel sends straight out of a buffer instead of copying it, so
+*   the buffer may only be reused once the socket's error queue says
+*   the send has completed.  The pool hands out free buffers and takes
+*   them back from those completion notifications.
+*
+* Notes:
+*   The kernel numbers the MSG_ZEROCOPY sends of a socket from 0 and
+*   completes them in ID ranges.  Each notification also says whether
+*   the data was really sent in place or the kernel fell back to a
+*   copy (always the case on loopback, which has to queue the data),
+*   these are counted in zeroCopyCount and copiedCount.
+*
+*   A buffer can be the source of several sends (e.g. the datagrams of
+*   a GRO receive).  It returns to the free list once its owner has
+*   put it back and all of its sends have completed.
+*
+*   Completions share the error queue with SO_TIMESTAMPING TX
+*   timestamps, a socket should not use both.
+*
+*   A pool belongs to one thread.
+*
+************************************************************************/
+#ifndef	__zeroCopy_h
+#define	__zeroCopy_h
+
+//Buffers per pool
+#define ZERO_COPY_POOL_BUFFERS 256
+//Reap completions without waiting once fewer buffers than this are free
+#define ZERO_COPY_REAP_THRESHOLD (ZERO_COPY_POOL_BUFFERS / 2)
+//How long to wait for completions when the pool or the socket's
+//option memory (ENOBUFS) has run out
+#define ZERO_COPY_WAIT_MS 100
+
+typedef struct {
+  int sock;
+  char *buffers;
+  size_t bufferSize;
+  uint32_t count;
+  bool pinned;
+  //free buffers, a stack of indexes
+  uint32_t *freeList;
+  uint32_t freeCount;
+  //per buffer: sends not yet completed, and whether its owner still has it
+  uint32_t *pending;
+  bool *owned;
+  //buffer of each send in flight, indexed by send ID % count
+  uint32_t *inFlight;
+  uint32_t nextID;
+  uint64_t sendCount;
+  uint64_t zeroCopyCount;
+  uint64_t copiedCount;
+  //sends that went out with a normal copy as the option memory ran out
+  uint64_t fallbackCount;
+  //system calls on top of one per send: error queue reads, polls and retries
+  uint64_t syscallCount;
+} zeroCopyPool;
+
+int zeroCopyInit(zeroCopyPool *z, int sock, uint32_t count, size_t bufferSize);
+char *zeroCopyGetBuffer(zeroCopyPool *z);
+void zeroCopyPut(zeroCopyPool *z, char *buffer);
+void zeroCopySent(zeroCopyPool *z, char *buffer);
+ssize_t zeroCopySendto(zeroCopyPool *z, char *buffer, size_t len, struct sockaddr *to, socklen_t toLen);
+uint32_t zeroCopyReap(zeroCopyPool *z, int timeoutMs);
+
+#endif
+
+